@@ -30,6 +30,7 @@
 #include "lr.hpp"
 #include "ps.hpp"
 #include "utils.hpp"
+#include "load/tokenizer.hpp"
 
 using std::vector;
 using std::string;
@@ -77,15 +78,17 @@ void logistic_regression::local_parser(const vector<string> & linelst,
                                        const char sep = ',') {
   samples.resize(0);
   labels.resize(0);
+  vector<paracel::str_view> linev;
   for(auto & line : linelst) {
     vector<double> tmp;
-    auto linev = paracel::str_split(line, sep); 
+    paracel::tokenize(line, sep, linev);
+    tmp.reserve(linev.size());
     tmp.push_back(1.);
     for(size_t i = 0; i < linev.size() - 1; ++i) {
-      tmp.push_back(std::stod(linev[i]));
+      tmp.push_back(paracel::to_double(linev[i]));
     }
-    samples.push_back(tmp);
-    labels.push_back(std::stod(linev.back()));
+    samples.push_back(std::move(tmp));
+    labels.push_back(paracel::to_double(linev.back()));
   }
   if(kdim == 0) {
     kdim = samples[0].size() - 1;
@@ -95,14 +98,16 @@ void logistic_regression::local_parser(const vector<string> & linelst,
 // predict data format: feature_1,feature_2,..,feature_k,...
 void logistic_regression::local_parser_pred(const vector<string> & linelst,
                                             const char sep = ',') {
+  vector<paracel::str_view> linev;
   for(auto & line : linelst) {
     vector<double> tmp;
-    auto linev = paracel::str_split(line, sep); 
+    paracel::tokenize(line, sep, linev);
+    tmp.reserve(kdim + 1);
     tmp.push_back(1.);
     for(int i = 0; i < kdim; ++i) {
-      tmp.push_back(std::stod(linev[i]));
+      tmp.push_back(paracel::to_double(linev[i]));
     }
-    pred_samples.push_back(tmp);
+    pred_samples.push_back(std::move(tmp));
   }
 }
 
@@ -118,28 +123,30 @@ void logistic_regression::dgd_learning() {
   paracel_register_bupdate(update_file, update_func);
   double coff2 = 2. * beta * alpha;
   vector<double> delta(data_dim); 
+  auto add = [] (vector<double> a, const vector<double> & b) {
+    for(size_t i = 0; i < a.size(); ++i) a[i] += b[i];
+    return a;
+  };
 
   unsigned time_seed = std::chrono::system_clock::now().time_since_epoch().count();
   // train loop
   for(int rd = 0; rd < rounds; ++rd) {
-    for(int i = 0; i < data_dim; ++i) {
-      delta[i] = 0.;
-    }
     std::shuffle(idx.begin(), idx.end(), std::default_random_engine(time_seed)); 
     theta = paracel_read<vector<double> >("theta"); 
     
-    // traverse data
-    for(auto sample_id : idx) {
+    // traverse data, theta is fixed within a round so samples go in parallel
+    delta = paracel_parallel_reduce(0, idx.size(), vector<double>(data_dim, 0.),
+                                    [&] (size_t k, vector<double> & acc) {
+      int sample_id = idx[k];
       double grad = labels[sample_id] - lr_hypothesis(samples[sample_id]); 
       double coff1 = alpha * grad;
       for(int i = 0; i < data_dim; ++i) {
-        double t = coff1 * samples[sample_id][i] - coff2 * theta[i];
-        delta[i] += t;
+        acc[i] += coff1 * samples[sample_id][i] - coff2 * theta[i];
       }
-      if(debug) {
-        loss_error.push_back(calc_loss());
-      }
-    } // traverse
+    }, add); // traverse
+    if(debug) {
+      loss_error.insert(loss_error.end(), data_sz, calc_loss());
+    }
     paracel_sync(); // paracel_sync for map
     paracel_bupdate("theta", delta); // update with delta
     paracel_sync(); // paracel_sync for reduce
@@ -319,15 +326,15 @@ void logistic_regression::solve() {
 }
 
 double logistic_regression::calc_loss() {
-  double loss = 0.;
-  for(size_t i = 0; i < samples.size(); ++i) {
+  double loss = paracel_parallel_reduce(0, samples.size(), 0.,
+                                        [&] (size_t i, double & acc) {
     double h = lr_hypothesis(samples[i]);
     if(labels[i] == 1.) {
-      loss += -log(h);
+      acc += -log(h);
     } else {
-      loss += -log(1-h);
+      acc += -log(1-h);
     }
-  }
+  }, [] (double a, double b) { return a + b; });
   auto worker_comm = get_comm();
   worker_comm.allreduce(loss);
   int sz = samples.size();
@@ -357,10 +364,10 @@ void logistic_regression::predict(const std::string & pred_fn) {
   auto lines = paracel_load(pred_fn);
   pred_samples.resize(0);
   local_parser_pred(lines);
-  predv.resize(0);
-  for(size_t i = 0; i < pred_samples.size(); ++i) {
-    predv.push_back(std::make_pair(pred_samples[i], lr_hypothesis(pred_samples[i])));
-  }
+  predv.resize(pred_samples.size());
+  paracel_parallel_for(0, pred_samples.size(), [&] (size_t i) {
+    predv[i] = std::make_pair(pred_samples[i], lr_hypothesis(pred_samples[i]));
+  });
   paracel_sync();
 }
 
@@ -17,6 +17,7 @@
 #define FILE_2fae05e7_4f3a_2ac3_dc77_f92f7070193b_HPP
 
 #include <string>
+#include <vector>
 #include <chrono>
 #include <algorithm>
 #include <unordered_map>
@@ -66,10 +67,18 @@ class kmeans : public paracel::paralg {
     if(dtype == "fvec") {
       // load local dense matrix
       auto local_parser = [] (const std::string & line) {
-        auto r = paracel::str_split(line, '\t');
-        auto vec = paracel::str_split(r[1], ',');
-        r.resize(vec.size() + 1);
-        std::copy(vec.begin(), vec.end(), r.begin() + 1);
+        paracel::str_view id, vec;
+        paracel::tokenize(line, '\t', [&] (const paracel::str_view & v) {
+          if(id.empty()) {
+            id = v;
+          } else if(vec.empty()) {
+            vec = v;
+          }
+        });
+        std::vector<std::string> r(1, id.str());
+        paracel::tokenize(vec, ',', [&r] (const paracel::str_view & v) {
+          r.push_back(v.str());
+        });
         return r;
       };
       auto f_parser = paracel::gen_parser(local_parser);
@@ -119,11 +128,15 @@ class kmeans : public paracel::paralg {
       }
 
       // local update
-      for(size_t i = 0; i < (size_t)blk_dmtx.rows(); ++i) {
+      std::vector<int> owner(blk_dmtx.rows());
+      paracel_parallel_for(0, (size_t)blk_dmtx.rows(), [&] (size_t i) {
         Eigen::MatrixXd::Index indx;
         (clusters_mtx.rowwise() - blk_dmtx.row(i)).rowwise().squaredNorm().minCoeff(&indx);
-        pnt_owner[i] = indx;
-      } // sample
+        owner[i] = indx;
+      }); // sample
+      for(size_t i = 0; i < owner.size(); ++i) {
+        pnt_owner[i] = owner[i];
+      }
 
       std::vector<size_t> cluster_cnt_map(kclusters, 0);
       Eigen::MatrixXd clusters_mtx_tmp = Eigen::MatrixXd::Zero(kclusters, blk_dmtx.cols());
@@ -72,6 +72,8 @@ class decision_tree_builder_factor : public paracel::paralg {
         N_end(tree_end_indx) {
     trees.resize(N_end + 1);
     avg_ufacs.resize(N_end + 1);
+    // every worker loads all of uinput, read it once per node
+    set_loadall_share();
   }
 
   virtual ~decision_tree_builder_factor() {}
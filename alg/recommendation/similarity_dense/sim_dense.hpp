@@ -72,7 +72,10 @@ class sim_dense : public paracel::paralg {
         input_b(_input_b),
         output(_output),
         simbar(_simbar),
-        ktop(_ktop) {}
+        ktop(_ktop) {
+    // every worker streams all of input_b, read it once per node
+    set_loadall_share();
+  }
 
   virtual ~sim_dense() {}
 
@@ -82,22 +85,33 @@ class sim_dense : public paracel::paralg {
   }
 
   void learning(const unordered_map<node_t, vector<double> > & var) {
-    for(auto & iv : item_vects) {
+    // items go in parallel, each into its own heap merged afterwards
+    vector<const std::pair<const node_t, vector<double> > *> items;
+    items.reserve(item_vects.size());
+    for(auto & iv : item_vects) items.push_back(&iv);
+    vector<min_heap> heaps(items.size());
+    paracel_parallel_for(0, items.size(), [&] (size_t k) {
+      auto & iv = *items[k];
       for(auto & jv : var) {
         if(iv.first != jv.first) {
           double sim = cal_sim(iv.second, jv.second);
           if(sim >= simbar) {
             auto hnode = heap_node(jv.first, sim);
-            heapmap[iv.first].push(hnode.val);
-            if((int)heapmap[iv.first].size() > ktop) heapmap[iv.first].pop();
-            /*
-            result[iv.first].push_back(
-                std::make_pair(jv.first, sim));
-            */
+            heaps[k].push(hnode.val);
+            if((int)heaps[k].size() > ktop) heaps[k].pop();
           }
         }
       }
-    } // for iv
+    }); // for iv
+    for(size_t k = 0; k < items.size(); ++k) {
+      if(heaps[k].empty()) continue;
+      auto & hp = heapmap[items[k]->first];
+      while(!heaps[k].empty()) {
+        hp.push(heaps[k].top());
+        heaps[k].pop();
+        if((int)hp.size() > ktop) hp.pop();
+      }
+    }
   }
 
   void select_top() {
@@ -145,11 +159,16 @@ class sim_dense : public paracel::paralg {
   virtual void solve() {
     auto local_parser = [&] (const string & line) {
       vector<double> tmp;
-      auto v = paracel::str_split(line, ',');
-      for(size_t i = 1; i < v.size(); ++i) {
-        tmp.push_back(std::stod(v[i]));
-      }
-      item_vects[paracel::cvt(v[0])] = tmp;
+      node_t id = 0;
+      size_t i = 0;
+      paracel::tokenize(line, ',', [&] (const paracel::str_view & v) {
+        if(i++ == 0) {
+          id = paracel::to_uint64(v);
+        } else {
+          tmp.push_back(paracel::to_double(v));
+        }
+      });
+      item_vects[id] = std::move(tmp);
     };
     paracel_load_handle(input_a, local_parser);
     normalize(item_vects);
@@ -158,11 +177,16 @@ class sim_dense : public paracel::paralg {
       unordered_map<node_t, vector<double> > all_item_vects;
       for(auto & line : linelst) {
         vector<double> tmp;
-        auto v = paracel::str_split(line, ',');
-        for(size_t i = 1; i < v.size(); ++i) {
-          tmp.push_back(std::stod(v[i]));
-        }
-        all_item_vects[paracel::cvt(v[0])] = tmp;
+        node_t id = 0;
+        size_t i = 0;
+        paracel::tokenize(line, ',', [&] (const paracel::str_view & v) {
+          if(i++ == 0) {
+            id = paracel::to_uint64(v);
+          } else {
+            tmp.push_back(paracel::to_double(v));
+          }
+        });
+        all_item_vects[id] = std::move(tmp);
       }
       normalize(all_item_vects);
       learning(all_item_vects);
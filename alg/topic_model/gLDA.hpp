@@ -73,7 +73,6 @@ class LDAmodel: public paracel::paralg {
 	}
 
 	~LDAmodel(){
-		if(k_prob) delete[] k_prob;
 		if(sum_doc2topic) delete[] sum_doc2topic;
 		if(doc2topic){
 			for(int i = 0; i < M; i++){
@@ -258,10 +257,6 @@ private:
 	}
 
 	void para_init(){
-		k_prob = new double[K];
-		for(int i = 0; i < K; i++) {
-      k_prob[i] = 1.0 / K;
-    }
 		doc2topic = new int*[M];
 		for(int i = 0; i < M; i++){
 			doc2topic[i] = new int[K];
@@ -393,37 +388,75 @@ private:
 		return rand() / (RAND_MAX + 1.0);
 	}
 
-	int ran_multinomial(double* prob, int k){
+	// u uniform in [0, 1)
+	int ran_multinomial(double* prob, int k, double u){
 		int i;
 		for(i = 1; i < k; i++) {
 			prob[i] += prob[i - 1];
     }
-		double p = ran_uniform() * prob[k - 1];
+		double p = u * prob[k - 1];
 		for(i = 0; i < k; i++){
 			if(prob[i] > p) break;
 		}
 		return i;
 	}
 
+	// word topic counts a sampling thread changed this round
+	struct topic_delta {
+		std::unordered_map<int, std::vector<int> > words;
+		std::vector<int> sum;
+	};
+
 	void single_iter(){
 		time_t start = time(NULL);
-		for(int doc_id = 0; doc_id < M; doc_id++) {
-			auto tmp_doc = docs[doc_id];
+		// documents are sampled in parallel against the counts of this round,
+		// each thread sees its own changes on top of them and they are merged
+		// afterwards, the way workers share theirs through the servers
+		auto merge = [this] (topic_delta a, const topic_delta & b) {
+			if(a.sum.empty()) a.sum.assign(K, 0);
+			for(auto & kv : b.words) {
+				auto & v = a.words[kv.first];
+				if(v.empty()) v.assign(K, 0);
+				for(int k = 0; k < K; k++) v[k] += kv.second[k];
+			}
+			for(size_t k = 0; k < b.sum.size(); k++) a.sum[k] += b.sum[k];
+			return a;
+		};
+		auto delta = paracel_parallel_reduce((size_t)0, (size_t)M, topic_delta(),
+                                         [this] (size_t doc_id, topic_delta & acc) {
+			static thread_local std::mt19937 rng(std::random_device{}());
+			std::uniform_real_distribution<double> uni(0., 1.);
+			std::vector<double> prob(K);
+			if(acc.sum.empty()) acc.sum.assign(K, 0);
+			auto & tmp_doc = docs[doc_id];
 			int N = tmp_doc.size();
 			for(int word_index = 0; word_index < N; word_index++) {
 				int topic_id = z_index[doc_id][word_index];
 				int word_id = tmp_doc[word_index];
-				remove(doc_id, word_id, topic_id);
-				auto value = word2topic[std::to_string(word_id)];
+				auto & value = word2topic.at(std::to_string(word_id));
+				auto & dv = acc.words[word_id];
+				if(dv.empty()) dv.assign(K, 0);
+				doc2topic[doc_id][topic_id] -= 1;
+				sum_doc2topic[doc_id] -= 1;
+				dv[topic_id] -= 1;
+				acc.sum[topic_id] -= 1;
 				for(int k = 0; k < K; k++) {
-					k_prob[k] = (doc2topic[doc_id][k] + alpha) / (sum_doc2topic[doc_id] + Kalpha) *
-								(value[k] + beta) / (sum_topic2word[k] + Vbeta);
+					prob[k] = (doc2topic[doc_id][k] + alpha) / (sum_doc2topic[doc_id] + Kalpha) *
+								(value[k] + dv[k] + beta) / (sum_topic2word[k] + acc.sum[k] + Vbeta);
 				}
-				topic_id = ran_multinomial(k_prob, K);
+				topic_id = ran_multinomial(&prob[0], K, uni(rng));
 				z_index[doc_id][word_index] = topic_id;
-				add(doc_id, word_id, topic_id);
+				doc2topic[doc_id][topic_id] += 1;
+				sum_doc2topic[doc_id] += 1;
+				dv[topic_id] += 1;
+				acc.sum[topic_id] += 1;
 			}
+		}, merge);
+		for(auto & kv : delta.words) {
+			auto & value = word2topic[std::to_string(kv.first)];
+			for(int k = 0; k < K; k++) value[k] += kv.second[k];
 		}
+		for(size_t k = 0; k < delta.sum.size(); k++) sum_topic2word[k] += delta.sum[k];
 		compute += difftime(time(NULL), start);
 		start = time(NULL);
 		last_word2topic = delta_new(word2topic, last_word2topic);
@@ -489,7 +522,6 @@ private:
 	std::unordered_map<std::string, int> word2id;
 	std::unordered_map<int, std::string> id2word;
 	std::vector<std::string> local_dict_list;
-	double* k_prob;
 	int** doc2topic;
 	std::unordered_map<std::string, std::vector<int> > word2topic;
 	std::unordered_map<std::string, std::vector<int> > last_word2topic;
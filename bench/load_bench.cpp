@@ -0,0 +1,326 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+/**
+ * loader and parser throughput benchmark
+ *   generates synthetic input(like tool/datagen.py, every rank writes its
+ *   share of the files) and times each loader stage on every rank:
+ *     partition  partition::files_partition
+ *     load       scheduler::structure_load(partition::files_load_lines_impl)
+ *     organize   scheduler::lines_organize or triples_organize(not for fvec)
+ *     exchange   scheduler::exchange(not for fvec)
+ *     create     loader::create_graph or create_matrix from the loaded lines
+ *     stream     loader::load_graph or load_matrix, all of the above pipelined
+ *                in chunks of --chunk_lines(not for fvec)
+ *   rank 0 prints seconds, MB/s and lines/s of every stage and rank, the
+ *   byte and line counts are the ones the rank loaded.
+ *
+ *   mpirun -n 4 ./load_bench --kind edge --lines 10000000
+ *   mpirun -n 4 ./load_bench --kind fmap --input /data/fmap_dir
+ *   mpirun -n 4 ./load_bench --kind edge --triple_parser --threads 8
+ */
+
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <iostream>
+#include <functional>
+#include <gflags/gflags.h>
+
+#include "load.hpp"
+#include "graph.hpp"
+#include "utils.hpp"
+#include "utils/thrdpool.hpp"
+
+DEFINE_string(kind, "edge", "edge(src dst weight), fmap(row col:val|col:val) or fvec(id,v1,...,vk)\n");
+DEFINE_string(input, "", "benchmark existing files of --kind instead of generating them\n");
+DEFINE_string(dir, "/tmp/paracel_load_bench", "folder for generated files, must be shared by all ranks\n");
+DEFINE_int64(files, 0, "generated files, 0 for one per rank\n");
+DEFINE_int64(lines, 1000000, "generated lines in total\n");
+DEFINE_int64(vertices, 100000, "vertices of edge input, columns of fmap input\n");
+DEFINE_int64(nnz, 10, "entries per fmap line\n");
+DEFINE_int64(dim, 16, "values per fvec line\n");
+DEFINE_bool(keep, false, "keep generated files\n");
+DEFINE_int64(threads, 1, "threads organizing lines on every rank, 0 for one per core\n");
+DEFINE_int64(chunk_lines, 1 << 18, "lines per chunk of the stream stage\n");
+DEFINE_string(balance, "bytes", "partition blocks by bytes, records or edges\n");
+DEFINE_bool(triple_parser, false, "parse edge and fmap lines with a triple_parser instead of a parser_type\n");
+DEFINE_int64(seed, 2014, "random seed, offset by the file index\n");
+
+namespace paracel {
+namespace bench {
+
+// one generated file holding lines [st, en)
+void gen_file(const paracel::str_type & fn,
+              int64_t st,
+              int64_t en,
+              std::mt19937_64 & rng) {
+  std::uniform_int_distribution<int64_t> vdist(0, FLAGS_vertices - 1);
+  std::uniform_real_distribution<double> rdist(0., 1.);
+  std::ofstream os(fn);
+  if(!os) {
+    throw std::runtime_error("load_bench: can not open " + fn + "\n");
+  }
+  char buf[64];
+  paracel::str_type line;
+  for(int64_t i = st; i < en; ++i) {
+    line.clear();
+    if(FLAGS_kind == "edge") {
+      std::snprintf(buf, sizeof(buf), "%ld %ld %.6f\n",
+                    (long)vdist(rng), (long)vdist(rng), rdist(rng));
+      line += buf;
+    } else if(FLAGS_kind == "fmap") {
+      line += std::to_string(i) + " ";
+      for(int64_t k = 0; k < FLAGS_nnz; ++k) {
+        std::snprintf(buf, sizeof(buf), "%ld:%.6f",
+                      (long)vdist(rng), rdist(rng));
+        line += buf;
+        line += k == FLAGS_nnz - 1 ? '\n' : '|';
+      }
+    } else {
+      line += std::to_string(i);
+      for(int64_t k = 0; k < FLAGS_dim; ++k) {
+        std::snprintf(buf, sizeof(buf), ",%.6f", rdist(rng));
+        line += buf;
+      }
+      line += '\n';
+    }
+    os.write(line.data(), line.size());
+  }
+}
+
+paracel::list_type<paracel::str_type> gen_files(paracel::Comm & comm) {
+  int64_t nfiles = FLAGS_files ? FLAGS_files : comm.get_size();
+  paracel::list_type<paracel::str_type> fns;
+  if(comm.get_rank() == 0) {
+    paracel::str_type cmd = "mkdir -p " + FLAGS_dir;
+    if(std::system(cmd.c_str()) != 0) {
+      throw std::runtime_error("load_bench: can not create " + FLAGS_dir + "\n");
+    }
+  }
+  comm.synchronize();
+  for(int64_t i = 0; i < nfiles; ++i) {
+    fns.push_back(paracel::todir(FLAGS_dir) + FLAGS_kind + "_" + std::to_string(i));
+    if(i % (int64_t)comm.get_size() == (int64_t)comm.get_rank()) {
+      std::mt19937_64 rng(FLAGS_seed + i);
+      gen_file(fns.back(), FLAGS_lines * i / nfiles, FLAGS_lines * (i + 1) / nfiles, rng);
+    }
+  }
+  comm.synchronize();
+  return fns;
+}
+
+class load_bench {
+
+ public:
+  load_bench(paracel::Comm comm,
+             const paracel::list_type<paracel::str_type> & files) :
+      m_comm(comm), fns(files) {
+    if(FLAGS_kind == "edge") {
+      pattern = "fsv";
+      parser = paracel::gen_parser(paracel::parser_a);
+      tparser = paracel::gen_triple_parser();
+    } else if(FLAGS_kind == "fmap") {
+      pattern = "fmap";
+      mix = true;
+      parser = paracel::gen_parser(paracel::parser_b, ' ', '|');
+      tparser = paracel::gen_triple_parser(' ', '|');
+    } else if(FLAGS_kind == "fvec") {
+      pattern = "fvec";
+      parser = paracel::gen_parser(paracel::parser_a, ',');
+    } else {
+      throw std::invalid_argument("load_bench: unknown --kind " + FLAGS_kind + "\n");
+    }
+  }
+
+  void run() {
+    std::unique_ptr<paracel::thrdpool> pool;
+    if(FLAGS_threads != 1) {
+      pool.reset(new paracel::thrdpool(FLAGS_threads));
+    }
+    paracel::scheduler scheduler(m_comm, pattern, mix);
+    scheduler.set_pool(pool.get());
+    paracel::partition partition_obj(fns, m_comm.get_size(), pattern);
+    partition_obj.set_balance(FLAGS_balance);
+    timeit("partition", [&] () { partition_obj.files_partition(); });
+
+    paracel::list_type<paracel::str_type> lines;
+    timeit("load", [&] () { lines = scheduler.structure_load(partition_obj); });
+    for(auto & l : lines) {
+      bytes += l.size() + 1;
+    }
+    nlines = lines.size();
+
+    if(pattern != "fvec") {
+      paracel::list_type<paracel::list_type<paracel::compact_triple_type> > result;
+      timeit("organize", [&] () {
+        if(FLAGS_triple_parser) {
+          scheduler.triples_organize(lines, tparser, result);
+        } else {
+          scheduler.lines_organize(lines, parser, result);
+        }
+      });
+      paracel::list_type<paracel::compact_triple_type> stf;
+      timeit("exchange", [&] () { scheduler.exchange(result, stf); });
+    }
+
+    using loader_type = paracel::loader<paracel::list_type<paracel::str_type> >;
+    auto ld = FLAGS_triple_parser && pattern != "fvec" ?
+        loader_type(fns, m_comm, tparser, pattern, mix) :
+        loader_type(fns, m_comm, parser, pattern, mix);
+    ld.set_pool(pool.get());
+    ld.set_balance(FLAGS_balance);
+    if(pattern == "fsv") {
+      paracel::digraph<paracel::default_id_type> grp;
+      timeit("create", [&] () { ld.create_graph(lines, grp); });
+    } else if(pattern == "fmap") {
+      Eigen::SparseMatrix<double, Eigen::RowMajor> blk_mtx;
+      paracel::dict_type<paracel::default_id_type, paracel::default_id_type> rm, cm;
+      timeit("create", [&] () { ld.create_matrix(lines, blk_mtx, rm, cm); });
+    } else {
+      Eigen::MatrixXd blk_mtx;
+      paracel::dict_type<paracel::default_id_type, paracel::default_id_type> rm;
+      timeit("create", [&] () { ld.create_matrix(lines, blk_mtx, rm); });
+    }
+
+    // the same graph or matrix read, parsed and exchanged chunk by chunk
+    ld.set_chunk_lines(FLAGS_chunk_lines);
+    if(pattern == "fsv") {
+      paracel::digraph<paracel::default_id_type> grp;
+      timeit("stream", [&] () { ld.load_graph(grp); });
+    } else if(pattern == "fmap") {
+      Eigen::SparseMatrix<double, Eigen::RowMajor> blk_mtx;
+      paracel::dict_type<paracel::default_id_type, paracel::default_id_type> rm, cm;
+      timeit("stream", [&] () { ld.load_matrix(blk_mtx, rm, cm); });
+    }
+  }
+
+  // rank 0 prints every rank's stages in rank order
+  void report() {
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(3);
+    for(auto & st : stages) {
+      double mb = bytes / 1048576.;
+      os << std::left << std::setw(6) << m_comm.get_rank()
+          << std::setw(12) << st.first
+          << std::right << std::setw(12) << st.second
+          << std::setw(12) << (st.second > 0 ? mb / st.second : 0.)
+          << std::setw(16) << (st.second > 0 ? nlines / st.second : 0.)
+          << std::setw(12) << mb
+          << std::setw(12) << nlines << '\n';
+    }
+    paracel::list_type<paracel::str_type> rows(m_comm.get_size());
+    auto collect = [&rows] (const paracel::str_type & s) {
+      auto rk = std::stoi(s.substr(0, s.find(' ')));
+      rows[rk] = s;
+    };
+    m_comm.bcastring(os.str(), collect);
+    if(m_comm.get_rank() == 0) {
+      std::cout << "kind " << FLAGS_kind
+          << " pattern " << pattern
+          << " files " << fns.size()
+          << " ranks " << m_comm.get_size() << std::endl;
+      std::cout << std::left << std::setw(6) << "rank"
+          << std::setw(12) << "stage"
+          << std::right << std::setw(12) << "secs"
+          << std::setw(12) << "MB/s"
+          << std::setw(16) << "lines/s"
+          << std::setw(12) << "MB"
+          << std::setw(12) << "lines" << std::endl;
+      for(auto & r : rows) {
+        std::cout << r;
+      }
+    }
+  }
+
+ private:
+  // stages end with a barrier so the slowest rank bounds the next one
+  void timeit(const paracel::str_type & name, std::function<void()> f) {
+    auto t0 = std::chrono::steady_clock::now();
+    f();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    stages.push_back(std::make_pair(name, secs));
+    m_comm.synchronize();
+  }
+
+ private:
+  paracel::Comm m_comm;
+  paracel::list_type<paracel::str_type> fns;
+  paracel::str_type pattern;
+  bool mix = false;
+  paracel::parser_type parser;
+  paracel::triple_parser_type tparser;
+  paracel::list_type<std::pair<paracel::str_type, double> > stages;
+  size_t bytes = 0;
+  size_t nlines = 0;
+
+}; // class load_bench
+
+} // namespace bench
+} // namespace paracel
+
+int main(int argc, char *argv[])
+{
+  paracel::main_env comm_main_env(argc, argv);
+  paracel::Comm comm(MPI_COMM_WORLD);
+
+  google::SetUsageMessage("[options]\n\
+			--kind\n\
+			--input\n\
+			--dir\n\
+			--files\n\
+			--lines\n\
+			--vertices\n\
+			--nnz\n\
+			--dim\n\
+			--keep\n\
+			--threads\n\
+			--chunk_lines\n\
+			--balance\n\
+			--triple_parser\n\
+			--seed\n");
+  google::ParseCommandLineFlags(&argc, &argv, true);
+
+  if(FLAGS_kind != "edge" && FLAGS_kind != "fmap" && FLAGS_kind != "fvec") {
+    std::cerr << "--kind must be edge, fmap or fvec" << std::endl;
+    return 1;
+  }
+  try {
+    paracel::list_type<paracel::str_type> fns;
+    bool generated = FLAGS_input.empty();
+    if(generated) {
+      fns = paracel::bench::gen_files(comm);
+    } else {
+      fns = paracel::expand(FLAGS_input);
+    }
+    paracel::bench::load_bench bench(comm, fns);
+    bench.run();
+    bench.report();
+    if(generated && !FLAGS_keep) {
+      for(size_t i = comm.get_rank(); i < fns.size(); i += comm.get_size()) {
+        std::remove(fns[i].c_str());
+      }
+    }
+  } catch (const std::exception & e) {
+    std::cerr << e.what();
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,278 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+/**
+ * parameter server microbenchmark
+ *   every worker(mpi rank) issues a random mix of ps ops against a shared
+ *   key space and records the latency of each call, rank 0 reports ops/s
+ *   and latency percentiles per op over all workers.
+ *
+ *   mpirun -n 4 ./ps_bench --servers 2 --value_size 64 \
+ *     --mix pull:50,push_multi:25,bupdate:25 \
+ *     --update_file /path/lib/libdefault.so
+ */
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <gflags/gflags.h>
+
+#include "ps.hpp"
+#include "utils.hpp"
+#include "utils/histogram.hpp"
+
+DEFINE_string(server_info, "", "hosts name string of running paracel-servers, empty to start them inside the benchmark\n");
+DEFINE_int64(servers, 1, "servers started inside the benchmark, hosted round-robin by the workers\n");
+DEFINE_bool(embedded, false, "one in-process shard per worker, local keys skip zmq\n");
+DEFINE_int64(keys, 10000, "size of the key space shared by all workers\n");
+DEFINE_int64(value_size, 8, "doubles per value\n");
+DEFINE_int64(ops, 10000, "timed ops per worker\n");
+DEFINE_int64(warmup, 1000, "untimed ops per worker before the timed ones\n");
+DEFINE_int64(batch, 16, "keys per multi op\n");
+DEFINE_string(mix, "pull:60,push:20,bupdate:20", "op:weight list over pull, push, bupdate, pull_multi, push_multi and bupdate_multi\n");
+DEFINE_string(update_file, "", "libdefault.so with absolute path, needed by bupdate ops\n");
+DEFINE_int64(seed, 2014, "random seed, offset by the worker id\n");
+
+namespace paracel {
+namespace bench {
+
+using value_type = paracel::list_type<double>;
+
+// rank r hosts servers r, r + size, ..., return every server's "host:ports" in order
+paracel::str_type start_local_servers(paracel::Comm & comm, int n) {
+  paracel::str_type local;
+  for(int i = comm.get_rank(); i < n; i += comm.get_size()) {
+    local += std::to_string(i) + paracel::seperator_inner
+        + paracel::start_embedded_thrds() + paracel::seperator;
+  }
+  paracel::list_type<paracel::str_type> srvs(n);
+  auto collect = [&srvs] (const paracel::str_type & s) {
+    for(auto & item : paracel::str_split_by_word(s, paracel::seperator)) {
+      if(item.empty()) continue;
+      auto l = paracel::str_split_by_word(item, paracel::seperator_inner);
+      srvs[std::stoi(l[0])] = l[1];
+    }
+  };
+  comm.bcastring(local, collect);
+  paracel::str_type r;
+  for(int i = 0; i < n; ++i) {
+    r += srvs[i];
+    if(i != n - 1) {
+      r += paracel::seperator;
+    }
+  }
+  return r;
+}
+
+class ps_bench : public paracel::paralg {
+
+ public:
+  ps_bench(paracel::Comm comm,
+           const paracel::str_type & hosts_dct_str,
+           const paracel::str_type & mix_str) :
+      paracel::paralg(hosts_dct_str, comm),
+      m_comm(comm),
+      rng(FLAGS_seed + comm.get_rank()),
+      key_dist(0, FLAGS_keys - 1) {
+    paracel::list_type<double> weights;
+    for(auto & item : paracel::str_split(mix_str, ',')) {
+      auto l = paracel::str_split(item, ':');
+      if(l.size() != 2 || !known(l[0])) {
+        throw std::invalid_argument("invalid --mix item: " + item + "\n");
+      }
+      ops.push_back(l[0]);
+      weights.push_back(std::stod(l[1]));
+    }
+    op_dist = std::discrete_distribution<int>(weights.begin(), weights.end());
+    hists.resize(ops.size());
+    val = value_type(FLAGS_value_size, 1.);
+  }
+
+  virtual void solve() {
+    // every worker writes its share of the key space
+    paracel::dict_type<paracel::str_type, value_type> dct;
+    for(int64_t k = get_worker_id(); k < FLAGS_keys; k += get_worker_size()) {
+      dct[key_of(k)] = val;
+      if((int64_t)dct.size() == FLAGS_batch * 64) {
+        paracel_write_multi(dct);
+        dct.clear();
+      }
+    }
+    if(dct.size()) paracel_write_multi(dct);
+    paracel_sync();
+
+    for(int64_t i = 0; i < FLAGS_warmup; ++i) {
+      run_op(op_dist(rng));
+    }
+    paracel_sync();
+    auto t0 = std::chrono::steady_clock::now();
+    for(int64_t i = 0; i < FLAGS_ops; ++i) {
+      int o = op_dist(rng);
+      auto s = std::chrono::steady_clock::now();
+      run_op(o);
+      auto e = std::chrono::steady_clock::now();
+      hists[o].record(std::chrono::duration_cast<std::chrono::nanoseconds>(e - s).count());
+    }
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    paracel_sync();
+  }
+
+  // merge every worker's histograms, rank 0 prints one line per op
+  void report() {
+    double wall = 0.;
+    auto max_wall = [&wall] (double t) { wall = std::max(wall, t); };
+    m_comm.bcastring(elapsed, max_wall);
+
+    paracel::log_histogram all;
+    bool master = get_worker_id() == 0;
+    if(master) {
+      std::cout << "workers " << get_worker_size()
+          << " keys " << FLAGS_keys
+          << " value_size " << FLAGS_value_size
+          << " batch " << FLAGS_batch
+          << " wall " << wall << "s" << std::endl;
+      std::cout << std::left << std::setw(16) << "op"
+          << std::right << std::setw(12) << "count"
+          << std::setw(14) << "ops/s"
+          << std::setw(12) << "avg_us"
+          << std::setw(12) << "p50_us"
+          << std::setw(12) << "p99_us"
+          << std::setw(12) << "max_us" << std::endl;
+    }
+    for(size_t i = 0; i < ops.size(); ++i) {
+      paracel::log_histogram h;
+      auto merge = [&h] (const std::vector<uint64_t> & lst) {
+        h.merge(paracel::log_histogram::from_list(lst));
+      };
+      m_comm.bcastring(hists[i].to_list(), merge);
+      all.merge(h);
+      if(master) print(ops[i], h, wall);
+    }
+    if(master) print("all", all, wall);
+  }
+
+ private:
+  static bool known(const paracel::str_type & op) {
+    return op == "pull" || op == "push" || op == "bupdate" ||
+        op == "pull_multi" || op == "push_multi" || op == "bupdate_multi";
+  }
+
+  static paracel::str_type key_of(int64_t k) {
+    return "bench_" + std::to_string(k);
+  }
+
+  void run_op(int o) {
+    auto & op = ops[o];
+    if(op == "pull") {
+      paracel_read<value_type>(key_of(key_dist(rng)));
+    } else if(op == "push") {
+      paracel_write(key_of(key_dist(rng)), val);
+    } else if(op == "bupdate") {
+      paracel_bupdate(key_of(key_dist(rng)), val, FLAGS_update_file, "default_incr_ld");
+    } else if(op == "pull_multi") {
+      paracel::list_type<paracel::str_type> keys;
+      for(int64_t i = 0; i < FLAGS_batch; ++i) {
+        keys.push_back(key_of(key_dist(rng)));
+      }
+      paracel_read_multi<value_type>(keys);
+    } else {
+      paracel::dict_type<paracel::str_type, value_type> dct;
+      for(int64_t i = 0; i < FLAGS_batch; ++i) {
+        dct[key_of(key_dist(rng))] = val;
+      }
+      if(op == "push_multi") {
+        paracel_write_multi(dct);
+      } else {
+        paracel_bupdate_multi(dct, FLAGS_update_file, "default_incr_ld");
+      }
+    }
+  }
+
+  static void print(const paracel::str_type & name,
+                    const paracel::log_histogram & h,
+                    double wall) {
+    std::cout << std::left << std::setw(16) << name
+        << std::right << std::setw(12) << h.count()
+        << std::setw(14) << std::fixed << std::setprecision(1)
+        << (wall > 0 ? h.count() / wall : 0.)
+        << std::setw(12) << h.mean() / 1000.
+        << std::setw(12) << h.percentile(0.5) / 1000.
+        << std::setw(12) << h.percentile(0.99) / 1000.
+        << std::setw(12) << h.max() / 1000. << std::endl;
+  }
+
+ private:
+  paracel::Comm m_comm;
+  std::mt19937 rng;
+  std::uniform_int_distribution<int64_t> key_dist;
+  std::discrete_distribution<int> op_dist;
+  paracel::list_type<paracel::str_type> ops;
+  paracel::list_type<paracel::log_histogram> hists;
+  value_type val;
+  double elapsed = 0.;
+
+}; // class ps_bench
+
+} // namespace bench
+} // namespace paracel
+
+int main(int argc, char *argv[])
+{
+  paracel::main_env comm_main_env(argc, argv);
+  paracel::Comm comm(MPI_COMM_WORLD);
+
+  google::SetUsageMessage("[options]\n\
+			--server_info\n\
+			--servers\n\
+			--embedded\n\
+			--keys\n\
+			--value_size\n\
+			--ops\n\
+			--warmup\n\
+			--batch\n\
+			--mix\n\
+			--update_file\n\
+			--seed\n");
+  google::ParseCommandLineFlags(&argc, &argv, true);
+
+  if(FLAGS_keys <= 0 || FLAGS_servers <= 0 || FLAGS_batch <= 0) {
+    std::cerr << "--keys, --servers and --batch must be positive" << std::endl;
+    return 1;
+  }
+  if(FLAGS_mix.find("bupdate") != std::string::npos && FLAGS_update_file.empty()) {
+    std::cerr << "bupdate ops need --update_file" << std::endl;
+    return 1;
+  }
+
+  paracel::str_type hosts = FLAGS_server_info;
+  if(FLAGS_embedded) {
+    hosts = paracel::embedded_srv;
+  } else if(hosts.empty()) {
+    hosts = paracel::bench::start_local_servers(comm, FLAGS_servers);
+  }
+  try {
+    paracel::bench::ps_bench bench(comm, hosts, FLAGS_mix);
+    bench.solve();
+    bench.report();
+  } catch (const std::invalid_argument & e) {
+    std::cerr << e.what();
+    return 1;
+  }
+  return 0;
+}
@@ -18,8 +18,12 @@
 
 #include <dlfcn.h>
 #include <assert.h>
+#include <unistd.h>
 
 #include <cstring> // std::memcpy
+#include <mutex>
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <future>
 #include <functional>
@@ -28,100 +32,139 @@
 #include "utils.hpp"
 #include "packer.hpp"
 #include "paracel_types.hpp"
+#include "utils/histogram.hpp"
 #include "utils/ext_utility.hpp"
 
 namespace paracel {
 
+// per-op counters of a kvclt, latency in ns
+struct clt_op_stat {
+  uint64_t cnt = 0;
+  uint64_t bytes_out = 0;
+  uint64_t bytes_in = 0;
+  paracel::log_histogram latency;
+
+  void merge(const clt_op_stat & o) {
+    cnt += o.cnt;
+    bytes_out += o.bytes_out;
+    bytes_in += o.bytes_in;
+    latency.merge(o.latency);
+  }
+};
+
+// ops a kvclt sends, its stats are kept per position in this list
+static const paracel::list_type<paracel::str_type> & clt_op_names() {
+  static const paracel::list_type<paracel::str_type> names = {
+    "contains", "pull", "pull_hot", "pull_multi", "pull_multi_check",
+    "pullall", "pullall_special", "register_pullall_special",
+    "register_remove_special", "register_update", "register_bupdate",
+    "push", "push_multi", "update", "bupdate", "bupdate_multi",
+    "remove", "remove_special", "clear", "snapshot", "snapshot_status",
+    "restore", "stats", "trace_dump", "set_replicas", "replica_push",
+    "replica_del", "push_int", "incr_int", "pull_int", "other"
+  };
+  return names;
+}
+
 struct kvclt {
 
 public:
+  // use_ipc: talk to a server on this very host through its ipc endpoints
   kvclt(paracel::str_type hostname, 
-        paracel::str_type ports) : host(hostname), context(1) {
-    ports_lst = paracel::str_split(ports, ',');
+        paracel::str_type ports,
+        bool use_ipc = true) : host(hostname), context(1) {
+    auto mark = ports.find(paracel::ipc_mark);
+    ports_lst = paracel::str_split(ports.substr(0, mark), ',');
     conn_prefix = "tcp://" + host + ":";
+    if(use_ipc && mark != paracel::str_type::npos && is_local_host(host)) {
+      conn_prefix = paracel::ipc_prefix + ports.substr(mark + 1) + "_";
+    }
+    p_pool.reset(new sock_pool);
+    p_pool->idle.resize(ports_lst.size());
+    p_stats.reset(new clt_stats);
   }
 
   template <class K>
   bool contains(const K & key) {
-    if(p_contains_sock == nullptr) {
-      p_contains_sock.reset(create_req_sock(ports_lst[0]));
-    }
+    auto sock = acquire(0);
     auto scrip = paste(paracel::str_type("contains"), key);
     bool val = false;
-    req_send_recv(*p_contains_sock, scrip, val);
-    //bool r = req_send_recv(*p_contains_sock, scrip, val); assert(r);
+    req_send_recv(*sock, scrip, val);
+    //bool r = req_send_recv(*sock, scrip, val); assert(r);
     return val;
   }
  
   template <class V, class K>
   V pull(const K & key) {
-    if(p_pull_sock == nullptr) {
-      p_pull_sock.reset(create_req_sock(ports_lst[0]));
-    }
+    auto sock = acquire(0);
     auto scrip = paste(paracel::str_type("pull"), key); // paracel::str_type
     V val;
-    bool r = req_send_recv(*p_pull_sock, scrip, val);
+    bool r = req_send_recv(*sock, scrip, val);
     assert(r);
     if(!r) {
       ERROR_ABORT("key does not exist");
     }
-    //while(!r) r = req_send_recv(*p_pull_sock, scrip, val);
+    //while(!r) r = req_send_recv(*sock, scrip, val);
     return val;
   }
   
   template <class V, class K>
   bool pull(const K & key, V & val) {
-    if(p_pull_sock == nullptr) {
-      p_pull_sock.reset(create_req_sock(ports_lst[0]));
-    }
+    auto sock = acquire(0);
     auto scrip = paste(paracel::str_type("pull"), key); // paracel::str_type
-    return req_send_recv(*p_pull_sock, scrip, val);
+    return req_send_recv(*sock, scrip, val);
+  }
+
+  // pull plus the number of copies the server keeps of key(1 without
+  // read replicas)
+  template <class V>
+  bool pull_hot(const paracel::str_type & key, V & val, int & copies) {
+    auto sock = acquire(0);
+    auto scrip = paste(paracel::str_type("pull_hot"), key);
+    zmq::message_t rep_msg;
+    send_recv(*sock, scrip, rep_msg);
+    paracel::str_type data(static_cast<char *>(rep_msg.data()), rep_msg.size());
+    if(data == "nokey" || data.size() < 4) return false;
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data.data());
+    copies = p[0] | p[1] << 8 | p[2] << 16 | p[3] << 24;
+    paracel::packer<V> pk;
+    val = pk.unpack(data.substr(4));
+    return true;
   }
 
   template <class V, class K>
   paracel::list_type<V> pull_multi(const K & key_lst) {
-    if(p_pull_multi_sock == nullptr) {
-      p_pull_multi_sock.reset(create_req_sock(ports_lst[0]));
-    }
+    auto sock = acquire(0);
     auto scrip = paste(paracel::str_type("pull_multi"), key_lst);
     paracel::list_type<V> val;
-    req_send_recv_lst(*p_pull_multi_sock, scrip, val);
+    req_send_recv_lst(*sock, scrip, val);
     return val;
   }
 
   template <class V, class K>
   void pull_multi(const K & key_lst,
                   paracel::dict_type<paracel::str_type, V> & val) {
-    if(p_pull_multi_sock == nullptr) {
-      p_pull_multi_sock.reset(create_req_sock(ports_lst[0]));
-    }
+    auto sock = acquire(0);
     auto scrip = paste(paracel::str_type("pull_multi_check"), key_lst);
-    req_send_recv_dct(*p_pull_multi_sock, scrip, val);
+    req_send_recv_dct(*sock, scrip, val);
   }
 
   // pull all V-type-vals
   template <class V>
   paracel::dict_type<paracel::str_type, V> pullall() {
-    if(p_pullall_sock == nullptr) {
-      p_pullall_sock.reset(create_req_sock(ports_lst[0]));
-    }
+    auto sock = acquire(0);
     auto scrip = paste(paracel::str_type("pullall"));
     paracel::dict_type<paracel::str_type, V> val;
-    req_send_recv_dct(*p_pullall_sock, scrip, val);
+    req_send_recv_dct(*sock, scrip, val);
     return val;
   }
   
   // pull all types, to be unpacked by upper layer themselves
   void pullall(paracel::str_type & val) {
-    if(p_pullall_sock == nullptr) {
-      p_pullall_sock.reset(create_req_sock(ports_lst[0]));
-    }
+    auto sock = acquire(0);
     auto scrip = paste(paracel::str_type("pullall"));
-    zmq::message_t req_msg(scrip.size());
-    std::memcpy((void *)req_msg.data(), &scrip[0], scrip.size());
-    (*p_pullall_sock).send(req_msg);
     zmq::message_t rep_msg;
-    (*p_pullall_sock).recv(&rep_msg);
+    send_recv(*sock, scrip, rep_msg);
     if(!rep_msg.size()) {
       ERROR_ABORT("paracel internal error!");
     } 
@@ -132,12 +175,10 @@ public:
 
   template <class V>
   paracel::dict_type<paracel::str_type, V> pullall_special() {
-    if(p_pullall_sock == nullptr) {
-      p_pullall_sock.reset(create_req_sock(ports_lst[0]));
-    }
+    auto sock = acquire(0);
     auto scrip = paste(paracel::str_type("pullall_special"));
     paracel::dict_type<paracel::str_type, V> val;
-    req_send_recv_dct(*p_pullall_sock, scrip, val);
+    req_send_recv_dct(*sock, scrip, val);
     return val;
   }
 
@@ -145,86 +186,83 @@ public:
   paracel::dict_type<paracel::str_type, V> 
   pullall_special(const paracel::str_type & so_filename,
                   const paracel::str_type & func_name) {
-    if(p_pullall_sock == nullptr) {
-      p_pullall_sock.reset(create_req_sock(ports_lst[0]));
-    }
+    auto sock = acquire(0);
     auto scrip = paste(paracel::str_type("pullall_special"),
                        so_filename, 
                        func_name);
     paracel::dict_type<paracel::str_type, V> val;
-    req_send_recv_dct(*p_pullall_sock, scrip, val);
+    req_send_recv_dct(*sock, scrip, val);
     return val;
   }
   
   bool register_pullall_special(const paracel::str_type & file_name, 
                                 const paracel::str_type & func_name) {
-    if(p_pullall_sock == nullptr) {
-      p_pullall_sock.reset(create_req_sock(ports_lst[0]));
-    }
+    auto sock = acquire(0);
     auto scrip = paste(paracel::str_type("register_pullall_special"), 
                        file_name, 
                        func_name); 
     bool stat;
-    auto r = req_send_recv(*p_pullall_sock, scrip, stat);
+    auto r = req_send_recv(*sock, scrip, stat);
     return r && stat;
   }
   
   bool register_remove_special(const paracel::str_type & file_name,
                                const paracel::str_type & func_name) {
-    if(p_remove_sock == nullptr) {
-      p_remove_sock.reset(create_req_sock(ports_lst[0]));
-    }
+    auto sock = acquire(0);
     auto scrip = paste(paracel::str_type("register_remove_special"), 
                        file_name, 
                        func_name); 
     bool stat;
-    auto r = req_send_recv(*p_remove_sock, scrip, stat);
+    auto r = req_send_recv(*sock, scrip, stat);
     return r && stat;
   }
 
   bool register_update(const paracel::str_type & file_name,
                        const paracel::str_type & func_name) {
-    if(p_update_sock == nullptr) {
-      p_update_sock.reset(create_push_sock(ports_lst[2]));
-    }
+    auto sock = acquire(2);
     auto scrip = paste(paracel::str_type("register_update"), 
                        file_name, 
                        func_name); 
     bool stat;
-    auto r = req_send_recv(*p_update_sock, scrip, stat);
+    auto r = req_send_recv(*sock, scrip, stat);
     return r && stat;
   }
   
   bool register_bupdate(const paracel::str_type & file_name,
                         const paracel::str_type & func_name) {
-    if(p_bupdate_sock == nullptr) {
-      p_bupdate_sock.reset(create_req_sock(ports_lst[3]));
-    }
+    auto sock = acquire(3);
     auto scrip = paste(paracel::str_type("register_bupdate"), 
                        file_name, 
                        func_name); 
     bool stat;
-    auto r = req_send_recv(*p_bupdate_sock, scrip, stat);
+    auto r = req_send_recv(*sock, scrip, stat);
     return r && stat;
   }
   
   template <class K, class V>
   bool push(const K & key, const V & val) {
-    if(p_push_sock == nullptr) {
-      p_push_sock.reset(create_req_sock(ports_lst[1]));
-    }
+    auto sock = acquire(1);
     auto scrip = paste(paracel::str_type("push"), key, val); 
     bool stat;
-    auto r = req_send_recv(*p_push_sock, scrip, stat);
+    auto r = req_send_recv(*sock, scrip, stat);
     return r && stat;
   }
   
+  // the server(owner of key) copies key to the servers(hosts, ports) from now on
+  bool set_replicas(const paracel::str_type & key,
+                    const paracel::list_type<paracel::str_type> & hosts,
+                    const paracel::list_type<paracel::str_type> & ports) {
+    auto sock = acquire(1);
+    auto scrip = paste(paracel::str_type("set_replicas"), key, hosts, ports);
+    bool stat;
+    auto r = req_send_recv(*sock, scrip, stat);
+    return r && stat;
+  }
+
   template <class K, class V>
   bool push_multi(const paracel::list_type<K> & key_lst, 
                   const paracel::list_type<V> & val_lst) {
-    if(p_push_multi_sock == nullptr) {
-      p_push_multi_sock.reset(create_req_sock(ports_lst[1]));
-    }
+    auto sock = acquire(1);
     paracel::list_type<paracel::str_type> pack_val_lst;
     for(auto & val : val_lst) {
       paracel::packer<V> pk(val);
@@ -236,15 +274,12 @@ public:
                        key_lst, 
                        pack_val_lst);
     bool stat;
-    auto r = req_send_recv(*p_push_multi_sock, scrip, stat);
+    auto r = req_send_recv(*sock, scrip, stat);
     return r && stat;
   }
   
   template <class K, class V>
   bool push_multi(const paracel::dict_type<K, V> & dct) {
-    if(p_push_multi_sock == nullptr) {
-      p_push_multi_sock.reset(create_req_sock(ports_lst[1]));
-    } 
     paracel::list_type<K> key_lst;
     paracel::list_type<V> val_lst;
     for(auto & kv : dct) {
@@ -258,13 +293,12 @@ public:
   void update(const K & key, 
               const V & delta,
               paracel::async_functor_type & update_future) {
-    if(p_update_sock == nullptr) {
-      p_update_sock.reset(create_push_sock(ports_lst[2]));
-    }
     auto scrip = paste(paracel::str_type("update"), key, delta);
+    // runs on the async thread, so check out a socket there
     auto update_lambda = [this, scrip] () -> bool {
+      auto sock = acquire(2);
       V val;
-      return req_send_recv(*p_update_sock, scrip, val);
+      return req_send_recv(*sock, scrip, val);
     };
     update_future = std::async(std::launch::async, update_lambda);
   }
@@ -275,17 +309,16 @@ public:
               const paracel::str_type & file_name, 
               const paracel::str_type & func_name,
               paracel::async_functor_type & update_future) {
-    if(p_update_sock == nullptr) {
-      p_update_sock.reset(create_push_sock(ports_lst[2]));
-    }
     auto scrip = paste(paracel::str_type("update"), 
                        key,
                        delta,
                        file_name,
                        func_name);
+    // runs on the async thread, so check out a socket there
     auto update_lambda = [this, scrip] () -> bool {
+      auto sock = acquire(2);
       V val;
-      return req_send_recv(*p_update_sock, scrip, val);
+      return req_send_recv(*sock, scrip, val);
     };
     update_future = std::async(std::launch::async, update_lambda);
   }
@@ -294,12 +327,10 @@ public:
   V bupdate(const K & key,
             const V & delta,
             bool & r) {
-    if(p_bupdate_sock == nullptr) {
-      p_bupdate_sock.reset(create_req_sock(ports_lst[3]));
-    }
+    auto sock = acquire(3);
     auto scrip = paste(paracel::str_type("bupdate"), key, delta);
     V val;
-    r = req_send_recv(*p_bupdate_sock, scrip, val);
+    r = req_send_recv(*sock, scrip, val);
     return val;
   }
 
@@ -309,16 +340,14 @@ public:
             const paracel::str_type & file_name,
             const paracel::str_type & func_name,
             bool & r) {
-    if(p_bupdate_sock == nullptr) {
-      p_bupdate_sock.reset(create_req_sock(ports_lst[3]));
-    }
+    auto sock = acquire(3);
     auto scrip = paste(paracel::str_type("bupdate"),
                        key,
                        delta,
                        file_name,
                        func_name);
     V val;
-    r = req_send_recv(*p_bupdate_sock, scrip, val);
+    r = req_send_recv(*sock, scrip, val);
     return val;
   }
 
@@ -326,9 +355,7 @@ public:
   paracel::list_type<V> bupdate_multi(const paracel::list_type<K> & key_lst,
                                       const paracel::list_type<V> & val_lst,
                                       bool & r) {
-    if(p_bupdate_multi_sock == nullptr) {
-      p_bupdate_multi_sock.reset(create_req_sock(ports_lst[3]));
-    }
+    auto sock = acquire(3);
     paracel::list_type<paracel::str_type> pack_val_lst;
     for(auto & val : val_lst) {
       paracel::packer<V> pk(val);
@@ -340,7 +367,7 @@ public:
                        key_lst,
                        pack_val_lst);
     paracel::list_type<V> val;
-    req_send_recv_lst(*p_bupdate_multi_sock, scrip, val);
+    req_send_recv_lst(*sock, scrip, val);
     r = true;
     return val;
   }
@@ -351,9 +378,7 @@ public:
                                       const paracel::str_type & file_name,
                                       const paracel::str_type & func_name,
                                       bool & r) {
-    if(p_bupdate_multi_sock == nullptr) {
-      p_bupdate_multi_sock.reset(create_req_sock(ports_lst[3]));
-    }
+    auto sock = acquire(3);
     paracel::list_type<paracel::str_type> pack_val_lst;
     for(auto & val : val_lst) {
       paracel::packer<V> pk(val);
@@ -367,7 +392,7 @@ public:
                        file_name,
                        func_name);
     paracel::list_type<V> val;
-    req_send_recv_lst(*p_bupdate_multi_sock, scrip, val);
+    req_send_recv_lst(*sock, scrip, val);
     r = true;
     return val;
   }
@@ -375,9 +400,6 @@ public:
   template <class K, class V>
   paracel::list_type<V> bupdate_multi(const paracel::dict_type<K, V> & dct,
                                       bool & r) {
-    if(p_bupdate_multi_sock == nullptr) {
-      p_bupdate_multi_sock.reset(create_req_sock(ports_lst[3]));
-    }
     paracel::list_type<K> key_lst;
     paracel::list_type<V> val_lst;
     for(auto & kv : dct) {
@@ -392,9 +414,6 @@ public:
                                       const paracel::str_type & file_name,
                                       const paracel::str_type & func_name,
                                       bool & r) {
-    if(p_bupdate_multi_sock == nullptr) {
-      p_bupdate_multi_sock.reset(create_req_sock(ports_lst[3]));
-    }
     paracel::list_type<K> key_lst;
     paracel::list_type<V> val_lst;
     for(auto & kv : dct) {
@@ -410,82 +429,156 @@ public:
 
   template <class K>
   bool remove(const K & key) {
-    if(p_remove_sock == nullptr) {
-      p_remove_sock.reset(create_req_sock(ports_lst[0]));
-    }
+    auto sock = acquire(0);
     auto scrip = paste(paracel::str_type("remove"), key);
     bool val;
-    auto r = req_send_recv(*p_remove_sock, scrip, val);
+    auto r = req_send_recv(*sock, scrip, val);
     return r && val;
   }
 
+  // server to server: copy ver of a replica, val is the packed value,
+  // older versions than the one held are dropped
+  bool replica_push(const paracel::str_type & key,
+                    uint64_t ver,
+                    const paracel::str_type & val) {
+    auto sock = acquire(0);
+    auto scrip = paste(paracel::str_type("replica_push"), key, ver, val);
+    bool stat;
+    auto r = req_send_recv(*sock, scrip, stat);
+    return r && stat;
+  }
+
+  bool replica_del(const paracel::str_type & key, uint64_t ver) {
+    auto sock = acquire(0);
+    auto scrip = paste(paracel::str_type("replica_del"), key, ver);
+    bool stat;
+    auto r = req_send_recv(*sock, scrip, stat);
+    return r && stat;
+  }
+
   bool remove_special() {
-    if(p_remove_sock == nullptr) {
-      p_remove_sock.reset(create_req_sock(ports_lst[0]));
-    }
+    auto sock = acquire(0);
     auto scrip = paste(paracel::str_type("remove_special"));
     bool val;
-    auto r = req_send_recv(*p_remove_sock, scrip, val);
+    auto r = req_send_recv(*sock, scrip, val);
     return r && val;
   }
 
   bool remove_special(const paracel::str_type & file_name,
                       const paracel::str_type & func_name) {
-    if(p_remove_sock == nullptr) {
-      p_remove_sock.reset(create_req_sock(ports_lst[0]));
-    }
+    auto sock = acquire(0);
     auto scrip = paste(paracel::str_type("remove_special"),
                        file_name,
                        func_name);
     bool val;
-    auto r = req_send_recv(*p_remove_sock, scrip, val);
+    auto r = req_send_recv(*sock, scrip, val);
     return r && val;
   }
 
   bool clear() {
-    if(p_clear_sock == nullptr) {
-      p_clear_sock.reset(create_req_sock(ports_lst[0]));
-    }
+    auto sock = acquire(0);
     auto scrip = paste(paracel::str_type("clear"));
     bool val;
-    auto r = req_send_recv(*p_clear_sock, scrip, val);
+    auto r = req_send_recv(*sock, scrip, val);
     return r && val;
   }
   
+  // fn is a path on the server host, the dump finishes in background(see
+  // snapshot_status)
+  bool snapshot(const paracel::str_type & fn) {
+    auto sock = acquire(0);
+    auto scrip = paste(paracel::str_type("snapshot"), fn);
+    bool val;
+    auto r = req_send_recv(*sock, scrip, val);
+    return r && val;
+  }
+
+  // 0 while the last snapshot is being dumped, 1 once it is complete on
+  // disk, -1 if it failed(or none was taken)
+  int snapshot_status() {
+    auto sock = acquire(0);
+    auto scrip = paste(paracel::str_type("snapshot_status"));
+    int val = -1;
+    auto r = req_send_recv(*sock, scrip, val);
+    return r ? val : -1;
+  }
+
+  bool restore(const paracel::str_type & fn) {
+    auto sock = acquire(0);
+    auto scrip = paste(paracel::str_type("restore"), fn);
+    bool val;
+    auto r = req_send_recv(*sock, scrip, val);
+    return r && val;
+  }
+
+  // text report of the server's op and hot key stats, see srv_stats.hpp
+  paracel::str_type stats(bool reset = false) {
+    auto sock = acquire(0);
+    auto scrip = paste(paracel::str_type("stats"), reset);
+    paracel::str_type val;
+    req_send_recv(*sock, scrip, val);
+    return val;
+  }
+
+  // the server writes its trace events(see utils/trace.hpp) to fn on its host
+  bool trace_dump(const paracel::str_type & fn, int pid) {
+    auto sock = acquire(0);
+    auto scrip = paste(paracel::str_type("trace_dump"), fn, pid);
+    bool val;
+    auto r = req_send_recv(*sock, scrip, val);
+    return r && val;
+  }
+
+  // what this client sent so far, by op name
+  paracel::dict_type<paracel::str_type, clt_op_stat> get_stats() {
+    paracel::dict_type<paracel::str_type, clt_op_stat> r;
+    auto & names = clt_op_names();
+    std::lock_guard<std::mutex> lk(p_stats->mtx);
+    for(auto & blk : p_stats->blocks) {
+      std::lock_guard<std::mutex> blk_lk(blk->mtx);
+      for(size_t i = 0; i < names.size(); ++i) {
+        if(blk->ops[i]) r[names[i]].merge(*blk->ops[i]);
+      }
+    }
+    return r;
+  }
+
+  void reset_stats() {
+    std::lock_guard<std::mutex> lk(p_stats->mtx);
+    for(auto & blk : p_stats->blocks) {
+      std::lock_guard<std::mutex> blk_lk(blk->mtx);
+      for(auto & op : blk->ops) op.reset();
+    }
+  }
+
   // ports_lst[4]: built-in sock ops for ssp(ps layer) usage
   bool push_int(const paracel::str_type & key,
                 int val) {
-    if(p_ssp_sock == nullptr) {
-      p_ssp_sock.reset(create_req_sock(ports_lst[4]));
-    }
+    auto sock = acquire(4);
     auto scrip = paste(paracel::str_type("push_int"),
                        key,
                        val); 
     bool stat = true;
-    auto r = req_send_recv(*p_ssp_sock, scrip, stat);
+    auto r = req_send_recv(*sock, scrip, stat);
     return r && stat;
   }
   
   bool incr_int(const paracel::str_type & key,
                 int delta) {
-    if(p_ssp_sock == nullptr) {
-      p_ssp_sock.reset(create_req_sock(ports_lst[4]));
-    }
+    auto sock = acquire(4);
     auto scrip = paste(paracel::str_type("incr_int"),
                        key,
                        delta);
     bool stat;
-    auto r = req_send_recv(*p_ssp_sock, scrip, stat);
+    auto r = req_send_recv(*sock, scrip, stat);
     return r && stat;
   }
   
   int pull_int(const paracel::str_type & key) {
-    if(p_ssp_sock == nullptr) {
-      p_ssp_sock.reset(create_req_sock(ports_lst[4]));
-    }
+    auto sock = acquire(4);
     auto scrip = paste(paracel::str_type("pull_int"), key);
     int val = -1;
-    bool r = req_send_recv(*p_ssp_sock, scrip, val);
+    bool r = req_send_recv(*sock, scrip, val);
     assert(val != -1);
     assert(r);
     if(!r) ERROR_ABORT("key: pull_int does not exist");
@@ -493,27 +586,158 @@ public:
   }
 
   bool pull_int(const paracel::str_type & key, int & val) {
-    if(p_ssp_sock == nullptr) {
-      p_ssp_sock.reset(create_req_sock(ports_lst[4]));
-    }
+    auto sock = acquire(4);
     auto scrip = paste(paracel::str_type("pull_int"), key);
-    return req_send_recv(*p_ssp_sock, scrip, val);
+    return req_send_recv(*sock, scrip, val);
   }
   
 private:
 
-  zmq::socket_t*
-  create_req_sock(const paracel::str_type & port) {
-    zmq::socket_t *p_sock = new zmq::socket_t(context, ZMQ_REQ);
-    auto info = conn_prefix + port;
-    p_sock->connect(info.c_str());
-    return p_sock;
+  // a socket checked out of the pool, handed back when it goes out of scope
+  class sock_handle {
+   public:
+    sock_handle(kvclt *clt, size_t indx, zmq::socket_t *p) : 
+        owner(clt), port_indx(indx), p_sock(p) {}
+
+    sock_handle(sock_handle && other) : owner(other.owner),
+                                        port_indx(other.port_indx),
+                                        p_sock(other.p_sock) {
+      other.p_sock = nullptr;
+    }
+
+    sock_handle(const sock_handle &) = delete;
+
+    ~sock_handle() {
+      if(p_sock) owner->release(port_indx, p_sock);
+    }
+
+    zmq::socket_t & operator*() { return *p_sock; }
+
+   private:
+    kvclt *owner;
+    size_t port_indx;
+    zmq::socket_t *p_sock;
+  };
+
+  // idle REQ sockets per port, shared by every thread calling this kvclt
+  struct sock_pool {
+    ~sock_pool() {
+      for(auto & lst : idle) {
+        for(auto p : lst) delete p;
+      }
+    }
+    std::mutex mtx;
+    paracel::list_type<paracel::list_type<zmq::socket_t *> > idle;
+  };
+
+  /**
+   * every thread counts into its own block, indexed like clt_op_names, so
+   * requests never wait on each other. a block's lock is only contended
+   * while get_stats/reset_stats visit it
+   */
+  struct clt_stats {
+    struct block {
+      std::mutex mtx;
+      paracel::list_type<std::unique_ptr<clt_op_stat> > ops;
+    };
+
+    clt_stats() {
+      static std::atomic<uint64_t> next_id(0);
+      id = next_id++;
+    }
+
+    block & local() {
+      static thread_local uint64_t last_id = (uint64_t)-1;
+      static thread_local block *last = NULL;
+      if(last_id == id) return *last;
+      static thread_local paracel::dict_type<uint64_t, std::shared_ptr<block> > mine;
+      auto & p = mine[id];
+      if(!p) {
+        p = std::make_shared<block>();
+        p->ops.resize(clt_op_names().size());
+        std::lock_guard<std::mutex> lk(mtx);
+        blocks.push_back(p);
+      }
+      last_id = id;
+      last = p.get();
+      return *p;
+    }
+
+    uint64_t id;
+    std::mutex mtx; // guards blocks
+    paracel::list_type<std::shared_ptr<block> > blocks;
+  };
+
+  // position in clt_op_names of the op whose packed name leads scrip, the
+  // packed size in front keeps a name from matching a longer one
+  static size_t op_index(const paracel::str_type & scrip) {
+    static const paracel::list_type<paracel::str_type> packed = [] {
+      paracel::list_type<paracel::str_type> r;
+      for(auto & name : clt_op_names()) {
+        paracel::packer<paracel::str_type> pk(name);
+        paracel::str_type s;
+        pk.pack(s);
+        r.push_back(s);
+      }
+      return r;
+    }();
+    for(size_t i = 0; i + 1 < packed.size(); ++i) {
+      if(scrip.compare(0, packed[i].size(), packed[i]) == 0) return i;
+    }
+    return packed.size() - 1;
+  }
+
+  // one round trip, accounted to the op whose packed name leads scrip
+  void send_recv(zmq::socket_t & sock,
+                 const paracel::str_type & scrip,
+                 zmq::message_t & rep_msg) {
+    auto t0 = std::chrono::steady_clock::now();
+    zmq::message_t req_msg(scrip.size());
+    std::memcpy((void *)req_msg.data(), &scrip[0], scrip.size());
+    sock.send(req_msg);
+    sock.recv(&rep_msg);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - t0).count();
+    auto & blk = p_stats->local();
+    std::lock_guard<std::mutex> lk(blk.mtx);
+    auto & p = blk.ops[op_index(scrip)];
+    if(!p) p.reset(new clt_op_stat);
+    auto & st = *p;
+    st.cnt += 1;
+    st.bytes_out += scrip.size();
+    st.bytes_in += rep_msg.size();
+    st.latency.record(ns);
+  }
+
+  // a REQ socket is exclusive to one thread until its handle is released
+  sock_handle acquire(size_t port_indx) {
+    {
+      std::lock_guard<std::mutex> lk(p_pool->mtx);
+      auto & lst = p_pool->idle[port_indx];
+      if(!lst.empty()) {
+        zmq::socket_t *p_sock = lst.back();
+        lst.pop_back();
+        return sock_handle(this, port_indx, p_sock);
+      }
+    }
+    return sock_handle(this, port_indx, create_req_sock(ports_lst[port_indx]));
+  }
+
+  void release(size_t port_indx, zmq::socket_t *p_sock) {
+    std::lock_guard<std::mutex> lk(p_pool->mtx);
+    p_pool->idle[port_indx].push_back(p_sock);
+  }
+
+  static bool is_local_host(const paracel::str_type & hostname) {
+    char local[1024];
+    if(gethostname(local, sizeof(local)) != 0) return false;
+    local[sizeof(local) - 1] = '\0';
+    return hostname == paracel::str_type(local);
   }
 
   zmq::socket_t*
-  create_push_sock(const paracel::str_type & port) {
+  create_req_sock(const paracel::str_type & port) {
     zmq::socket_t *p_sock = new zmq::socket_t(context, ZMQ_REQ);
-    //zmq::socket_t *p_sock = new zmq::socket_t(context, ZMQ_PUSH);
     auto info = conn_prefix + port;
     p_sock->connect(info.c_str());
     return p_sock;
@@ -542,11 +766,8 @@ private:
   bool req_send_recv(zmq::socket_t & sock, 
                      const paracel::str_type & scrip, 
                      V & val) {
-    zmq::message_t req_msg(scrip.size());
-    std::memcpy((void *)req_msg.data(), &scrip[0], scrip.size());
-    sock.send(req_msg);
     zmq::message_t rep_msg;
-    sock.recv(&rep_msg);
+    send_recv(sock, scrip, rep_msg);
     paracel::packer<V> pk;
     if(!rep_msg.size()) {
       ERROR_ABORT("paracel internal error!");
@@ -564,11 +785,8 @@ private:
   void req_send_recv_dct(zmq::socket_t & sock, 
                          const paracel::str_type & scrip, 
 			paracel::dict_type<paracel::str_type, V> & val) {
-    zmq::message_t req_msg(scrip.size());
-    std::memcpy((void *)req_msg.data(), &scrip[0], scrip.size());
-    sock.send(req_msg);
     zmq::message_t rep_msg;
-    sock.recv(&rep_msg);
+    send_recv(sock, scrip, rep_msg);
     paracel::packer<paracel::dict_type<paracel::str_type, paracel::str_type> > pk;
     paracel::packer<V> pk2;
     if(!rep_msg.size()) {
@@ -588,11 +806,8 @@ private:
   void req_send_recv_lst(zmq::socket_t & sock, 
                          const paracel::str_type & scrip, 
                          paracel::list_type<V> & val) {
-    zmq::message_t req_msg(scrip.size());
-    std::memcpy((void *)req_msg.data(), &scrip[0], scrip.size());
-    sock.send(req_msg);
     zmq::message_t rep_msg;
-    sock.recv(&rep_msg);
+    send_recv(sock, scrip, rep_msg);
     paracel::packer<paracel::list_type<paracel::str_type> > pk;
     paracel::packer<V> pk2;
     if(!rep_msg.size()) {
@@ -613,18 +828,8 @@ private:
   paracel::list_type<paracel::str_type> ports_lst;
   paracel::str_type conn_prefix;
   zmq::context_t context;
-  std::unique_ptr<zmq::socket_t> p_contains_sock = nullptr;
-  std::unique_ptr<zmq::socket_t> p_pull_sock = nullptr;
-  std::unique_ptr<zmq::socket_t> p_pull_multi_sock = nullptr;
-  std::unique_ptr<zmq::socket_t> p_pullall_sock = nullptr;
-  std::unique_ptr<zmq::socket_t> p_push_sock = nullptr;
-  std::unique_ptr<zmq::socket_t> p_push_multi_sock = nullptr;
-  std::unique_ptr<zmq::socket_t> p_update_sock = nullptr;
-  std::unique_ptr<zmq::socket_t> p_bupdate_sock = nullptr;
-  std::unique_ptr<zmq::socket_t> p_bupdate_multi_sock = nullptr;
-  std::unique_ptr<zmq::socket_t> p_remove_sock = nullptr;
-  std::unique_ptr<zmq::socket_t> p_clear_sock = nullptr;
-  std::unique_ptr<zmq::socket_t> p_ssp_sock = nullptr;
+  std::unique_ptr<sock_pool> p_pool;
+  std::unique_ptr<clt_stats> p_stats;
 
 }; // struct kvclt 
 
@@ -0,0 +1,54 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#ifndef FILE_901af08f_3983_4c21_aae1_128d8ab8a07a_HPP
+#define FILE_901af08f_3983_4c21_aae1_128d8ab8a07a_HPP
+
+#include "paracel_types.hpp"
+
+namespace paracel {
+
+/**
+ * server shards hosted by the calling process(embedded mode)
+ *   the server table, its lock and threads live in libembedded(src/embedded.cpp)
+ *   so one copy exists per process however many objects include this header
+ */
+
+// serve the table from threads of this process, return the same
+// "hostname:ports" string a standalone server reports
+paracel::str_type start_embedded_thrds();
+
+// send out the replica copies(see replicator.hpp) still queued, then stop
+// the forwarding thread. every shard they go to must still be serving
+void drain_embedded_forwards();
+
+// stop and join every shard started above, no request may be in flight
+void stop_embedded_thrds();
+
+// direct access to the in-process table, under the server lock
+bool embedded_get(const paracel::str_type & key, paracel::str_type & val);
+
+void embedded_set(const paracel::str_type & key, const paracel::str_type & val);
+
+bool embedded_contains(const paracel::str_type & key);
+
+bool embedded_del(const paracel::str_type & key);
+
+// copies of key the in-process shard keeps(see replicator.hpp)
+int embedded_copies(const paracel::str_type & key);
+
+} // namespace paracel
+
+#endif
@@ -166,6 +166,22 @@ public:
     return kvdct;
   }
 
+  // visit every pair without copying the table
+  template <class F>
+  void traverse(F func) const {
+    for(auto & kv : kvdct) {
+      func(kv.first, kv.second);
+    }
+  }
+
+  size_t size() const {
+    return kvdct.size();
+  }
+
+  void reserve(size_t n) {
+    kvdct.reserve(n);
+  }
+
 private:
   //std::tr1::unordered_map<K, V> kvdct;
   paracel::dict_type<K, V> kvdct;
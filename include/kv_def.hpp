@@ -18,10 +18,11 @@
 
 #include "paracel_types.hpp"
 #include "kv.hpp"
+#include "tiered_kv.hpp"
 
 namespace paracel {
   paracel::kvs<paracel::str_type, int> ssp_tbl;
-  paracel::kvs<paracel::str_type, paracel::str_type> tbl_store;
+  paracel::tiered_kvs tbl_store;
 }
 
 #endif
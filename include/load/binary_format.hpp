@@ -0,0 +1,297 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#ifndef FILE_3bf20f58_be19_4e99_94f4_4c0161ce56b0_HPP
+#define FILE_3bf20f58_be19_4e99_94f4_4c0161ce56b0_HPP
+
+#include <stdint.h>
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "paracel_types.hpp"
+#include "load/line_reader.hpp"
+
+namespace paracel {
+
+/**
+ * paracel binary input, written by tool/text2bin, read by the loader
+ *   every field is a native(little-endian) 8 byte word so each array below
+ *   starts 8 byte aligned in the mapped file and is read in place.
+ *
+ *   file   := header | block * n_blocks | index
+ *   header := magic "PRCLBIN\0" | version(1) | byte_order(0x0102030405060708)
+ *             | kind | dim | n_blocks | index_off | n_rows | n_vals
+ *   index  := n_blocks x (off, rows, nnz)
+ *
+ *   kind csr, a block of rows of a sparse matrix or adjacency lists:
+ *     block := row_ids[rows] | row_ptr[rows + 1] | col_ids[nnz] | vals[nnz]
+ *     row_ptr is relative to the block, a row id may repeat across rows.
+ *   kind dense, a block of rows of a dim columns matrix(the fvec pattern):
+ *     block := row_ids[rows] | vals[rows * dim], row-major
+ */
+namespace binary {
+
+enum kind_type : uint64_t {
+  csr = 1,
+  dense = 2
+};
+
+struct header {
+  char magic[8];
+  uint64_t version;
+  uint64_t byte_order;
+  uint64_t kind;
+  uint64_t dim;
+  uint64_t n_blocks;
+  uint64_t index_off;
+  uint64_t n_rows;
+  uint64_t n_vals;
+};
+
+struct index_entry {
+  uint64_t off;
+  uint64_t rows;
+  uint64_t nnz;
+};
+
+static const char magic[8] = {'P', 'R', 'C', 'L', 'B', 'I', 'N', '\0'};
+static const uint64_t version = 1;
+static const uint64_t byte_order = 0x0102030405060708ULL;
+
+// views into a mapped block, nnz is rows * dim for dense blocks
+struct block {
+  uint64_t rows = 0;
+  uint64_t nnz = 0;
+  const uint64_t *row_ids = NULL;
+  const uint64_t *row_ptr = NULL;
+  const uint64_t *col_ids = NULL;
+  const double *vals = NULL;
+};
+
+// whether fn starts with the binary magic, false for unreadable files
+inline bool is_binary(const paracel::str_type & fn) {
+  char buf[8];
+  std::ifstream is(fn, std::ios::binary);
+  if(!is.read(buf, sizeof(buf))) return false;
+  return std::memcmp(buf, magic, sizeof(buf)) == 0;
+}
+
+/**
+ * append rows, a block is flushed every block_rows rows. close(or the
+ * destructor) writes the index and the final header
+ */
+class writer {
+
+ public:
+  writer(const paracel::str_type & fn,
+         kind_type k,
+         uint64_t d = 0,
+         uint64_t blk_rows = 65536) : os(fn, std::ios::binary | std::ios::trunc),
+                                      block_rows(blk_rows ? blk_rows : 1) {
+    if(!os) {
+      throw std::runtime_error("binary::writer: can not open " + fn + "\n");
+    }
+    std::memset(&hdr, 0, sizeof(hdr));
+    std::memcpy(hdr.magic, magic, sizeof(magic));
+    hdr.version = version;
+    hdr.byte_order = byte_order;
+    hdr.kind = k;
+    hdr.dim = d;
+    os.write(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    row_ptr.push_back(0);
+  }
+
+  writer(const writer &) = delete;
+
+  writer & operator=(const writer &) = delete;
+
+  ~writer() {
+    try { close(); } catch (...) {}
+  }
+
+  // csr row: n (col_id, val) pairs
+  void add_row(uint64_t id, const uint64_t *cols, const double *vs, size_t n) {
+    if(hdr.kind != csr) {
+      throw std::invalid_argument("binary::writer: add_row with cols on a dense file\n");
+    }
+    row_ids.push_back(id);
+    col_ids.insert(col_ids.end(), cols, cols + n);
+    vals.insert(vals.end(), vs, vs + n);
+    row_ptr.push_back(col_ids.size());
+    if(row_ids.size() == block_rows) flush();
+  }
+
+  // dense row of dim values
+  void add_row(uint64_t id, const double *vs) {
+    if(hdr.kind != dense) {
+      throw std::invalid_argument("binary::writer: dense add_row on a csr file\n");
+    }
+    row_ids.push_back(id);
+    vals.insert(vals.end(), vs, vs + hdr.dim);
+    if(row_ids.size() == block_rows) flush();
+  }
+
+  void close() {
+    if(closed) return;
+    closed = true;
+    flush();
+    hdr.n_blocks = index.size();
+    hdr.index_off = os.tellp();
+    put(index);
+    os.seekp(0);
+    os.write(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    os.flush();
+    if(!os) {
+      throw std::runtime_error("binary::writer: write failed\n");
+    }
+  }
+
+ private:
+  template <class V>
+  void put(const V & v) {
+    os.write(reinterpret_cast<const char *>(v.data()),
+             v.size() * sizeof(typename V::value_type));
+  }
+
+  void flush() {
+    if(row_ids.empty()) return;
+    index_entry e;
+    e.off = os.tellp();
+    e.rows = row_ids.size();
+    e.nnz = vals.size();
+    index.push_back(e);
+    hdr.n_rows += e.rows;
+    hdr.n_vals += e.nnz;
+    put(row_ids);
+    if(hdr.kind == csr) {
+      put(row_ptr);
+      put(col_ids);
+    }
+    put(vals);
+    row_ids.clear();
+    row_ptr.assign(1, 0);
+    col_ids.clear();
+    vals.clear();
+  }
+
+ private:
+  std::ofstream os;
+  uint64_t block_rows;
+  header hdr;
+  bool closed = false;
+  paracel::list_type<index_entry> index;
+  paracel::list_type<uint64_t> row_ids, row_ptr, col_ids;
+  paracel::list_type<double> vals;
+
+}; // class writer
+
+/**
+ * mapped binary file, the header and index are checked against the file
+ * size on open so block views never point past the mapping
+ */
+class reader {
+
+ public:
+  reader(const paracel::str_type & fn) : mf(fn), name(fn) {
+    if(mf.size() < sizeof(header)) fail("truncated header");
+    std::memcpy(&hdr, mf.data(), sizeof(hdr));
+    if(std::memcmp(hdr.magic, magic, sizeof(magic)) != 0) fail("bad magic");
+    if(hdr.version != version) fail("unsupported version");
+    if(hdr.byte_order != byte_order) fail("byte order mismatch");
+    if(hdr.kind != csr && hdr.kind != dense) fail("unknown kind");
+    if(hdr.index_off % 8 || hdr.index_off > mf.size() ||
+       (mf.size() - hdr.index_off) / sizeof(index_entry) < hdr.n_blocks) {
+      fail("bad index");
+    }
+    index = reinterpret_cast<const index_entry *>(mf.data() + hdr.index_off);
+    for(uint64_t i = 0; i < hdr.n_blocks; ++i) {
+      auto & e = index[i];
+      if(e.off % 8 || e.off < sizeof(header) || e.off > hdr.index_off ||
+         words(e) > (hdr.index_off - e.off) / 8) {
+        fail("bad block " + std::to_string((long long)i));
+      }
+    }
+    mf.advise_sequential(0, mf.size());
+  }
+
+  kind_type kind() const { return static_cast<kind_type>(hdr.kind); }
+
+  uint64_t dim() const { return hdr.dim; }
+
+  uint64_t n_blocks() const { return hdr.n_blocks; }
+
+  uint64_t n_rows() const { return hdr.n_rows; }
+
+  uint64_t n_vals() const { return hdr.n_vals; }
+
+  const index_entry & entry(uint64_t i) const { return index[i]; }
+
+  block get_block(uint64_t i) const {
+    auto & e = index[i];
+    const uint64_t *p = reinterpret_cast<const uint64_t *>(mf.data() + e.off);
+    block b;
+    b.rows = e.rows;
+    b.nnz = e.nnz;
+    b.row_ids = p;
+    p += e.rows;
+    if(hdr.kind == csr) {
+      b.row_ptr = p;
+      p += e.rows + 1;
+      b.col_ids = p;
+      p += e.nnz;
+      if(b.row_ptr[0] != 0 || b.row_ptr[e.rows] != e.nnz) {
+        fail("bad row_ptr in block " + std::to_string((long long)i));
+      }
+      for(uint64_t r = 0; r < e.rows; ++r) {
+        if(b.row_ptr[r] > b.row_ptr[r + 1]) {
+          fail("bad row_ptr in block " + std::to_string((long long)i));
+        }
+      }
+    }
+    b.vals = reinterpret_cast<const double *>(p);
+    return b;
+  }
+
+ private:
+  // size of a block in words, without overflowing on junk entries
+  uint64_t words(const index_entry & e) const {
+    const uint64_t lim = (uint64_t)1 << 60;
+    if(e.rows > lim || e.nnz > lim) return UINT64_MAX;
+    if(hdr.kind == dense) {
+      if(hdr.dim && e.rows > lim / hdr.dim) return UINT64_MAX;
+      if(e.nnz != e.rows * hdr.dim) return UINT64_MAX;
+      return e.rows + e.nnz;
+    }
+    return e.rows * 2 + 1 + e.nnz * 2;
+  }
+
+  void fail(const paracel::str_type & msg) const {
+    throw std::runtime_error("binary::reader: " + name + ": " + msg + "\n");
+  }
+
+ private:
+  paracel::mapped_file mf;
+  paracel::str_type name;
+  header hdr;
+  const index_entry *index = NULL;
+
+}; // class reader
+
+} // namespace binary
+} // namespace paracel
+
+#endif
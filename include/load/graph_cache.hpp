@@ -0,0 +1,247 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#ifndef FILE_cbd2b462_e0ec_4074_9ac9_88d728f71dd9_HPP
+#define FILE_cbd2b462_e0ec_4074_9ac9_88d728f71dd9_HPP
+
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+#include "paracel_types.hpp"
+#include "load/line_reader.hpp"
+#include "utils/ext_utility.hpp"
+
+namespace paracel {
+
+/**
+ * binary cache of the triples a rank owns after the loader's shuffle
+ *   one file per rank in folder, named after a fingerprint of the input
+ *   files(names, sizes, mtimes), the pattern, the mix flag, the rank count
+ *   and a caller tag, which should name the parser since it can not be
+ *   fingerprinted. layout:
+ *     header | n_tpls x (uint64 src, uint64 dst, double w) |
+ *     n_rm x (uint64 idx, uint64 id) | n_cm x (uint64 idx, uint64 id)
+ */
+class graph_cache {
+
+ private:
+  struct header {
+    char magic[8];
+    uint64_t version;
+    uint64_t fingerprint;
+    uint64_t nranks;
+    uint64_t rank;
+    uint64_t n_tpls;
+    uint64_t n_rm;
+    uint64_t n_cm;
+  };
+
+  struct record {
+    uint64_t a, b;
+    double w;
+  };
+
+  using id_map = paracel::dict_type<paracel::default_id_type, paracel::default_id_type>;
+
+ public:
+  graph_cache(const paracel::str_type & folder,
+              const paracel::list_type<paracel::str_type> & fns,
+              const paracel::str_type & pattern,
+              bool mix,
+              size_t rank,
+              size_t nranks,
+              const paracel::str_type & tag = "") : rk(rank), sz(nranks) {
+    auto lst = fns;
+    std::sort(lst.begin(), lst.end());
+    paracel::str_type key = pattern + (mix ? "|mix|" : "|") + tag + "|" + std::to_string(nranks);
+    for(auto & fn : lst) {
+      struct stat st;
+      if(::stat(fn.c_str(), &st) != 0) {
+        st.st_size = -1;
+        st.st_mtime = 0;
+      }
+      key += "|" + fn + ":" + std::to_string((long long)st.st_size)
+          + ":" + std::to_string((long long)st.st_mtime);
+    }
+    fp = fnv1a(key);
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)fp);
+    path = paracel::todir(folder) + "paracel_cache_" + buf + "_"
+        + std::to_string(nranks) + "_" + std::to_string(rank);
+  }
+
+  const paracel::str_type & get_path() const {
+    return path;
+  }
+
+  // a complete file of this input, rank and rank count
+  bool valid() const {
+    struct stat st;
+    if(::stat(path.c_str(), &st) != 0 || (size_t)st.st_size < sizeof(header)) {
+      return false;
+    }
+    header h;
+    std::ifstream is(path, std::ios::binary);
+    if(!is.read(reinterpret_cast<char *>(&h), sizeof(h))) return false;
+    return check(h, st.st_size);
+  }
+
+  /**
+   * map a complete file of this input, NULL if it is missing or does not
+   * match. the mapping stays readable whatever happens to the file later
+   */
+  std::unique_ptr<paracel::mapped_file> open() const {
+    if(!valid()) return NULL;
+    std::unique_ptr<paracel::mapped_file> mf;
+    try {
+      mf.reset(new paracel::mapped_file(path));
+    } catch (const std::runtime_error &) {
+      return NULL;
+    }
+    header h;
+    if(mf->size() < sizeof(h)) return NULL;
+    std::memcpy(&h, mf->data(), sizeof(h));
+    if(!check(h, mf->size())) return NULL;
+    return mf;
+  }
+
+  /**
+   * f(src, dst, w) for every cached triple, straight from the mapped file,
+   * rm and cm(when not NULL) get the cached id maps
+   *   return false if the file is missing or does not match
+   */
+  template <class F>
+  bool read(F && f, id_map *rm = NULL, id_map *cm = NULL) const {
+    auto mf = open();
+    if(!mf) return false;
+    read(*mf, f, rm, cm);
+    return true;
+  }
+
+  // read a mapping open returned
+  template <class F>
+  void read(const paracel::mapped_file & mf, F && f,
+            id_map *rm = NULL, id_map *cm = NULL) const {
+    header h;
+    std::memcpy(&h, mf.data(), sizeof(h));
+    mf.advise_sequential(0, mf.size());
+    const char *p = mf.data() + sizeof(h);
+    record r;
+    for(uint64_t i = 0; i < h.n_tpls; ++i, p += sizeof(r)) {
+      std::memcpy(&r, p, sizeof(r));
+      f(r.a, r.b, r.w);
+    }
+    read_map(p, h.n_rm, rm);
+    p += h.n_rm * 2 * sizeof(uint64_t);
+    read_map(p, h.n_cm, cm);
+  }
+
+  // write to a temporary file renamed into place, return false on io errors
+  bool write(const paracel::list_type<paracel::compact_triple_type> & tpls,
+             const id_map *rm = NULL,
+             const id_map *cm = NULL) const {
+    paracel::str_type tmp = path + ".tmp." + std::to_string((long long)getpid());
+    {
+      std::ofstream os(tmp, std::ios::binary | std::ios::trunc);
+      if(!os) return false;
+      header h;
+      std::memset(&h, 0, sizeof(h));
+      std::memcpy(h.magic, "PRCLGC\0\0", 8);
+      h.version = 1;
+      h.fingerprint = fp;
+      h.nranks = sz;
+      h.rank = rk;
+      h.n_tpls = tpls.size();
+      h.n_rm = rm ? rm->size() : 0;
+      h.n_cm = cm ? cm->size() : 0;
+      os.write(reinterpret_cast<const char *>(&h), sizeof(h));
+      paracel::list_type<record> buf;
+      buf.reserve(std::min(tpls.size(), (size_t)65536));
+      for(size_t i = 0; i < tpls.size(); ++i) {
+        auto & tpl = tpls[i];
+        buf.push_back(record{std::get<0>(tpl), std::get<1>(tpl), std::get<2>(tpl)});
+        if(buf.size() == buf.capacity() || i + 1 == tpls.size()) {
+          os.write(reinterpret_cast<const char *>(buf.data()), buf.size() * sizeof(record));
+          buf.clear();
+        }
+      }
+      write_map(os, rm);
+      write_map(os, cm);
+      if(!os.flush()) {
+        std::remove(tmp.c_str());
+        return false;
+      }
+    }
+    if(std::rename(tmp.c_str(), path.c_str()) != 0) {
+      std::remove(tmp.c_str());
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  static uint64_t fnv1a(const paracel::str_type & s) {
+    uint64_t h = 14695981039346656037ULL;
+    for(unsigned char c : s) {
+      h ^= c;
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
+
+  bool check(const header & h, size_t fsz) const {
+    if(std::memcmp(h.magic, "PRCLGC\0\0", 8) != 0 || h.version != 1 ||
+       h.fingerprint != fp || h.nranks != sz || h.rank != rk) {
+      return false;
+    }
+    return fsz == sizeof(header) + h.n_tpls * sizeof(record)
+        + (h.n_rm + h.n_cm) * 2 * sizeof(uint64_t);
+  }
+
+  static void read_map(const char *p, uint64_t n, id_map *m) {
+    if(!m) return;
+    uint64_t kv[2];
+    for(uint64_t i = 0; i < n; ++i, p += sizeof(kv)) {
+      std::memcpy(kv, p, sizeof(kv));
+      (*m)[kv[0]] = kv[1];
+    }
+  }
+
+  static void write_map(std::ofstream & os, const id_map *m) {
+    if(!m) return;
+    for(auto & kv : *m) {
+      uint64_t buf[2] = {kv.first, kv.second};
+      os.write(reinterpret_cast<const char *>(buf), sizeof(buf));
+    }
+  }
+
+ private:
+  size_t rk, sz;
+  uint64_t fp = 0;
+  paracel::str_type path;
+
+}; // class graph_cache
+
+} // namespace paracel
+
+#endif
@@ -0,0 +1,285 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#ifndef FILE_9c454fa8_2066_4a65_ab83_060e3d3dd9b5_HPP
+#define FILE_9c454fa8_2066_4a65_ab83_060e3d3dd9b5_HPP
+
+#include <stdint.h>
+#include <zlib.h>
+
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+#include "paracel_types.hpp"
+#include "utils/str_view.hpp"
+
+namespace paracel {
+
+/**
+ * gzip compressed input
+ *   a plain gzip file(one or more members) can only be inflated front to
+ *   back, so it is read whole by one rank. a framed file is a series of
+ *   gzip members, each holding whole lines and carrying its own length in
+ *   an extra field(subfield 'P' 'L', 4 byte little-endian member size), so
+ *   members can be found by hopping headers, split across ranks and
+ *   inflated independently. framed files are valid gzip files: zcat reads
+ *   them. tool/gzframe writes them.
+ */
+namespace gz {
+
+enum kind_type {
+  none = 0,
+  plain = 1,
+  framed = 2
+};
+
+// a member of a framed file, [off, off + len) of the compressed file
+struct frame {
+  size_t off;
+  size_t len;
+};
+
+namespace detail {
+
+// 10 byte gzip header + xlen + 'P' 'L' slen + member size
+static const size_t frame_header_len = 20;
+
+inline uint32_t get32(const char *p) {
+  const unsigned char *q = reinterpret_cast<const unsigned char *>(p);
+  return q[0] | (uint32_t)q[1] << 8 | (uint32_t)q[2] << 16 | (uint32_t)q[3] << 24;
+}
+
+inline void put32(char *p, uint32_t v) {
+  for(int i = 0; i < 4; ++i) p[i] = (char)(v >> (8 * i));
+}
+
+inline bool is_member(const char *p, size_t n) {
+  return n >= 10 && (unsigned char)p[0] == 0x1f &&
+      (unsigned char)p[1] == 0x8b && p[2] == 8;
+}
+
+// member size from the 'P' 'L' subfield, 0 if p is not a framed member
+inline size_t frame_len(const char *p, size_t n) {
+  if(!is_member(p, n) || !(p[3] & 4) || n < 12) return 0;
+  size_t xlen = (unsigned char)p[10] | (size_t)(unsigned char)p[11] << 8;
+  if(n < 12 + xlen) return 0;
+  const char *x = p + 12, *xe = x + xlen;
+  while(x + 4 <= xe) {
+    size_t slen = (unsigned char)x[2] | (size_t)(unsigned char)x[3] << 8;
+    if(x[0] == 'P' && x[1] == 'L' && slen == 4 && x + 8 <= xe) {
+      return get32(x + 4);
+    }
+    x += 4 + slen;
+  }
+  return 0;
+}
+
+// inflate state released on every path out
+struct inflater {
+  inflater() {
+    std::memset(&zs, 0, sizeof(zs));
+    if(inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK) {
+      throw std::runtime_error("gz: inflateInit2 failed\n");
+    }
+  }
+  ~inflater() {
+    inflateEnd(&zs);
+  }
+  z_stream zs;
+};
+
+} // namespace detail
+
+inline kind_type detect(const char *p, size_t n) {
+  if(detail::frame_len(p, n)) return framed;
+  if(detail::is_member(p, n)) return plain;
+  return none;
+}
+
+// members of a framed file, throw if the chain of headers is broken
+inline paracel::list_type<frame> frames(const char *p, size_t n) {
+  paracel::list_type<frame> r;
+  size_t off = 0;
+  while(off < n) {
+    size_t len = detail::frame_len(p + off, n - off);
+    if(len < detail::frame_header_len + 8 || len > n - off) {
+      throw std::runtime_error("gz: broken frame at " + std::to_string((long long)off) + "\n");
+    }
+    r.push_back(frame{off, len});
+    off += len;
+  }
+  return r;
+}
+
+// inflated size of the member fr from its trailer(mod 4GiB)
+inline size_t isize(const char *p, const frame & fr) {
+  return fr.len < 8 ? 0 : detail::get32(p + fr.off + fr.len - 4);
+}
+
+// inflate one framed member into out(replaced), the crc is checked by zlib
+inline void inflate_frame(const char *p, const frame & fr, paracel::str_type & out) {
+  size_t isize = gz::isize(p, fr);
+  // one spare byte so a lying isize shows up as a short inflate
+  out.resize(isize + 1);
+  detail::inflater inf;
+  inf.zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(p + fr.off));
+  inf.zs.avail_in = fr.len;
+  inf.zs.next_out = reinterpret_cast<Bytef *>(&out[0]);
+  inf.zs.avail_out = out.size();
+  int rc = inflate(&inf.zs, Z_FINISH);
+  if(rc != Z_STREAM_END || inf.zs.total_out != isize || inf.zs.avail_in != 0) {
+    throw std::runtime_error("gz: corrupt frame at " + std::to_string((long long)fr.off) + "\n");
+  }
+  out.resize(isize);
+}
+
+/**
+ * f(str_view) for every line of a plain gzip buffer, streamed through a
+ * window that only grows for lines longer than it. the views are valid
+ * during the call only
+ */
+template <class F>
+void for_each_line(const char *p, size_t n, F && f) {
+  detail::inflater inf;
+  z_stream & zs = inf.zs;
+  paracel::str_type buf(1 << 22, '\0');
+  size_t used = 0, in_off = 0;
+  while(true) {
+    if(zs.avail_in == 0 && in_off < n) {
+      size_t chunk = std::min(n - in_off, (size_t)1 << 30);
+      zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(p + in_off));
+      zs.avail_in = chunk;
+      in_off += chunk;
+    }
+    if(used == buf.size()) buf.resize(buf.size() * 2);
+    zs.next_out = reinterpret_cast<Bytef *>(&buf[used]);
+    zs.avail_out = buf.size() - used;
+    int rc = inflate(&zs, Z_NO_FLUSH);
+    size_t got = buf.size() - used - zs.avail_out;
+    used += got;
+    if(rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR) {
+      throw std::runtime_error("gz: corrupt or truncated gzip input\n");
+    }
+    size_t st = 0;
+    while(const void *nl = std::memchr(&buf[st], '\n', used - st)) {
+      size_t e = static_cast<const char *>(nl) - buf.data();
+      f(paracel::str_view(buf.data() + st, e - st));
+      st = e + 1;
+    }
+    std::memmove(&buf[0], buf.data() + st, used - st);
+    used -= st;
+    if(rc == Z_STREAM_END) {
+      // concatenated members continue, anything else ends the input like gzip
+      const char *q = zs.avail_in ? reinterpret_cast<const char *>(zs.next_in) : p + in_off;
+      size_t rest = zs.avail_in ? zs.avail_in + (n - in_off) : n - in_off;
+      if(!detail::is_member(q, rest)) break;
+      inflateReset(&zs);
+    } else if(got == 0 && zs.avail_in == 0 && in_off == n) {
+      throw std::runtime_error("gz: truncated gzip input\n");
+    }
+  }
+  if(used) f(paracel::str_view(buf.data(), used));
+}
+
+/**
+ * write lines as a framed file, a member is cut once frame_bytes of text
+ * are buffered
+ */
+class frame_writer {
+
+ public:
+  frame_writer(const paracel::str_type & fn,
+               int lvl = Z_DEFAULT_COMPRESSION,
+               size_t fbytes = 1 << 20) : os(fn, std::ios::binary | std::ios::trunc),
+                                          level(lvl),
+                                          frame_bytes(std::min(std::max(fbytes, (size_t)1),
+                                                               (size_t)1 << 30)) {
+    if(!os) {
+      throw std::runtime_error("gz::frame_writer: can not open " + fn + "\n");
+    }
+  }
+
+  frame_writer(const frame_writer &) = delete;
+
+  frame_writer & operator=(const frame_writer &) = delete;
+
+  ~frame_writer() {
+    try { close(); } catch (...) {}
+  }
+
+  void write_line(const paracel::str_view & line) {
+    text.append(line.data(), line.size());
+    text.push_back('\n');
+    if(text.size() >= frame_bytes) flush();
+  }
+
+  void close() {
+    if(closed) return;
+    closed = true;
+    flush();
+    os.flush();
+    if(!os) {
+      throw std::runtime_error("gz::frame_writer: write failed\n");
+    }
+  }
+
+ private:
+  void flush() {
+    if(text.empty()) return;
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+    // raw deflate, the gzip framing is written here
+    if(deflateInit2(&zs, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+      throw std::runtime_error("gz::frame_writer: deflateInit2 failed\n");
+    }
+    zbuf.resize(deflateBound(&zs, text.size()) + detail::frame_header_len + 8);
+    zs.next_in = reinterpret_cast<Bytef *>(&text[0]);
+    zs.avail_in = text.size();
+    zs.next_out = reinterpret_cast<Bytef *>(&zbuf[detail::frame_header_len]);
+    zs.avail_out = zbuf.size() - detail::frame_header_len - 8;
+    int rc = deflate(&zs, Z_FINISH);
+    size_t clen = zs.total_out;
+    deflateEnd(&zs);
+    if(rc != Z_STREAM_END) {
+      throw std::runtime_error("gz::frame_writer: deflate failed\n");
+    }
+    size_t len = detail::frame_header_len + clen + 8;
+    const char hdr[16] = {
+      '\x1f', '\x8b', 8, 4, 0, 0, 0, 0, 0, '\xff', 8, 0, 'P', 'L', 4, 0
+    };
+    std::memcpy(&zbuf[0], hdr, sizeof(hdr));
+    detail::put32(&zbuf[16], len);
+    uLong crc = crc32(0L, reinterpret_cast<const Bytef *>(text.data()), text.size());
+    detail::put32(&zbuf[detail::frame_header_len + clen], crc);
+    detail::put32(&zbuf[detail::frame_header_len + clen + 4], text.size());
+    os.write(zbuf.data(), len);
+    text.clear();
+  }
+
+ private:
+  std::ofstream os;
+  int level;
+  size_t frame_bytes;
+  bool closed = false;
+  paracel::str_type text, zbuf;
+
+}; // class frame_writer
+
+} // namespace gz
+} // namespace paracel
+
+#endif
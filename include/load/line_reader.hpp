@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#ifndef FILE_01302736_9726_4469_b649_94df87c0decd_HPP
+#define FILE_01302736_9726_4469_b649_94df87c0decd_HPP
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+#include "paracel_types.hpp"
+#include "utils/str_view.hpp"
+
+namespace paracel {
+
+// read-only mapping of a whole file
+class mapped_file {
+
+ public:
+  mapped_file(const paracel::str_type & fn) {
+    fd = ::open(fn.c_str(), O_RDONLY);
+    if(fd < 0) {
+      throw std::runtime_error("mapped_file: can not open " + fn + "\n");
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+      ::close(fd);
+      throw std::runtime_error("mapped_file: can not stat " + fn + "\n");
+    }
+    sz = st.st_size;
+    if(sz) {
+      void *p = mmap(NULL, sz, PROT_READ, MAP_PRIVATE, fd, 0);
+      if(p == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("mapped_file: can not map " + fn + "\n");
+      }
+      base = static_cast<const char *>(p);
+    }
+  }
+
+  mapped_file(const mapped_file &) = delete;
+
+  mapped_file & operator=(const mapped_file &) = delete;
+
+  ~mapped_file() {
+    if(sz) munmap(const_cast<char *>(base), sz);
+    ::close(fd);
+  }
+
+  const char * data() const { return base; }
+
+  size_t size() const { return sz; }
+
+  // [off, off + n) is going to be read once, front to back
+  void advise_sequential(size_t off, size_t n) const {
+    if(!sz || off >= sz) return;
+    size_t pg = sysconf(_SC_PAGESIZE);
+    size_t st = off / pg * pg;
+    madvise(const_cast<char *>(base) + st,
+            std::min(off + n, sz) - st,
+            MADV_SEQUENTIAL);
+  }
+
+ private:
+  int fd = -1;
+  const char *base = "";
+  size_t sz = 0;
+
+}; // class mapped_file
+
+/**
+ * call f(str_view) for every line of buf[0, sz) starting in [lo, hi)
+ *   a line starts at 0 or right after a '\n', the view excludes the '\n'.
+ *   so adjacent ranges see every line exactly once, which is how blocks of
+ *   partition::files_partition split a file.
+ */
+template <class F>
+void for_each_line(const char *buf, size_t sz, size_t lo, size_t hi, F && f) {
+  hi = std::min(hi, sz);
+  size_t pos = lo;
+  if(pos > 0 && pos < hi && buf[pos - 1] != '\n') {
+    const void *nl = std::memchr(buf + pos, '\n', sz - pos);
+    if(!nl) return;
+    pos = static_cast<const char *>(nl) - buf + 1;
+  }
+  while(pos < hi) {
+    const void *nl = std::memchr(buf + pos, '\n', sz - pos);
+    size_t e = nl ? static_cast<const char *>(nl) - buf : sz;
+    f(paracel::str_view(buf + pos, e - pos));
+    pos = e + 1;
+  }
+}
+
+} // namespace paracel
+
+#endif
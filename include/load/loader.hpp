@@ -16,8 +16,12 @@
 #ifndef FILE_71d45241_99cd_4d2c_cb1a_9d3e9ac6203c_HPP
 #define FILE_71d45241_99cd_4d2c_cb1a_9d3e9ac6203c_HPP
 
+#include <memory>
+#include <thread>
 #include <iostream>
+#include <exception>
 #include <functional>
+#include <stdexcept>
 
 #include <boost/variant.hpp>
 #include <eigen3/Eigen/Dense>
@@ -27,7 +31,12 @@
 #include "graph.hpp"
 #include "utils.hpp"
 #include "load/scheduler.hpp"
+#include "load/parser.hpp"
 #include "load/partition.hpp"
+#include "utils/trace.hpp"
+#include "utils/bqueue.hpp"
+#include "load/graph_cache.hpp"
+#include "load/binary_format.hpp"
 
 namespace paracel {
 
@@ -62,6 +71,19 @@ class loader {
          paracel::str_type pt, 
          bool flag) : filenames(fns), m_comm(comm), parserfunc(f), pattern(pt), mix(flag) {};
 
+  // default_id_type graphs and fmap matrices only, see triple_parser
+  loader(T fns, 
+         paracel::Comm comm, 
+         triple_parser_type f, 
+         paracel::str_type pt, 
+         bool flag = false) : filenames(fns), m_comm(comm), tparserfunc(f), pattern(pt), mix(flag) {};
+
+  // parse lines of create_graph and create_matrix, and inflate framed gzip
+  // input, on pool's threads
+  void set_pool(paracel::thrdpool *pool) {
+    p_pool = pool;
+  }
+
   paracel::list_type<paracel::str_type> load() {
     
     paracel::scheduler scheduler(m_comm, pattern, mix);
@@ -70,7 +92,11 @@ class loader {
     paracel::partition partition_obj(fname_lst,
                                      m_comm.get_size(),
                                      pattern);
+    partition_obj.set_pool(p_pool);
+    partition_obj.set_balance(balance_by, balance_seps);
+    paracel::trace_scope tr("load", "files_partition");
     partition_obj.files_partition();
+    tr.next("schedule_load");
     auto linelst = scheduler.schedule_load(partition_obj);
     m_comm.synchronize();
     if(m_comm.get_rank() == 0) std::cout << "lines got" << std::endl;
@@ -86,7 +112,11 @@ class loader {
     paracel::partition partition_obj(fname_lst,
                                      m_comm.get_size(),
                                      pattern);
+    partition_obj.set_pool(p_pool);
+    partition_obj.set_balance(balance_by, balance_seps);
+    paracel::trace_scope tr("load", "files_partition");
     partition_obj.files_partition();
+    tr.next("structure_load");
     // parallel loading lines
     auto linelst = scheduler.structure_load(partition_obj);
     m_comm.synchronize();
@@ -102,7 +132,11 @@ class loader {
     paracel::partition partition_obj(fname_lst,
                                      m_comm.get_size(),
                                      pattern);
+    partition_obj.set_pool(p_pool);
+    partition_obj.set_balance(balance_by, balance_seps);
+    paracel::trace_scope tr("load", "files_partition");
     partition_obj.files_partition();
+    tr.next("structure_load_handle");
     scheduler.structure_load_handle(partition_obj, func);
     if(m_comm.get_rank() == 0) std::cout << "lines parsed" << std::endl;
   }
@@ -114,33 +148,23 @@ class loader {
                      paracel::dict_type<paracel::default_id_type, paracel::default_id_type> & cm) {
     
     paracel::scheduler scheduler(m_comm, pattern, mix);
+    scheduler.set_pool(p_pool);
+    paracel::trace_scope tr("load", "lines_organize");
     
     paracel::list_type<paracel::list_type<paracel::compact_triple_type> > result;
-    scheduler.lines_organize(linelst, 
-                             parserfunc, 
-                             result);
+    organize(scheduler, linelst, result);
     linelst.resize(0); linelst.shrink_to_fit(); paracel::cheat_to_os();
     m_comm.synchronize();
     if(m_comm.get_rank() == 0) std::cout << "slotslst generated" << std::endl;
     
-    paracel::list_type<paracel::compact_triple_type> stf, stf_new;
+    tr.next("exchange");
+    paracel::list_type<paracel::compact_triple_type> stf;
     scheduler.exchange(result, stf);
     result.resize(0); result.shrink_to_fit(); paracel::cheat_to_os();
     m_comm.synchronize();
     if(m_comm.get_rank() == 0) std::cout << "desirable lines got" << std::endl;
-    
-    scheduler.index_mapping(stf, stf_new, rm, cm);
-    if(m_comm.get_rank() == 0) std::cout << "process 0 index mapping finished" << std::endl;
-    
-    paracel::list_type<eigen_triple> nonzero_tpls;
-    for(auto & tpl : stf_new) {
-      nonzero_tpls.push_back(eigen_triple(std::get<0>(tpl), 
-                                          std::get<1>(tpl), 
-                                          std::get<2>(tpl)));
-    }
-    blk_mtx.resize(rm.size(), cm.size());
-    blk_mtx.setFromTriplets(nonzero_tpls.begin(), 
-                            nonzero_tpls.end());
+    tr.next("build");
+    build(scheduler, stf, blk_mtx, rm, cm);
   }
 
   // simple fmap case, fsmap case
@@ -150,18 +174,22 @@ class loader {
                      paracel::dict_type<paracel::default_id_type, paracel::str_type> & cm) {
 
     paracel::scheduler scheduler(m_comm, pattern, mix); // TODO
+    scheduler.set_pool(p_pool);
+    paracel::trace_scope tr("load", "lines_organize");
     
     // hash lines into slotslst
-    auto result = scheduler.lines_organize(linelst, parserfunc);
+    auto result = scheduler.lines_organize(linelst, line_parser());
     linelst.resize(0); linelst.shrink_to_fit(); paracel::cheat_to_os();
     m_comm.synchronize();
     if(m_comm.get_rank() == 0) std::cout << "slotslst generated" << std::endl;
 
+    tr.next("exchange");
     // alltoall exchange
     auto stf = scheduler.exchange(result);
     result.resize(0); result.shrink_to_fit(); paracel::cheat_to_os();
     m_comm.synchronize();
     if(m_comm.get_rank() == 0) std::cout << "desirable lines got" << std::endl;
+    tr.next("build");
     
     // mapping inds to ids, get rmap, cmap, std_new...
     paracel::list_type<paracel::compact_triple_type> stf_new;
@@ -184,22 +212,24 @@ class loader {
   void create_matrix(paracel::list_type<paracel::str_type> & linelst,
                      Eigen::MatrixXd & blk_dense_mtx,
                      paracel::dict_type<paracel::default_id_type, paracel::default_id_type> & rm) {
+    paracel::trace_scope tr("load", "create_matrix");
     int csz = 0;
     paracel::default_id_type indx = 0;
     bool flag = true;
     paracel::list_type<Eigen::VectorXd> mtx_llst;
+    auto & parser = line_parser();
     std::cout << linelst.size() << std::endl;
     for(auto & line : linelst) {
-      auto stf = parserfunc(line);
+      auto stf = parser(line);
       if(flag) { 
         csz = stf.size() - 1; 
         flag = false; 
       }
-      rm[indx] = std::stoull(stf[0]);
+      rm[indx] = paracel::to_uint64(stf[0]);
       indx += 1;
       Eigen::VectorXd tmp(csz);
       for(int i = 0; i < csz; ++i) {
-        tmp[i] = std::stod(stf[i + 1]);
+        tmp[i] = paracel::to_double(stf[i + 1]);
       }
       mtx_llst.push_back(tmp);
     } 
@@ -215,12 +245,14 @@ class loader {
                      Eigen::MatrixXd & blk_dense_mtx,
                      paracel::dict_type<paracel::default_id_type, paracel::str_type> & rm) {
 
+    paracel::trace_scope tr("load", "create_matrix");
     int csz = 0;
     paracel::default_id_type indx = 0;
     bool flag = true;
     paracel::list_type<Eigen::VectorXd> mtx_llst;
+    auto & parser = line_parser();
     for(auto & line : linelst) {
-      auto stf = parserfunc(line);
+      auto stf = parser(line);
       if(flag) { 
         csz = stf.size() - 1; 
         flag = true; 
@@ -229,7 +261,7 @@ class loader {
       indx += 1;
       Eigen::VectorXd tmp(csz);
       for(int i = 0; i < csz; ++i) {
-        tmp[i] = std::stod(stf[i + 1]);
+        tmp[i] = paracel::to_double(stf[i + 1]);
       }
       mtx_llst.push_back(tmp);
     } 
@@ -244,44 +276,44 @@ class loader {
                     paracel::digraph<paracel::default_id_type> & grp) {
     
     paracel::scheduler scheduler(m_comm, pattern, mix);
+    scheduler.set_pool(p_pool);
+    paracel::trace_scope tr("load", "lines_organize");
     
     paracel::list_type<paracel::list_type<paracel::compact_triple_type> > result;
-    scheduler.lines_organize(linelst, 
-                             parserfunc, 
-                             result);
+    organize(scheduler, linelst, result);
     linelst.resize(0); linelst.shrink_to_fit(); paracel::cheat_to_os();
     m_comm.synchronize();
     if(m_comm.get_rank() == 0) std::cout << " slotslst generated" << std::endl;
     
+    tr.next("exchange");
     paracel::list_type<paracel::compact_triple_type> stf;
     scheduler.exchange(result, stf);
     result.resize(0); result.shrink_to_fit(); paracel::cheat_to_os();
     m_comm.synchronize();
-    
-    for(auto & tpl : stf) {
-      grp.add_edge(std::get<0>(tpl), 
-                   std::get<1>(tpl), 
-                   std::get<2>(tpl));
-    }
-    stf.resize(0); stf.shrink_to_fit(); paracel::cheat_to_os();
+    tr.next("build");
+    build(stf, grp);
   }
 
   void create_graph(paracel::list_type<paracel::str_type> & linelst,
                     paracel::digraph<paracel::str_type> & grp) {
     
     paracel::scheduler scheduler(m_comm, pattern, mix); // TODO
+    scheduler.set_pool(p_pool);
+    paracel::trace_scope tr("load", "lines_organize");
     
     // hash lines into slotslst
-    auto result = scheduler.lines_organize(linelst, parserfunc);
+    auto result = scheduler.lines_organize(linelst, line_parser());
     linelst.resize(0); linelst.shrink_to_fit(); paracel::cheat_to_os();
     m_comm.synchronize();
     if(m_comm.get_rank() == 0) std::cout << "slotslst generated" << std::endl;
     
+    tr.next("exchange");
     // alltoall exchange
     auto stf = scheduler.exchange(result);
     result.resize(0); result.shrink_to_fit(); paracel::cheat_to_os();
     m_comm.synchronize();
     if(m_comm.get_rank() == 0) std::cout << "desirable lines got" << std::endl;
+    tr.next("build");
 
     paracel::dict_type<paracel::str_type, 
                       paracel::dict_type<paracel::str_type, double> > dct;
@@ -295,46 +327,47 @@ class loader {
                     paracel::bigraph<paracel::default_id_type> & grp) {
     
     paracel::scheduler scheduler(m_comm, pattern, mix); // TODO
+    scheduler.set_pool(p_pool);
+    paracel::trace_scope tr("load", "lines_organize");
     
     // hash lines into slotslst
     paracel::list_type<paracel::list_type<paracel::compact_triple_type> > result;
-    scheduler.lines_organize(linelst, 
-                             parserfunc, 
-                             result);
+    organize(scheduler, linelst, result);
     linelst.resize(0); linelst.shrink_to_fit(); paracel::cheat_to_os();
     m_comm.synchronize();
     if(m_comm.get_rank() == 0) std::cout << "slotslst generated" << std::endl;
     
     // alltoall exchange
+    tr.next("exchange");
     paracel::list_type<paracel::compact_triple_type> stf;
     scheduler.exchange(result, stf);
     result.resize(0); result.shrink_to_fit(); paracel::cheat_to_os();
     m_comm.synchronize();
     if(m_comm.get_rank() == 0) std::cout << "desirable lines got" << std::endl;
-    for(auto & tpl : stf) {
-      grp.add_edge(std::get<0>(tpl), 
-                   std::get<1>(tpl), 
-                   std::get<2>(tpl));
-    }
-    stf.resize(0); stf.shrink_to_fit(); paracel::cheat_to_os();
+    tr.next("build");
+    build(stf, grp);
   }
 
   void create_graph(paracel::list_type<paracel::str_type> & linelst,
                     paracel::bigraph<paracel::str_type> & grp) {
     
     paracel::scheduler scheduler(m_comm, pattern, mix); // TODO
+    scheduler.set_pool(p_pool);
+    paracel::trace_scope tr("load", "lines_organize");
     
     // hash lines into slotslst
-    auto result = scheduler.lines_organize(linelst, parserfunc);
+    auto result = scheduler.lines_organize(linelst, line_parser());
     linelst.resize(0); linelst.shrink_to_fit(); paracel::cheat_to_os();
     m_comm.synchronize();
     if(m_comm.get_rank() == 0) std::cout << "slotslst generated" << std::endl;
     
+    tr.next("exchange");
     // alltoall exchange
     auto stf = scheduler.exchange(result);
     result.resize(0); result.shrink_to_fit(); paracel::cheat_to_os();
     m_comm.synchronize();
     if(m_comm.get_rank() == 0) std::cout << "desirable lines got" << std::endl;
+    tr.next("build");
 
     paracel::dict_type<paracel::str_type, 
                       paracel::dict_type<paracel::str_type, double> > dct;
@@ -350,27 +383,367 @@ class loader {
                     paracel::dict_type<paracel::default_id_type, paracel::default_id_type> & cm) {
     
     paracel::scheduler scheduler(m_comm, pattern, mix); // TODO
+    scheduler.set_pool(p_pool);
+    paracel::trace_scope tr("load", "lines_organize");
     
     // hash lines into slotslst
     paracel::list_type<paracel::list_type<paracel::compact_triple_type> > result;
-    scheduler.lines_organize(linelst, 
-                             parserfunc, 
-                             result);
+    organize(scheduler, linelst, result);
     linelst.resize(0); linelst.shrink_to_fit(); paracel::cheat_to_os();
     m_comm.synchronize();
     if(m_comm.get_rank() == 0) std::cout << "slotslst generated" << std::endl;
     
     // alltoall exchange
+    tr.next("exchange");
     paracel::list_type<paracel::compact_triple_type> stf;
     scheduler.exchange(result, stf);
     result.resize(0); result.shrink_to_fit(); paracel::cheat_to_os();
     m_comm.synchronize();
     if(m_comm.get_rank() == 0) std::cout << "desirable lines got" << std::endl;
-    
+    tr.next("build");
+    build(scheduler, stf, grp, rm, cm);
+  }
+
+  /**
+   * fixload and create_graph/create_matrix in one pass, see stream_exchange
+   *   default_id_type graphs and matrices stream, string ids fall back to
+   *   the two phases. binary input(see binary_format.hpp) is detected and
+   *   read block by block instead of parsed
+   */
+  void load_graph(paracel::digraph<paracel::default_id_type> & grp) {
+    auto add = [&grp] (paracel::default_id_type a, paracel::default_id_type b, double w) {
+      grp.add_edge(a, b, w);
+    };
+    if(cache_read(add)) return;
+    paracel::scheduler scheduler(m_comm, pattern, mix);
+    scheduler.set_pool(p_pool);
+    paracel::list_type<paracel::compact_triple_type> stf;
+    stream_exchange(scheduler, stf);
+    cache_write(stf);
+    paracel::trace_scope tr("load", "build");
+    build(stf, grp);
+  }
+
+  void load_graph(paracel::bigraph<paracel::default_id_type> & grp) {
+    auto add = [&grp] (paracel::default_id_type a, paracel::default_id_type b, double w) {
+      grp.add_edge(a, b, w);
+    };
+    if(cache_read(add)) return;
+    paracel::scheduler scheduler(m_comm, pattern, mix);
+    scheduler.set_pool(p_pool);
+    paracel::list_type<paracel::compact_triple_type> stf;
+    stream_exchange(scheduler, stf);
+    cache_write(stf);
+    paracel::trace_scope tr("load", "build");
+    build(stf, grp);
+  }
+
+  void load_graph(paracel::bigraph_continuous & grp,
+                  paracel::dict_type<paracel::default_id_type, paracel::default_id_type> & rm,
+                  paracel::dict_type<paracel::default_id_type, paracel::default_id_type> & cm) {
+    auto add = [&grp] (paracel::default_id_type a, paracel::default_id_type b, double w) {
+      grp.add_edge(a, b, w);
+    };
+    if(cache_read(add, &rm, &cm)) return;
+    paracel::scheduler scheduler(m_comm, pattern, mix);
+    scheduler.set_pool(p_pool);
+    paracel::list_type<paracel::compact_triple_type> stf;
+    stream_exchange(scheduler, stf);
+    paracel::trace_scope tr("load", "build");
+    build(scheduler, stf, grp, rm, cm, true);
+  }
+
+  template <class G>
+  void load_graph(G & grp) {
+    text_only();
+    auto lines = fixload();
+    create_graph(lines, grp);
+  }
+
+  void load_matrix(Eigen::SparseMatrix<double, Eigen::RowMajor> & blk_mtx,
+                   paracel::dict_type<paracel::default_id_type, paracel::default_id_type> & rm,
+                   paracel::dict_type<paracel::default_id_type, paracel::default_id_type> & cm) {
+    paracel::list_type<eigen_triple> nonzero_tpls;
+    auto add = [&nonzero_tpls] (paracel::default_id_type a, paracel::default_id_type b, double w) {
+      nonzero_tpls.push_back(eigen_triple(a, b, w));
+    };
+    if(cache_read(add, &rm, &cm)) {
+      blk_mtx.resize(rm.size(), cm.size());
+      blk_mtx.setFromTriplets(nonzero_tpls.begin(), nonzero_tpls.end());
+      return;
+    }
+    paracel::scheduler scheduler(m_comm, pattern, mix);
+    scheduler.set_pool(p_pool);
+    paracel::list_type<paracel::compact_triple_type> stf;
+    stream_exchange(scheduler, stf);
+    paracel::trace_scope tr("load", "build");
+    build(scheduler, stf, blk_mtx, rm, cm, true);
+  }
+
+  template <class M>
+  void load_matrix(Eigen::SparseMatrix<double, Eigen::RowMajor> & blk_mtx,
+                   M & rm,
+                   M & cm) {
+    text_only();
+    auto lines = fixload();
+    create_matrix(lines, blk_mtx, rm, cm);
+  }
+
+  // fvec case, binary dense blocks are copied straight into the rows
+  void load_matrix(Eigen::MatrixXd & blk_dense_mtx,
+                   paracel::dict_type<paracel::default_id_type, paracel::default_id_type> & rm) {
+    if(!binary_input()) {
+      auto lines = fixload();
+      create_matrix(lines, blk_dense_mtx, rm);
+      return;
+    }
+    paracel::trace_scope tr("load", "binary_load");
+    auto files = open_binary(paracel::binary::dense);
+    auto blks = binary_blocks(files);
+    uint64_t dim = files.size() ? files[0]->dim() : 0;
+    uint64_t rows = 0;
+    for(auto & fb : blks) {
+      if(files[fb.first]->dim() != dim) {
+        throw std::runtime_error("loader: binary dense files of different dims\n");
+      }
+      rows += files[fb.first]->entry(fb.second).rows;
+    }
+    using row_major = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+    blk_dense_mtx.resize(rows, dim);
+    paracel::default_id_type indx = 0;
+    for(auto & fb : blks) {
+      auto blk = files[fb.first]->get_block(fb.second);
+      blk_dense_mtx.middleRows(indx, blk.rows) =
+          Eigen::Map<const row_major>(blk.vals, blk.rows, dim);
+      for(uint64_t r = 0; r < blk.rows; ++r) {
+        rm[indx + r] = blk.row_ids[r];
+      }
+      indx += blk.rows;
+    }
+    m_comm.synchronize();
+    if(m_comm.get_rank() == 0) std::cout << "binary blocks got" << std::endl;
+  }
+
+  template <class M>
+  void load_matrix(Eigen::MatrixXd & blk_dense_mtx, M & rm) {
+    text_only();
+    auto lines = fixload();
+    create_matrix(lines, blk_dense_mtx, rm);
+  }
+
+  // lines per chunk of load_graph and load_matrix
+  void set_chunk_lines(size_t n) {
+    chunk_lines = n == 0 ? 1 : n;
+  }
+
+  // even out records or edges instead of bytes over the blocks, see partition::set_balance
+  void set_balance(const paracel::str_type & by,
+                   const paracel::str_type & seps = " \t,|") {
+    balance_by = by;
+    balance_seps = seps;
+  }
+
+  /**
+   * load_graph and load_matrix of default_id_type ids keep the triples
+   * each rank owns after the shuffle in folder(see graph_cache), later
+   * loads of the same input, pattern, rank count and tag read them back
+   * instead of parsing and shuffling. tag should identify the parser,
+   * an empty folder turns the cache off
+   */
+  void set_cache(const paracel::str_type & folder,
+                 const paracel::str_type & tag = "") {
+    cache_dir = folder;
+    cache_tag = tag;
+  }
+
+ private:
+  /**
+   * read, parse and exchange in chunks of chunk_lines lines
+   *   a reader thread loads this rank's blocks and hashes every full chunk
+   *   into per-rank slots while the calling thread ships the previous one
+   *   with alltoall, so reading and parsing overlap the exchange and only a
+   *   few chunks are held besides the received triples. ranks out of chunks
+   *   join the remaining rounds with empty slots.
+   */
+  void stream_exchange(paracel::scheduler & scheduler,
+                       paracel::list_type<paracel::compact_triple_type> & stf) {
+    if(binary_input()) {
+      binary_exchange(scheduler, stf);
+      return;
+    }
+    using slots_type = paracel::list_type<paracel::list_type<paracel::compact_triple_type> >;
+    auto fname_lst = paracel::expand(filenames);
+    paracel::partition partition_obj(fname_lst,
+                                     m_comm.get_size(),
+                                     pattern);
+    partition_obj.set_pool(p_pool);
+    partition_obj.set_balance(balance_by, balance_seps);
+    paracel::trace_scope tr("load", "files_partition");
+    partition_obj.files_partition();
+    tr.next("stream_exchange");
+
+    paracel::bqueue<slots_type> q(2);
+    std::exception_ptr err;
+    std::thread reader([&] () {
+      try {
+        paracel::list_type<paracel::str_type> lines;
+        auto flush = [&] () {
+          slots_type slots;
+          organize(scheduler, lines, slots);
+          lines.clear();
+          q.push(std::move(slots));
+        };
+        auto handler = [&] (const paracel::str_view & line) {
+          lines.push_back(line.str());
+          if(lines.size() == chunk_lines) flush();
+        };
+        scheduler.structure_load_handle(partition_obj, handler);
+        if(lines.size()) flush();
+      } catch (...) {
+        err = std::current_exception();
+      }
+      q.close();
+    });
+
+    try {
+      slots_type slots;
+      while(true) {
+        int more = q.pop(slots) ? 1 : 0;
+        m_comm.allreduce(more);
+        if(more == 0) break;
+        slots.resize(m_comm.get_size());
+        scheduler.exchange(slots, stf);
+        slots.clear();
+      }
+    } catch (...) {
+      // unblock the reader before leaving
+      q.close();
+      reader.join();
+      throw;
+    }
+    reader.join();
+    // a failed reader fails the load on every rank, the others would wait
+    // for it in the collectives that follow
+    int failed = err ? 1 : 0;
+    m_comm.allreduce(failed);
+    if(err) {
+      std::rethrow_exception(err);
+    }
+    if(failed) {
+      throw std::runtime_error("loader: reading the input failed on another rank\n");
+    }
+    if(m_comm.get_rank() == 0) std::cout << "desirable lines got" << std::endl;
+  }
+
+  // whether filenames are binary files, they must all be or none
+  bool binary_input() {
+    auto fname_lst = paracel::expand(filenames);
+    size_t n = 0;
+    for(auto & fn : fname_lst) {
+      if(paracel::binary::is_binary(fn)) n += 1;
+    }
+    if(n && n != fname_lst.size()) {
+      throw std::invalid_argument("loader: binary and text input files mixed\n");
+    }
+    return n != 0;
+  }
+
+  void text_only() {
+    if(binary_input()) {
+      throw std::invalid_argument("loader: binary input holds default_id_type ids only\n");
+    }
+  }
+
+  paracel::list_type<std::unique_ptr<paracel::binary::reader> >
+  open_binary(paracel::binary::kind_type k) {
+    auto fname_lst = paracel::expand(filenames);
+    std::sort(fname_lst.begin(), fname_lst.end());
+    paracel::list_type<std::unique_ptr<paracel::binary::reader> > files;
+    for(auto & fn : fname_lst) {
+      files.emplace_back(new paracel::binary::reader(fn));
+      if(files.back()->kind() != k) {
+        throw std::invalid_argument("loader: " + fn + " is not a " +
+                                    (k == paracel::binary::csr ? "csr" : "dense") +
+                                    " binary file\n");
+      }
+    }
+    return files;
+  }
+
+  /**
+   * (file, block) pairs of this rank: the blocks of all files in name order
+   * are cut into get_size() contiguous runs of about equal rows + nnz
+   */
+  paracel::list_type<std::pair<size_t, uint64_t> >
+  binary_blocks(const paracel::list_type<std::unique_ptr<paracel::binary::reader> > & files) {
+    uint64_t total = 0;
+    for(auto & f : files) total += f->n_rows() + f->n_vals();
+    paracel::list_type<std::pair<size_t, uint64_t> > r;
+    uint64_t acc = 0, np = m_comm.get_size(), rk = m_comm.get_rank();
+    for(size_t i = 0; i < files.size(); ++i) {
+      for(uint64_t b = 0; b < files[i]->n_blocks(); ++b) {
+        auto & e = files[i]->entry(b);
+        uint64_t w = e.rows + e.nnz;
+        // owner of the block's midpoint
+        uint64_t owner = total ? (uint64_t)((acc + w / 2.) * np / total) : 0;
+        if(std::min(owner, np - 1) == rk) r.push_back(std::make_pair(i, b));
+        acc += w;
+      }
+    }
+    return r;
+  }
+
+  /**
+   * stream_exchange of binary csr input: this rank's blocks are hashed and
+   * shipped in rounds of at least chunk_lines triples, no lines to parse
+   */
+  void binary_exchange(paracel::scheduler & scheduler,
+                       paracel::list_type<paracel::compact_triple_type> & stf) {
+    paracel::trace_scope tr("load", "binary_exchange");
+    auto files = open_binary(paracel::binary::csr);
+    auto blks = binary_blocks(files);
+    paracel::list_type<paracel::list_type<paracel::compact_triple_type> > slots;
+    size_t next = 0;
+    while(true) {
+      size_t n = 0, st = next;
+      while(next < blks.size() && n < chunk_lines) {
+        auto blk = files[blks[next].first]->get_block(blks[next].second);
+        scheduler.block_organize(blk, slots);
+        n += blk.nnz;
+        next += 1;
+      }
+      int more = next > st ? 1 : 0;
+      m_comm.allreduce(more);
+      if(more == 0) break;
+      slots.resize(m_comm.get_size());
+      scheduler.exchange(slots, stf);
+      slots.clear();
+    }
+    m_comm.synchronize();
+    if(m_comm.get_rank() == 0) std::cout << "desirable lines got" << std::endl;
+  }
+
+  template <class G>
+  void build(paracel::list_type<paracel::compact_triple_type> & stf, G & grp) {
+    for(auto & tpl : stf) {
+      grp.add_edge(std::get<0>(tpl), 
+                   std::get<1>(tpl), 
+                   std::get<2>(tpl));
+    }
+    stf.resize(0); stf.shrink_to_fit(); paracel::cheat_to_os();
+  }
+
+  void build(paracel::scheduler & scheduler,
+             paracel::list_type<paracel::compact_triple_type> & stf,
+             paracel::bigraph_continuous & grp,
+             paracel::dict_type<paracel::default_id_type, paracel::default_id_type> & rm,
+             paracel::dict_type<paracel::default_id_type, paracel::default_id_type> & cm,
+             bool cache = false) {
     paracel::list_type<paracel::compact_triple_type> stf_new;
     scheduler.index_mapping(stf, stf_new, rm, cm);
     stf.resize(0); stf.shrink_to_fit(); paracel::cheat_to_os();
     m_comm.synchronize();
+    if(cache) cache_write(stf_new, &rm, &cm);
 
     for(auto & tpl : stf_new) {
       grp.add_edge(std::get<0>(tpl), 
@@ -380,10 +753,98 @@ class loader {
     stf_new.resize(0); stf_new.shrink_to_fit(); paracel::cheat_to_os();
   }
 
+  void build(paracel::scheduler & scheduler,
+             paracel::list_type<paracel::compact_triple_type> & stf,
+             Eigen::SparseMatrix<double, Eigen::RowMajor> & blk_mtx,
+             paracel::dict_type<paracel::default_id_type, paracel::default_id_type> & rm,
+             paracel::dict_type<paracel::default_id_type, paracel::default_id_type> & cm,
+             bool cache = false) {
+    paracel::list_type<paracel::compact_triple_type> stf_new;
+    scheduler.index_mapping(stf, stf_new, rm, cm);
+    if(m_comm.get_rank() == 0) std::cout << "process 0 index mapping finished" << std::endl;
+    if(cache) cache_write(stf_new, &rm, &cm);
+    
+    paracel::list_type<eigen_triple> nonzero_tpls;
+    for(auto & tpl : stf_new) {
+      nonzero_tpls.push_back(eigen_triple(std::get<0>(tpl), 
+                                          std::get<1>(tpl), 
+                                          std::get<2>(tpl)));
+    }
+    blk_mtx.resize(rm.size(), cm.size());
+    blk_mtx.setFromTriplets(nonzero_tpls.begin(), 
+                            nonzero_tpls.end());
+  }
+
+  paracel::graph_cache make_cache() {
+    return paracel::graph_cache(cache_dir,
+                                paracel::expand(filenames),
+                                pattern,
+                                mix,
+                                m_comm.get_rank(),
+                                m_comm.get_size(),
+                                cache_tag);
+  }
+
+  // all ranks take the cache or none does, the others would wait in the shuffle
+  template <class F>
+  bool cache_read(F & f,
+                  paracel::dict_type<paracel::default_id_type, paracel::default_id_type> *rm = NULL,
+                  paracel::dict_type<paracel::default_id_type, paracel::default_id_type> *cm = NULL) {
+    if(cache_dir.empty()) return false;
+    auto cache = make_cache();
+    // every rank maps its file first, so all of them read or all reload
+    auto mf = cache.open();
+    int miss = mf ? 0 : 1;
+    m_comm.allreduce(miss);
+    if(miss) return false;
+    paracel::trace_scope tr("load", "cache_read");
+    cache.read(*mf, f, rm, cm);
+    m_comm.synchronize();
+    if(m_comm.get_rank() == 0) std::cout << "cached triples got" << std::endl;
+    return true;
+  }
+
+  void cache_write(const paracel::list_type<paracel::compact_triple_type> & stf,
+                   const paracel::dict_type<paracel::default_id_type, paracel::default_id_type> *rm = NULL,
+                   const paracel::dict_type<paracel::default_id_type, paracel::default_id_type> *cm = NULL) {
+    if(cache_dir.empty()) return;
+    paracel::trace_scope tr("load", "cache_write");
+    auto cache = make_cache();
+    if(!cache.write(stf, rm, cm)) {
+      std::cerr << "loader: can not write cache " << cache.get_path() << std::endl;
+    }
+  }
+
+  void organize(paracel::scheduler & scheduler,
+                const paracel::list_type<paracel::str_type> & linelst,
+                paracel::list_type<
+                  paracel::list_type<paracel::compact_triple_type> > & result) {
+    if(tparserfunc) {
+      scheduler.triples_organize(linelst, tparserfunc, result);
+    } else {
+      scheduler.lines_organize(linelst, parserfunc, result);
+    }
+  }
+
+  // string ids and fvec lines need the field list of a parser_type
+  const parser_type & line_parser() const {
+    if(!parserfunc && tparserfunc) {
+      throw std::invalid_argument("loader: a triple_parser only loads default_id_type graphs and fmap matrices\n");
+    }
+    return parserfunc;
+  }
+
  private:
   T filenames;
   paracel::Comm m_comm;
   parser_type parserfunc;
+  triple_parser_type tparserfunc;
+  paracel::thrdpool *p_pool = NULL;
+  size_t chunk_lines = 1 << 18;
+  paracel::str_type cache_dir;
+  paracel::str_type cache_tag;
+  paracel::str_type balance_by = "bytes";
+  paracel::str_type balance_seps = " \t,|";
   paracel::str_type pattern = "fmap";
   bool mix = false;
 
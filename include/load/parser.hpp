@@ -19,6 +19,8 @@
 #include <functional>
 #include "paracel_types.hpp"
 #include "utils/ext_utility.hpp"
+#include "utils/str_view.hpp"
+#include "load/tokenizer.hpp"
 
 namespace paracel {
 
@@ -100,6 +102,104 @@ auto parser_b =
 
 using parser_type = std::function<paracel::list_type<paracel::str_type>(paracel::str_type)>;
 
+/**
+ * item of lines_organize's fsv/fset/fmap lines: 'b' or 'b:0.2'('|' or ' '
+ * may also lead the weight). w is left empty without a weight
+ */
+inline void split_item(const paracel::str_view & item,
+                       paracel::str_view & id,
+                       paracel::str_view & w) {
+  id = w = paracel::str_view();
+  size_t n = 0;
+  paracel::tokenize_any(item, "[:| ]*", [&] (const paracel::str_view & v) {
+    if(n == 0) {
+      id = v;
+    } else if(n == 1) {
+      w = v;
+    }
+    n += 1;
+  });
+}
+
+/**
+ * parses a line straight into id triples appended to the caller's buffer,
+ * for loaders with default_id_type ids(fsv, fmap and fset patterns).
+ * fields are separated by sep1 or sep2, items as in split_item
+ *   a b            ->  (a, b, 1.)
+ *   a b:0.2        ->  (a, b, 0.2)
+ *   a b 0.2        ->  (a, b, 0.2)
+ *   a b:0.1|c      ->  (a, b, 0.1), (a, c, 1.)  with mix, sep2 = '|'
+ * return false for lines scheduler::lines_organize rejects
+ */
+using triple_parser_type = std::function<bool(const paracel::str_view &,
+                                              bool,
+                                              paracel::list_type<paracel::compact_triple_type> &)>;
+
+class triple_parser {
+
+ public:
+  triple_parser(char sep1 = ' ', char sep2 = ' ') {
+    seps[0] = sep1;
+    seps[1] = sep2;
+  }
+
+  bool operator()(const paracel::str_view & line,
+                  bool mix,
+                  paracel::list_type<paracel::compact_triple_type> & out) const {
+    size_t st = 0;
+    while(st < line.size() && is_sep(line[st])) st += 1;
+    size_t en = st;
+    while(en < line.size() && !is_sep(line[en])) en += 1;
+    auto rest = line.substr(en);
+    paracel::str_view first, second;
+    size_t n = paracel::tokenize_any(rest, seps, [&] (const paracel::str_view & item) {
+      if(first.empty()) {
+        first = item;
+      } else if(second.empty()) {
+        second = item;
+      }
+    });
+    if(n == 0) return mix;
+    uint64_t a = paracel::to_uint64(line.substr(st, en - st));
+    if(n == 1) {
+      out.push_back(item_triple(a, first));
+    } else if(mix) {
+      paracel::tokenize_any(rest, seps, [&] (const paracel::str_view & item) {
+        out.push_back(item_triple(a, item));
+      });
+    } else if(n == 2) {
+      out.push_back(paracel::compact_triple_type(a,
+                                                 paracel::to_uint64(first),
+                                                 paracel::to_double(second)));
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  bool is_sep(char c) const {
+    return c == seps[0] || c == seps[1];
+  }
+
+  static paracel::compact_triple_type item_triple(uint64_t a,
+                                                  const paracel::str_view & item) {
+    paracel::str_view b, w;
+    split_item(item, b, w);
+    return paracel::compact_triple_type(a,
+                                        paracel::to_uint64(b),
+                                        w.empty() ? 1. : paracel::to_double(w));
+  }
+
+ private:
+  char seps[3] = {' ', ' ', '\0'};
+
+}; // class triple_parser
+
+inline triple_parser_type gen_triple_parser(char sep1 = ' ', char sep2 = ' ') {
+  return triple_parser(sep1, sep2);
+}
+
 template <class T>
 parser_type gen_parser(T & parser) {
   return std::bind(parser, std::placeholders::_1);
@@ -17,11 +17,17 @@
 #define FILE_275e6247_9a21_93f3_3d3c_51a539d1c8d6_HPP
 
 #include <sys/stat.h>
+#include <stdint.h>
 #include <fstream>
 #include <iostream>
+#include <algorithm>
 #include <functional>
+#include <stdexcept>
 
 #include "paracel_types.hpp"
+#include "load/line_reader.hpp"
+#include "load/gzip_input.hpp"
+#include "utils/thrdpool.hpp"
 
 namespace paracel {
 
@@ -54,6 +60,28 @@ class partition {
     }
   }
 
+  /**
+   * what files_partition evens out over the blocks
+   *   "bytes"(default) splits the bytes evenly. "records" and "edges" are
+   *   estimated by a sampling pass: a window of each stretch of the files
+   *   is read and its lines(records) or separator chars(edges, one per
+   *   item of an fmap/fset adjacency list) counted.
+   *   sample_bytes bounds the bytes read. gzip files can not be sampled at
+   *   their offsets, they are taken at the mean density of the text files
+   *   over their inflated size(from the gzip trailers, frame by frame for
+   *   framed files)
+   */
+  void set_balance(const paracel::str_type & by,
+                   const paracel::str_type & seps = " \t,|",
+                   size_t sample_bytes = 16 << 20) {
+    if(by != "bytes" && by != "records" && by != "edges") {
+      throw std::invalid_argument("partition: balance by bytes, records or edges, not " + by + "\n");
+    }
+    balance_by = by;
+    balance_seps = seps;
+    balance_sample_bytes = std::max(sample_bytes, (size_t)4096);
+  }
+
   void files_partition(int blk_sz = paracel::BLK_SZ) {
     if(pattern == "linesplit" || pattern == "fvec") {
       blk_sz = 1;
@@ -68,8 +96,13 @@ class partition {
       f.close();
       displs[i + 1] = displs[i] + tmp;
     }
+    index_files();
     long sz = displs.back();
     int nbk = np * blk_sz;
+    if(balance_by != "bytes" && sz > 0) {
+      weighted_partition(nbk);
+      return;
+    }
     long bk_sz = sz / static_cast<long>(nbk);
     long s, e;
     for(int i = 0; i < nbk; ++i) {
@@ -85,6 +118,11 @@ class partition {
     }
   }
 
+  // inflate frames of framed gzip input on pool's threads, NULL for none
+  void set_pool(paracel::thrdpool *pool) {
+    p_pool = pool;
+  }
+
   paracel::list_type<long> get_start_list() {
     return slst;
   }
@@ -121,111 +159,210 @@ class partition {
   paracel::list_type<paracel::str_type>
   files_load_lines_impl(long st, long en) {
     paracel::list_type<paracel::str_type> lines;
-    // to locate files index to load from
-    int fst = 0;
-    int fen = 0;
-    long offset;
-    for(size_t i = 0; i < namelst.size(); ++i) {
-      if(st >= displs[i]) {
-        fst = i;
-      }
-      if(en > displs[i + 1]) {
-        fen = i + 1;
+    files_for_each_line(st, en, [&lines] (const paracel::str_view & l) {
+      lines.push_back(l.str());
+    });
+    return lines;
+  }
+
+  // func takes a paracel::str_view or a paracel::str_type
+  template <class F>
+  void files_load_lines_impl(long st, long en, F & func) {
+    paracel::str_type buf;
+    files_for_each_line(st, en, [&func, &buf] (const paracel::str_view & l) {
+      call_line(func, l, buf, 0);
+    });
+  }
+
+ private:
+  // gzip kind of every file and the frames of framed ones, found once here
+  // instead of by every block read
+  void index_files() {
+    gz_kinds.assign(namelst.size(), paracel::gz::none);
+    frame_lsts.assign(namelst.size(), paracel::list_type<paracel::gz::frame>());
+    for(size_t fi = 0; fi < namelst.size(); ++fi) {
+      if(displs[fi + 1] <= displs[fi]) continue;
+      paracel::mapped_file mf(namelst[fi]);
+      gz_kinds[fi] = paracel::gz::detect(mf.data(), mf.size());
+      if(gz_kinds[fi] == paracel::gz::framed) {
+        frame_lsts[fi] = paracel::gz::frames(mf.data(), mf.size());
       }
     }
-    assert(fst <= fen);
-    bool flag = false;
-    // load from files
-    for(auto fi = fst; fi < fen + 1; ++fi) {
-      if(flag) { 
-        offset = 0;
-      } else {
-        offset = st - displs[fi];
+  }
+
+  // a stretch of the concatenated files and its estimated weight
+  struct segment {
+    long st, en;
+    double w;
+  };
+
+  /**
+   * cut the files into about 32 * nbk stretches, weigh each by a sampled
+   * window and put the block boundaries where the cumulative weight
+   * crosses k / nbk of the total, interpolating inside a stretch
+   */
+  void weighted_partition(int nbk) {
+    long sz = displs.back();
+    size_t nseg = (size_t)nbk * 32;
+    long seg_len = std::max(sz / (long)nseg, 1L);
+    long win = std::max(std::min(seg_len, (long)(balance_sample_bytes / nseg)), 1L);
+    bool tbl[256] = {false};
+    for(unsigned char c : balance_seps) tbl[c] = true;
+    // a line starts after each '\n', an adjacency list has a separator per edge
+    if(balance_by == "records") {
+      std::fill(tbl, tbl + 256, false);
+      tbl[(unsigned char)'\n'] = true;
+    } else {
+      tbl[(unsigned char)'\n'] = false;
+    }
+
+    paracel::list_type<segment> segs;
+    paracel::list_type<size_t> gz_segs;
+    double text_w = 0., text_bytes = 0.;
+    for(size_t fi = 0; fi < namelst.size(); ++fi) {
+      long fs = displs[fi], fe = displs[fi + 1];
+      if(fe <= fs) continue;
+      paracel::mapped_file mf(namelst[fi]);
+      // w of a gzip stretch holds its inflated bytes until density is known
+      if(gz_kinds[fi] == paracel::gz::framed) {
+        for(auto & fr : frame_lsts[fi]) {
+          gz_segs.push_back(segs.size());
+          segs.push_back(segment{fs + (long)fr.off, fs + (long)(fr.off + fr.len),
+                                 (double)paracel::gz::isize(mf.data(), fr)});
+        }
+        continue;
       }
-      assert(offset >= 0);
-      
-      std::ifstream f(namelst[fi]);
-      if(offset) {
-        f.seekg(offset - 1);
-        paracel::str_type l;
-        std::getline(f, l);
-        offset += l.size();
+      if(gz_kinds[fi] == paracel::gz::plain) {
+        gz_segs.push_back(segs.size());
+        paracel::gz::frame whole{0, mf.size()};
+        segs.push_back(segment{fs, fe, (double)paracel::gz::isize(mf.data(), whole)});
+        continue;
       }
-      if(fi == fen) {
-        while(offset + displs[fi] < en) {
-          paracel::str_type l;
-	        std::getline(f, l);
-	        offset += l.size() + 1;
-          lines.push_back(l);
-        }
-      } else {
-        flag = true;
-        while(1) {
-          paracel::str_type l;
-	        std::getline(f, l);
-	        if(l.size() == 0) {
-            break;
-          }
-          lines.push_back(l);
-        }
+      for(long s = fs; s < fe; s += seg_len) {
+        long e = std::min(fe, s + seg_len);
+        long w = std::min(win, e - s);
+        // jittered window, the same on every rank
+        uint64_t hsh = (uint64_t)s * 0x9e3779b97f4a7c15ULL;
+        long off = s - fs + (long)((hsh >> 33) % (uint64_t)(e - s - w + 1));
+        mf.advise_sequential(off, w);
+        size_t cnt = 0;
+        const unsigned char *p = reinterpret_cast<const unsigned char *>(mf.data()) + off;
+        for(long i = 0; i < w; ++i) cnt += tbl[p[i]];
+        double wt = (double)cnt / w * (e - s);
+        segs.push_back(segment{s, e, wt});
+        text_w += wt;
+        text_bytes += e - s;
       }
-      f.close();
-    } // end of for
-    return lines;
+    }
+    double density = text_bytes > 0 ? text_w / text_bytes : 1.;
+    for(auto i : gz_segs) {
+      segs[i].w *= density;
+    }
+
+    double total = 0.;
+    for(auto & sg : segs) total += sg.w;
+    long prev = 0;
+    double acc = 0.;
+    size_t k = 0;
+    for(int b = 1; b < nbk; ++b) {
+      double target = total * b / nbk;
+      while(k < segs.size() && acc + segs[k].w < target) {
+        acc += segs[k].w;
+        k += 1;
+      }
+      long cut = sz;
+      if(k < segs.size()) {
+        double frac = segs[k].w > 0 ? (target - acc) / segs[k].w : 0.;
+        cut = segs[k].st + (long)(frac * (segs[k].en - segs[k].st));
+      }
+      cut = std::max(cut, prev);
+      slst.push_back(prev);
+      elst.push_back(cut);
+      prev = cut;
+    }
+    slst.push_back(prev);
+    elst.push_back(sz);
   }
 
+  /**
+   * f(str_view) for every line of the block [st, en) of the concatenated files
+   *   offsets are those of the files on disk. a gzip file is read whole by
+   *   the block holding its first byte, a framed gzip file(see
+   *   gzip_input.hpp) frame by frame by the blocks holding their first bytes
+   */
   template <class F>
-  void files_load_lines_impl(long st, long en, F & func) {
-    // to locate files index to load from
-    int fst = 0;
-    int fen = 0;
-    long offset;
-    for(size_t i = 0; i < namelst.size(); ++i) {
-      if(st >= displs[i]) {
-        fst = i;
-      }
-      if(en > displs[i + 1]) {
-        fen = i + 1;
+  void files_for_each_line(long st, long en, F && f) {
+    for(size_t fi = 0; fi < namelst.size(); ++fi) {
+      long fs = displs[fi], fe = displs[fi + 1];
+      if(fe <= st || fs >= en) continue;
+      paracel::mapped_file mf(namelst[fi]);
+      size_t lo = st > fs ? st - fs : 0;
+      size_t hi = std::min(en, fe) - fs;
+      switch(gz_kinds[fi]) {
+        case paracel::gz::plain:
+          if(lo == 0) {
+            mf.advise_sequential(0, mf.size());
+            paracel::gz::for_each_line(mf.data(), mf.size(), f);
+          }
+          break;
+        case paracel::gz::framed:
+          frames_for_each_line(mf, frame_lsts[fi], lo, hi, f);
+          break;
+        default:
+          mf.advise_sequential(lo, hi - lo);
+          paracel::for_each_line(mf.data(), mf.size(), lo, hi, f);
       }
     }
-    assert(fst <= fen);
-    bool flag = false;
-    // load from files
-    for(auto fi = fst; fi < fen + 1; ++fi) {
-      if(flag) { 
-        offset = 0;
+  }
+
+  // frames of all starting in [lo, hi) are inflated a batch at a time, in parallel
+  template <class F>
+  void frames_for_each_line(const paracel::mapped_file & mf,
+                            const paracel::list_type<paracel::gz::frame> & all,
+                            size_t lo, size_t hi, F && f) {
+    auto before = [] (const paracel::gz::frame & fr, size_t off) {
+      return fr.off < off;
+    };
+    auto first = std::lower_bound(all.begin(), all.end(), lo, before);
+    auto last = std::lower_bound(first, all.end(), hi, before);
+    if(first == last) return;
+    const paracel::gz::frame *frs = &*first;
+    size_t nfrs = last - first;
+    mf.advise_sequential(frs[0].off, frs[nfrs - 1].off + frs[nfrs - 1].len - frs[0].off);
+    size_t nbatch = p_pool ? p_pool->size() * 2 : 1;
+    paracel::list_type<paracel::str_type> bufs(nbatch);
+    for(size_t b = 0; b < nfrs; b += nbatch) {
+      size_t n = std::min(nbatch, nfrs - b);
+      auto inflate = [&] (size_t k) {
+        paracel::gz::inflate_frame(mf.data(), frs[b + k], bufs[k]);
+      };
+      if(p_pool && n > 1) {
+        p_pool->parallel_for(0, n, inflate, 1);
       } else {
-        offset = st - displs[fi];
+        for(size_t k = 0; k < n; ++k) inflate(k);
       }
-      assert(offset >= 0);
-      
-      std::ifstream f(namelst[fi]);
-      if(offset) {
-        f.seekg(offset - 1);
-        paracel::str_type l;
-        std::getline(f, l);
-        offset += l.size();
+      for(size_t k = 0; k < n; ++k) {
+        paracel::for_each_line(bufs[k].data(), bufs[k].size(), 0, bufs[k].size(), f);
       }
-      if(fi == fen) {
-        while(offset + displs[fi] < en) {
-          paracel::str_type l;
-	        std::getline(f, l);
-	        offset += l.size() + 1;
-          func(l);
-        }
-      } else {
-        flag = true;
-        while(1) {
-          paracel::str_type l;
-	        std::getline(f, l);
-	        if(l.size() == 0) {
-            break;
-          }
-          func(l);
-        }
-      }
-      f.close();
-    } // end of for
+    }
+  }
+
+  template <class F>
+  static auto call_line(F & func,
+                        const paracel::str_view & l,
+                        paracel::str_type &,
+                        int) -> decltype(func(l), void()) {
+    func(l);
+  }
+
+  // handlers taking strings share one buffer instead of a string per line
+  template <class F>
+  static void call_line(F & func,
+                        const paracel::str_view & l,
+                        paracel::str_type & buf,
+                        long) {
+    buf.assign(l.data(), l.size());
+    func(buf);
   }
 
  private:
@@ -233,6 +370,12 @@ class partition {
   int np;
   paracel::str_type pattern;
   paracel::list_type<long> slst, elst, displs;
+  paracel::list_type<paracel::gz::kind_type> gz_kinds;
+  paracel::list_type<paracel::list_type<paracel::gz::frame> > frame_lsts;
+  paracel::thrdpool *p_pool = NULL;
+  paracel::str_type balance_by = "bytes";
+  paracel::str_type balance_seps = " \t,|";
+  size_t balance_sample_bytes = 16 << 20;
 
 }; // class partition
 
@@ -21,18 +21,22 @@
 #include <cstdint>
 #include <cstdlib>
 #include <mutex>
+#include <iterator>
 #include <functional>
 
 #include "partition.hpp"
+#include "load/parser.hpp"
+#include "load/tokenizer.hpp"
+#include "load/binary_format.hpp"
 #include "paracel_types.hpp"
 #include "utils/comm.hpp"
 #include "utils/decomp.hpp"
 #include "utils/ext_utility.hpp"
+#include "utils/thrdpool.hpp"
+#include "utils/rma_counters.hpp"
 
 namespace paracel {
 
-std::mutex scheduler_mtx;
-
 typedef paracel::list_type<paracel::triple_type> listriple_type;
 typedef paracel::list_type<paracel::list_type<paracel::triple_type> > listlistriple_type;
 
@@ -59,8 +63,20 @@ public:
   
   paracel::list_type<paracel::str_type> structure_load(paracel::partition &);
 
+  // structure_load_handle with the blocks balanced by stealing, see steal_blocks
   template <class F>
-  void schedule_load_handle(paracel::partition &, F &);
+  void schedule_load_handle(paracel::partition & partition_obj,
+                            F & func) {
+    int blk_sz = paracel::BLK_SZ;
+    if(pattern == "fvec" || pattern == "linesplit") {
+      blk_sz = 1;
+    }
+    auto slst = partition_obj.get_start_list();
+    auto elst = partition_obj.get_end_list();
+    steal_blocks(blk_sz, [&] (size_t i) {
+      partition_obj.files_load_lines_impl(slst[i], elst[i], func);
+    });
+  }
 
   template <class F>
   void structure_load_handle(paracel::partition & partition_obj,
@@ -104,55 +120,94 @@ public:
     return hf(i) % npx;
   }
 
+  // threads used by lines_organize and triples_organize, NULL for none
+  void set_pool(paracel::thrdpool *pool) {
+    p_pool = pool;
+  }
+
   template <class F>
   void lines_organize(const paracel::list_type<paracel::str_type> & lines,
                       F && parser_func,
                       paracel::list_type<
                         paracel::list_type<
                           paracel::compact_triple_type> > & line_slot_lst) {
-    line_slot_lst.resize(m_comm.get_size());
-    paracel::str_type delimiter("[:| ]*");
-    for(auto & line : lines) {
-      auto stf = parser_func(line);
-      if(stf.size() == 2) {
-        auto tmp = paracel::str_split(stf[1], delimiter);
-        if(tmp.size() == 1) {
-          paracel::compact_triple_type tpl(std::stoull(stf[0]), 
-                                           std::stoull(stf[1]), 1.);
-          line_slot_lst[h(std::stoull(stf[0]), std::stoull(stf[1]), npx, npy)].push_back(tpl);
+    using slots_type = paracel::list_type<paracel::list_type<paracel::compact_triple_type> >;
+    organize_chunks(lines.size(), line_slot_lst, [&] (size_t lo, size_t hi, slots_type & slots) {
+      paracel::str_view id, w;
+      auto add = [&] (paracel::default_id_type a, const paracel::str_view & item) {
+        paracel::split_item(item, id, w);
+        paracel::compact_triple_type tpl(a,
+                                         paracel::to_uint64(id),
+                                         w.empty() ? 1. : paracel::to_double(w));
+        slots[h(a, std::get<1>(tpl), npx, npy)].push_back(tpl);
+      };
+      for(size_t k = lo; k < hi; ++k) {
+        auto & line = lines[k];
+        auto stf = parser_func(line);
+        if(stf.size() == 2) {
+          add(paracel::to_uint64(stf[0]), stf[1]);
+        } else if(mix) {
+          if(stf.size() < 2) continue;
+          auto a = paracel::to_uint64(stf[0]);
+          for(paracel::default_id_type i = 1; i < stf.size(); ++i) {
+            add(a, stf[i]);
+          }
         } else {
-          paracel::compact_triple_type tpl(std::stoull(stf[0]), 
-                                           std::stoull(tmp[0]), 
-                                           std::stod(tmp[1]));
-          line_slot_lst[h(std::stoull(stf[0]), std::stoull(tmp[0]), npx, npy)].push_back(tpl);
-        }
-      } else if(mix) {
-        for(paracel::default_id_type i = 1; i < stf.size(); ++i) {
-          auto item = stf[i];
-          auto tmp = paracel::str_split(item, delimiter);
-          if(tmp.size() == 1) {
-            paracel::compact_triple_type tpl(std::stoull(stf[0]), 
-                                             std::stoull(item), 1.);
-            line_slot_lst[h(std::stoull(stf[0]), std::stoull(item), npx, npy)].push_back(tpl);
-          } else {
-            paracel::compact_triple_type tpl(std::stoull(stf[0]), 
-                                             std::stoull(tmp[0]), 
-                                             std::stod(tmp[1]));
-            line_slot_lst[h(std::stoull(stf[0]), std::stoull(tmp[0]), npx, npy)].push_back(tpl);
+          if(stf.size() != 3) {
+            std::cout << line << std::endl;
+            std::cerr << "internal error in lines_organize: fmt of input files not supported" << std::endl;
+            abort();
           }
+          paracel::compact_triple_type tpl(paracel::to_uint64(stf[0]), 
+                                           paracel::to_uint64(stf[1]), 
+                                           paracel::to_double(stf[2]));
+          slots[h(std::get<0>(tpl), std::get<1>(tpl), npx, npy)].push_back(tpl);
         }
-      } else {
-        if(stf.size() != 3) {
-          std::cout << line << std::endl;
+      } // for
+    });
+  }
+
+  /**
+   * lines_organize with a triple_parser_type, which parses each line in
+   * place: no list of field strings is built per line
+   */
+  void triples_organize(const paracel::list_type<paracel::str_type> & lines,
+                        const paracel::triple_parser_type & parser_func,
+                        paracel::list_type<
+                          paracel::list_type<
+                            paracel::compact_triple_type> > & line_slot_lst) {
+    using slots_type = paracel::list_type<paracel::list_type<paracel::compact_triple_type> >;
+    organize_chunks(lines.size(), line_slot_lst, [&] (size_t lo, size_t hi, slots_type & slots) {
+      paracel::list_type<paracel::compact_triple_type> tpls;
+      for(size_t k = lo; k < hi; ++k) {
+        tpls.clear();
+        if(!parser_func(lines[k], mix, tpls)) {
+          std::cout << lines[k] << std::endl;
           std::cerr << "internal error in lines_organize: fmt of input files not supported" << std::endl;
           abort();
         }
-        paracel::compact_triple_type tpl(std::stoull(stf[0]), 
-                                         std::stoull(stf[1]), 
-                                         std::stod(stf[2]));
-	      line_slot_lst[h(std::stoull(stf[0]), std::stoull(stf[1]), npx, npy)].push_back(tpl);
+        for(auto & tpl : tpls) {
+          slots[h(std::get<0>(tpl), std::get<1>(tpl), npx, npy)].push_back(tpl);
+        }
+      }
+    });
+  }
+
+  // hash the triples of a binary csr block into line_slot_lst, appending
+  void block_organize(const paracel::binary::block & blk,
+                      paracel::list_type<
+                        paracel::list_type<
+                          paracel::compact_triple_type> > & line_slot_lst) {
+    using slots_type = paracel::list_type<paracel::list_type<paracel::compact_triple_type> >;
+    organize_chunks(blk.rows, line_slot_lst, [&] (size_t lo, size_t hi, slots_type & slots) {
+      for(size_t r = lo; r < hi; ++r) {
+        paracel::default_id_type a = blk.row_ids[r];
+        for(uint64_t k = blk.row_ptr[r]; k < blk.row_ptr[r + 1]; ++k) {
+          slots[h(a, blk.col_ids[k], npx, npy)].push_back(
+              paracel::compact_triple_type(a, blk.col_ids[k], blk.vals[k]));
+        }
       }
-    } // for
+    });
   }
 
   template <class F = std::function< paracel::list_type<paracel::str_type>(paracel::str_type) > >
@@ -160,47 +215,50 @@ public:
   lines_organize(const paracel::list_type<paracel::str_type> & lines,
                  F && parser_func = default_parser) {
 
-    listlistriple_type line_slot_lst(m_comm.get_size());
-    paracel::str_type delimiter("[:| ]*");
-    for(auto & line : lines) { 
-      auto stf = parser_func(line);
-      if(stf.size() == 2) {
-        // bfs or part of fset case
-	      // ['a', 'b'] or ['a', 'b:0.2']
-	      auto tmp = paracel::str_split(stf[1], delimiter);
-	      if(tmp.size() == 1) {
-	        paracel::triple_type tpl(stf[0], stf[1], 1.);
-	        line_slot_lst[h(stf[0], stf[1], npx, npy)].push_back(tpl);
-	      } else {
-	        paracel::triple_type tpl(stf[0], tmp[0], std::stod(tmp[1]));
-	        line_slot_lst[h(stf[0], tmp[0], npx, npy)].push_back(tpl);
-	      }
-      } else if(mix) {
-        // fset case
-	      // ['a', 'b', 'c'] or ['a', 'b|0.2', 'c|0.4']
-        // but ['a', '0.2', '0.4'] is not supported here
-        for(paracel::default_id_type i = 1; i < stf.size(); ++i) {
-	        auto item = stf[i];
-	        auto tmp = paracel::str_split(item, delimiter);
-	        if(tmp.size() == 1) {
-	          paracel::triple_type tpl(stf[0], item, 1.);
-	          line_slot_lst[h(stf[0], item, npx, npy)].push_back(tpl);
-	        } else {
-	          paracel::triple_type tpl(stf[0], tmp[0], std::stod(tmp[1]));
-	          line_slot_lst[h(stf[0], tmp[0], npx, npy)].push_back(tpl);
-	        }
-	      } // end of for
-      } else {
-	      if(stf.size() != 3) { 
-          std::cout << line << std::endl;
-          std::cerr << "internal error in lines_organize: fmt of input files not supported" << std::endl;
-          abort();
-        }
-        // fsv case
-        paracel::triple_type tpl(stf[0], stf[1], std::stod(stf[2]));
-	      line_slot_lst[h(stf[0], stf[1], npx, npy)].push_back(tpl);
-      } // end of if
-    } // end of for
+    listlistriple_type line_slot_lst;
+    organize_chunks(lines.size(), line_slot_lst, [&] (size_t lo, size_t hi, listlistriple_type & slots) {
+      paracel::str_view id, w;
+      for(size_t k = lo; k < hi; ++k) {
+        auto & line = lines[k];
+        auto stf = parser_func(line);
+        if(stf.size() == 2) {
+          // bfs or part of fset case
+          // ['a', 'b'] or ['a', 'b:0.2']
+          paracel::split_item(stf[1], id, w);
+          if(w.empty()) {
+            paracel::triple_type tpl(stf[0], stf[1], 1.);
+            slots[h(stf[0], stf[1], npx, npy)].push_back(tpl);
+          } else {
+            paracel::triple_type tpl(stf[0], id.str(), paracel::to_double(w));
+            slots[h(stf[0], std::get<1>(tpl), npx, npy)].push_back(tpl);
+          }
+        } else if(mix) {
+          // fset case
+          // ['a', 'b', 'c'] or ['a', 'b|0.2', 'c|0.4']
+          // but ['a', '0.2', '0.4'] is not supported here
+          for(paracel::default_id_type i = 1; i < stf.size(); ++i) {
+            auto & item = stf[i];
+            paracel::split_item(item, id, w);
+            if(w.empty()) {
+              paracel::triple_type tpl(stf[0], item, 1.);
+              slots[h(stf[0], item, npx, npy)].push_back(tpl);
+            } else {
+              paracel::triple_type tpl(stf[0], id.str(), paracel::to_double(w));
+              slots[h(stf[0], std::get<1>(tpl), npx, npy)].push_back(tpl);
+            }
+          } // end of for
+        } else {
+          if(stf.size() != 3) { 
+            std::cout << line << std::endl;
+            std::cerr << "internal error in lines_organize: fmt of input files not supported" << std::endl;
+            abort();
+          }
+          // fsv case
+          paracel::triple_type tpl(stf[0], stf[1], paracel::to_double(stf[2]));
+          slots[h(stf[0], stf[1], npx, npy)].push_back(tpl);
+        } // end of if
+      } // end of for
+    });
     return line_slot_lst;
   }
 
@@ -337,12 +395,74 @@ public:
   } // index_mapping
   
 private:
-  void elect() { 
-    auto randint = [] (int l, int u) {
-      srand((unsigned)time(NULL));
-      return l + rand() % (u - l + 1);
-    };
-    leader = randint(0, m_comm.get_size() - 1); 
+  /**
+   * f(lo, hi, slots) hashes lines [lo, hi) into slots, one list per rank.
+   *   with a pool, fixed chunks of lines fill their own slots on the pool
+   *   threads, which are appended to line_slot_lst in chunk order: the
+   *   result equals the single thread one. the parser must be safe to call
+   *   concurrently then.
+   */
+  template <class T, class F>
+  void organize_chunks(size_t n,
+                       paracel::list_type<paracel::list_type<T> > & line_slot_lst,
+                       F && f) {
+    line_slot_lst.resize(m_comm.get_size());
+    size_t nchunks = 1;
+    if(p_pool && p_pool->size() > 1) {
+      nchunks = std::min(p_pool->size() * 4, n / min_chunk_lines);
+    }
+    if(nchunks <= 1) {
+      f(0, n, line_slot_lst);
+      return;
+    }
+    size_t grain = (n + nchunks - 1) / nchunks;
+    nchunks = (n + grain - 1) / grain;
+    paracel::list_type<paracel::list_type<paracel::list_type<T> > > bufs(nchunks);
+    p_pool->parallel_for(0, nchunks, [&] (size_t k) {
+      bufs[k].resize(line_slot_lst.size());
+      f(k * grain, std::min(n, (k + 1) * grain), bufs[k]);
+    }, 1);
+    p_pool->parallel_for(0, line_slot_lst.size(), [&] (size_t d) {
+      auto & dst = line_slot_lst[d];
+      size_t sz = dst.size();
+      for(auto & buf : bufs) {
+        sz += buf[d].size();
+      }
+      dst.reserve(sz);
+      for(auto & buf : bufs) {
+        dst.insert(dst.end(),
+                   std::make_move_iterator(buf[d].begin()),
+                   std::make_move_iterator(buf[d].end()));
+        paracel::list_type<T>().swap(buf[d]);
+      }
+    }, 1);
+  }
+
+  /**
+   * f(i) for every block i in [0, get_size() * blk_sz), each exactly once
+   *   rank r starts with its own run [r * blk_sz, (r + 1) * blk_sz) front to
+   *   back, then steals from the back of the other ranks' runs. a claim is
+   *   a one-sided fetch-and-add on the run owner's counter, which packs the
+   *   owner's claims in its low and the thieves' in its high 32 bits: the
+   *   run is used up once the two add up to blk_sz. so no rank hands out
+   *   blocks for the others and a rank stuck in a big block just loses the
+   *   rest of its run
+   */
+  template <class F>
+  void steal_blocks(int blk_sz, F && f) {
+    const uint64_t thief = (uint64_t)1 << 32;
+    int rk = m_comm.get_rank(), sz = m_comm.get_size();
+    paracel::rma_counters cnt(m_comm);
+    for(int k = 0; k < sz; ++k) {
+      int victim = (rk + k) % sz;
+      bool own = k == 0;
+      while(true) {
+        uint64_t old = cnt.fetch_add(victim, own ? 1 : thief);
+        uint64_t head = old & (thief - 1), tail = old >> 32;
+        if(head + tail >= (uint64_t)blk_sz) break;
+        f((size_t)victim * blk_sz + (own ? head : blk_sz - 1 - tail));
+      }
+    }
   }
 
 private:
@@ -351,7 +471,9 @@ private:
   paracel::Comm m_comm;
   int npx;
   int npy;
-  int leader = 0;
+  paracel::thrdpool *p_pool = NULL;
+  // below this many lines per chunk threads do not pay off
+  static const size_t min_chunk_lines = 4096;
 
 }; // class scheduler
 
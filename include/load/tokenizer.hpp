@@ -0,0 +1,248 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#ifndef FILE_dcb913c1_b05a_4156_babb_6865887bc91b_HPP
+#define FILE_dcb913c1_b05a_4156_babb_6865887bc91b_HPP
+
+#include <stdint.h>
+
+#include <cerrno>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "paracel_types.hpp"
+#include "utils/str_view.hpp"
+
+namespace paracel {
+
+/**
+ * f(str_view) for every field of s separated by sep, empty fields are
+ * skipped like paracel::str_split does. return the number of fields
+ */
+template <class F>
+size_t tokenize(const paracel::str_view & s, char sep, F && f) {
+  size_t n = 0, st = 0;
+  while(st <= s.size()) {
+    size_t en = s.find(sep, st);
+    if(en == paracel::str_view::npos) en = s.size();
+    if(en > st) {
+      f(s.substr(st, en - st));
+      n += 1;
+    }
+    st = en + 1;
+  }
+  return n;
+}
+
+// fields separated by any char of seps
+template <class F>
+size_t tokenize_any(const paracel::str_view & s, const char *seps, F && f) {
+  // bitmap of seps, a strchr call per char costs more than the parsing
+  uint64_t tbl[4] = {0, 0, 0, 0};
+  for(; *seps; ++seps) {
+    unsigned char c = *seps;
+    tbl[c >> 6] |= (uint64_t)1 << (c & 63);
+  }
+  size_t n = 0, st = 0;
+  for(size_t i = 0; i <= s.size(); ++i) {
+    unsigned char c = i == s.size() ? 0 : s[i];
+    if(i == s.size() || (tbl[c >> 6] >> (c & 63) & 1)) {
+      if(i > st) {
+        f(s.substr(st, i - st));
+        n += 1;
+      }
+      st = i + 1;
+    }
+  }
+  return n;
+}
+
+// fill fields(cleared first) with the views of s, reusing its capacity
+inline size_t tokenize(const paracel::str_view & s,
+                       char sep,
+                       paracel::list_type<paracel::str_view> & fields) {
+  fields.clear();
+  return tokenize(s, sep, [&fields] (const paracel::str_view & v) {
+    fields.push_back(v);
+  });
+}
+
+namespace detail {
+
+// strtoull/strtod need a terminated string
+template <class F>
+bool parse_slow(const paracel::str_view & s, F && f) {
+  char buf[128];
+  if(s.size() >= sizeof(buf)) {
+    paracel::str_type tmp = s.str();
+    return f(tmp.c_str());
+  }
+  std::memcpy(buf, s.data(), s.size());
+  buf[s.size()] = '\0';
+  return f(buf);
+}
+
+inline paracel::str_view trim(const paracel::str_view & s) {
+  size_t st = 0, en = s.size();
+  while(st < en && std::isspace(static_cast<unsigned char>(s[st]))) st += 1;
+  while(en > st && std::isspace(static_cast<unsigned char>(s[en - 1]))) en -= 1;
+  return s.substr(st, en - st);
+}
+
+} // namespace detail
+
+/**
+ * [+]digits, anything else is rejected. up to 19 digits are converted
+ * inline, longer ones by strtoull with its overflow check
+ */
+inline bool parse_uint64(const paracel::str_view & s, uint64_t & v) {
+  size_t i = 0;
+  if(s.size() && s[0] == '+') i = 1;
+  if(i == s.size()) return false;
+  uint64_t r = 0;
+  for(size_t j = i; j < s.size(); ++j) {
+    unsigned d = static_cast<unsigned char>(s[j]) - '0';
+    if(d > 9) return false;
+    r = r * 10 + d;
+  }
+  if(s.size() - i <= 19) {
+    v = r;
+    return true;
+  }
+  return detail::parse_slow(s, [&v] (const char *p) {
+    char *e;
+    errno = 0;
+    v = std::strtoull(p, &e, 10);
+    return errno == 0;
+  });
+}
+
+inline bool parse_int64(const paracel::str_view & s, int64_t & v) {
+  if(s.size() && s[0] == '-') {
+    uint64_t r;
+    if(!parse_uint64(s.substr(1), r) || r > (uint64_t)INT64_MAX + 1) return false;
+    v = -(int64_t)(r - 1) - 1;
+    return true;
+  }
+  uint64_t r;
+  if(!parse_uint64(s, r) || r > (uint64_t)INT64_MAX) return false;
+  v = r;
+  return true;
+}
+
+/**
+ * [+-]digits[.digits][(e|E)[+-]digits] with up to 19 significant digits and
+ * a small exponent is converted with one exactly rounded multiplication or
+ * division(clinger's fast path), so the result equals strtod's. everything
+ * else(long mantissas, inf, nan, hex) goes through strtod
+ */
+inline bool parse_double(const paracel::str_view & s, double & v) {
+  static const double pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+  size_t i = 0, n = s.size();
+  bool neg = false;
+  if(i < n && (s[i] == '-' || s[i] == '+')) {
+    neg = s[i] == '-';
+    i += 1;
+  }
+  uint64_t m = 0;
+  int digits = 0, scale = 0;
+  size_t st = i;
+  for(; i < n && (unsigned)(s[i] - '0') <= 9; ++i) {
+    if(m || s[i] != '0') digits += 1;
+    m = m * 10 + (s[i] - '0');
+  }
+  bool any = i > st;
+  if(i < n && s[i] == '.') {
+    i += 1;
+    size_t fst = i;
+    for(; i < n && (unsigned)(s[i] - '0') <= 9; ++i) {
+      if(m || s[i] != '0') digits += 1;
+      m = m * 10 + (s[i] - '0');
+      scale -= 1;
+    }
+    any = any || i > fst;
+  }
+  if(any && i < n && (s[i] == 'e' || s[i] == 'E')) {
+    i += 1;
+    bool eneg = false;
+    if(i < n && (s[i] == '-' || s[i] == '+')) {
+      eneg = s[i] == '-';
+      i += 1;
+    }
+    int e = 0;
+    size_t est = i;
+    for(; i < n && (unsigned)(s[i] - '0') <= 9 && e < 10000; ++i) {
+      e = e * 10 + (s[i] - '0');
+    }
+    if(i == est) any = false;
+    scale += eneg ? -e : e;
+  }
+  if(any && i == n && digits <= 19 &&
+     m <= ((uint64_t)1 << 53) && scale >= -22 && scale <= 22) {
+    double r = static_cast<double>(m);
+    r = scale < 0 ? r / pow10[-scale] : r * pow10[scale];
+    v = neg ? -r : r;
+    return true;
+  }
+  return detail::parse_slow(s, [&v] (const char *p) {
+    char *e;
+    v = std::strtod(p, &e);
+    return e != p && *e == '\0';
+  });
+}
+
+/**
+ * drop-in replacements of std::stoull and std::stod: surrounding blanks(a
+ * '\r' of crlf input) are ignored and, as with the std versions, trailing
+ * junk after a number is too. throw std::invalid_argument if nothing converts
+ */
+inline uint64_t to_uint64(const paracel::str_view & s) {
+  uint64_t v;
+  auto t = detail::trim(s);
+  if(parse_uint64(t, v)) return v;
+  bool ok = detail::parse_slow(t, [&v] (const char *p) {
+    char *e;
+    v = std::strtoull(p, &e, 10);
+    return e != p;
+  });
+  if(!ok) {
+    throw std::invalid_argument("to_uint64: invalid field " + s.str());
+  }
+  return v;
+}
+
+inline double to_double(const paracel::str_view & s) {
+  double v;
+  auto t = detail::trim(s);
+  if(parse_double(t, v)) return v;
+  bool ok = detail::parse_slow(t, [&v] (const char *p) {
+    char *e;
+    v = std::strtod(p, &e);
+    return e != p;
+  });
+  if(!ok) {
+    throw std::invalid_argument("to_double: invalid field " + s.str());
+  }
+  return v;
+}
+
+} // namespace paracel
+
+#endif
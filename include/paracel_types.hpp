@@ -46,6 +46,8 @@ const int threads_num = 5;
 
 const size_t split_sz = 500;
 
+const size_t async_queue_sz = 64;
+
 const std::string seperator = "_PARACEL_";
 
 const std::string seperator_inner = "_ps_";
@@ -56,6 +58,17 @@ const std::string default_update_func_name = "paracel_default_incr";
 
 const std::string default_port = "7773";
 
+// server sockets also listen here, suffixed with "<pid>_<tcp port>". servers
+// advertise their pid after ipc_mark at the end of their ports
+const std::string ipc_prefix = "ipc:///tmp/paracel_";
+const char ipc_mark = '@';
+
+// pass as server_info to host a server shard inside every worker
+const std::string embedded_srv = "embedded";
+
+// read copies of hot keys are stored under this prefix on other servers
+const std::string replica_prefix = "__paracel_replica__";
+
 const int any_source = MPI_ANY_SOURCE;
 
 const int any_tag = MPI_ANY_TAG;
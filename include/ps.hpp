@@ -22,9 +22,16 @@
 #include <set>
 #include <tuple>
 #include <queue>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <fstream>
+#include <sstream>
+#include <iterator>
 #include <utility>
 #include <future>
+#include <condition_variable>
 #include <algorithm>
 #include <functional>
 #include <stdexcept>
@@ -42,7 +49,12 @@
 #include "utils.hpp"
 #include "packer.hpp"
 #include "client.hpp"
+#include "embedded.hpp"
 #include "paracel_types.hpp"
+#include "utils/bqueue.hpp"
+#include "utils/node_share.hpp"
+#include "utils/thrdpool.hpp"
+#include "utils/trace.hpp"
 
 namespace paracel {
 
@@ -84,6 +96,35 @@ class paralg {
     dlclose(handler);
   }
 
+  // func(lines) for the blocks of fnames in order, each block read by one
+  // rank per node and handed to the others through shared memory
+  template <class F>
+  void shared_loadall(const paracel::list_type<paracel::str_type> & fnames, F && func) {
+    paracel::partition partition_obj(fnames, get_worker_size(), "linesplit");
+    partition_obj.set_pool(load_pool());
+    partition_obj.files_partition();
+    auto slst = partition_obj.get_start_list();
+    auto elst = partition_obj.get_end_list();
+    auto read = [&] (size_t i) {
+      paracel::str_type text;
+      auto append = [&text] (const paracel::str_view & l) {
+        text.append(l.data(), l.size());
+        text.push_back('\n');
+      };
+      partition_obj.files_load_lines_impl(slst[i], elst[i], append);
+      return text;
+    };
+    paracel::node_share ns(worker_comm);
+    ns.for_each_block(slst.size(), read, [&func] (size_t, const paracel::str_view & text) {
+      paracel::list_type<paracel::str_type> lines;
+      paracel::for_each_line(text.data(), text.size(), 0, text.size(),
+                             [&lines] (const paracel::str_view & l) {
+        lines.push_back(l.str());
+      });
+      func(lines);
+    });
+  }
+
  public:
   // constructor for direct usage
   paralg(paracel::Comm comm,
@@ -110,7 +151,7 @@ class paralg {
                                     rounds(_rounds),
                                     limit_s(_limit_s),
                                     ssp_switch(_ssp_switch) {
-    ps_obj = new parasrv(hosts_dct_str);
+    ps_obj = new parasrv(hosts_dct_str, worker_comm);
     init_output(_output);
     clock = 0;
     stale_cache = 0;
@@ -125,11 +166,153 @@ class paralg {
   }
 
   virtual ~paralg() {
+    if(p_commthrd) {
+      p_commthrd->flush();
+      delete p_commthrd;
+      p_commthrd = NULL;
+    }
+    if(profile_flag && ps_obj && output.size()) {
+      std::ofstream os(paracel::todir(output) + "profile_"
+                       + std::to_string(worker_comm.get_rank()));
+      os << paracel_profile();
+    }
+    if(p_pool) {
+      delete p_pool;
+    }
     if(ps_obj) {
+      bool embedded = ps_obj->local_srv >= 0;
+      // the local shard serves other workers until all of them are done
+      if(embedded) worker_comm.synchronize();
       delete ps_obj;
+      if(embedded) {
+        // queued replica copies still go to the shards of other workers
+        paracel::drain_embedded_forwards();
+        worker_comm.synchronize();
+        paracel::stop_embedded_thrds();
+      }
     }
   }
 
+  /**
+   * Hand paracel_write* and paracel_bupdate* over to a background comm thread.
+   * These calls enqueue and return true immediately, blocking only when
+   * queue_sz requests are already pending. paracel_sync flushes the queue and
+   * any other ps op waits for it first, so reads still see local writes.
+   * In ssp mode bupdate stays synchronous since the cache needs its result.
+   */
+  void set_async_push(bool flag,
+                      size_t queue_sz = paracel::async_queue_sz) {
+    if(p_commthrd) {
+      p_commthrd->flush();
+      delete p_commthrd;
+      p_commthrd = NULL;
+    }
+    if(flag && ps_obj) {
+      p_commthrd = new commthrd(queue_sz);
+    }
+  }
+
+  // cache the shuffled input of paracel_load_as_graph/matrix in folder,
+  // see loader::set_cache. tag should tell the parsers apart
+  void set_load_cache(const paracel::str_type & folder,
+                      const paracel::str_type & tag = "") {
+    load_cache_dir = folder;
+    load_cache_tag = tag;
+  }
+
+  // balance paracel_load_as_graph/matrix blocks by "bytes", "records" or
+  // "edges", see partition::set_balance
+  void set_load_balance(const paracel::str_type & by,
+                        const paracel::str_type & seps = " \t,|") {
+    load_balance_by = by;
+    load_balance_seps = seps;
+  }
+
+  // read paracel_loadall and paracel_sequential_loadall input once per node,
+  // sharing blocks among the ranks of a node, see node_share
+  void set_loadall_share(bool flag = true) {
+    loadall_share = flag;
+  }
+
+  // threads used by paracel_parallel_*, 0 means every core available to this worker.
+  // once called, the loaders read and parse their input on them as well
+  void set_parallel_thrds(size_t n = 0) {
+    if(p_pool) {
+      delete p_pool;
+    }
+    p_pool = new paracel::thrdpool(n);
+    load_parallel = true;
+  }
+
+  size_t get_parallel_thrds() {
+    return get_pool().size();
+  }
+
+  /**
+   * Run func(i) for i in [begin, end) on the worker's local thread pool.
+   * Loop bodies may read/write/update the ps concurrently(hogwild style),
+   * except in ssp mode where the local stale cache is not thread-safe.
+   */
+  template <class F>
+  void paracel_parallel_for(size_t begin, size_t end,
+                            F func,
+                            size_t grain = 0) {
+    get_pool().parallel_for(begin, end, func, grain);
+  }
+
+  // func(i, acc) folds into a per-thread accumulator, combine merges them
+  template <class T, class F, class R>
+  T paracel_parallel_reduce(size_t begin, size_t end,
+                            const T & init,
+                            F func,
+                            R combine,
+                            size_t grain = 0) {
+    return get_pool().parallel_reduce(begin, end, init, func, combine, grain);
+  }
+
+  // write paracel_profile() to output/profile_<worker id> at exit(off by default)
+  void set_profile(bool flag) {
+    profile_flag = flag;
+  }
+
+  /**
+   * Where this worker's time went so far:
+   *   worker <id> wall <s> compute <s> pull <s> push <s> sync <s>
+   *   op <name> <cnt> <bytes_out> <bytes_in> <mean_us> <p50_us> <p99_us> <max_us>
+   * pull/push/sync is time spent inside paracel_read*, paracel_write*,
+   * paracel_update/bupdate* and paracel_sync, compute is the rest of the
+   * wall time. op lines come from the kvclt counters summed over servers.
+   */
+  paracel::str_type paracel_profile() {
+    auto wall = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start_tp).count();
+    double pull_s = pull_ns.load() / 1e9;
+    double push_s = push_ns.load() / 1e9;
+    double sync_s = sync_ns.load() / 1e9;
+    double wall_s = wall / 1e9;
+    double compute_s = std::max(0., wall_s - pull_s - push_s - sync_s);
+    std::ostringstream os;
+    os << "worker " << get_worker_id()
+        << " wall " << wall_s << " compute " << compute_s
+        << " pull " << pull_s << " push " << push_s
+        << " sync " << sync_s << '\n';
+    if(!ps_obj) return os.str();
+    paracel::dict_type<paracel::str_type, paracel::clt_op_stat> ops;
+    for(auto & kvc : ps_obj->kvm) {
+      for(auto & kv : kvc.get_stats()) {
+        ops[kv.first].merge(kv.second);
+      }
+    }
+    for(auto & kv : ops) {
+      auto & h = kv.second.latency;
+      os << "op " << kv.first << " " << kv.second.cnt << " "
+          << kv.second.bytes_out << " " << kv.second.bytes_in << " "
+          << h.mean() / 1e3 << " " << h.percentile(0.5) / 1e3 << " "
+          << h.percentile(0.99) / 1e3 << " " << h.max() / 1e3 << '\n';
+    }
+    return os.str();
+  }
+
   void set_decomp_info(const paracel::str_type & pattern) {
     int np = worker_comm.get_size();
     paracel::npfactx(np, npx, npy);
@@ -146,25 +329,40 @@ class paralg {
   paracel_loadall(const T & fn) {
     auto fname_lst = paracel::expand(fn);
     paracel::list_type<paracel::str_type> lines;
+    if(loadall_share) {
+      shared_loadall(fname_lst, [&lines] (paracel::list_type<paracel::str_type> & blk) {
+        std::move(blk.begin(), blk.end(), std::back_inserter(lines));
+      });
+      return lines;
+    }
+    long sz = 0;
     for(auto & fname : fname_lst) {
-      std::ifstream f(fname, std::ios::binary);
+      std::ifstream f(fname, std::ios::binary | std::ios::ate);
       if(!f) { 
         throw std::runtime_error("internal error in paracel_loadall: loader reading failed.");
       }
-      paracel::str_type l;
-      while(std::getline(f, l)) {
-        lines.push_back(l);
-      }
-      f.close();
+      sz += f.tellg();
     }
-    return lines;
+    if(sz == 0) return lines;
+    // one block over every file, through the partition reader for gzip input
+    paracel::partition partition_obj(fname_lst, 1, "linesplit");
+    partition_obj.set_pool(load_pool());
+    partition_obj.files_partition();
+    auto slst = partition_obj.get_start_list();
+    auto elst = partition_obj.get_end_list();
+    return partition_obj.files_load_lines_impl(slst[0], elst[0]);
   }
 
   template <class T, class F>
   void paracel_sequential_loadall(const T & fn, F & func) {
     
     auto fname_lst = paracel::expand(fn);
+    if(loadall_share) {
+      shared_loadall(fname_lst, func);
+      return;
+    }
     paracel::partition partition_obj(fname_lst, get_worker_size(), "linesplit");
+    partition_obj.set_pool(load_pool());
     partition_obj.files_partition();
     auto slst = partition_obj.get_start_list();
     auto elst = partition_obj.get_end_list();
@@ -206,11 +404,14 @@ class paralg {
     set_decomp_info(pattern);
   }
 
+  // parser is a parser_type or, for default_id_type ids, a triple_parser_type.
+  // lines are parsed on the calling thread unless set_parallel_thrds was
+  // called, then on its threads and parser must be safe to call concurrently
   // only support paracel::digraph<paracel::default_id_type> and paracel::digraph<std::string>
-  template <class T, class G>
+  template <class T, class G, class P>
   void paracel_load_as_graph(paracel::digraph<G> & grp,
                              const T & fn, 
-                             parser_type & parser,
+                             P & parser,
                              const paracel::str_type & pattern = "fmap",
                              bool mix_flag = false) {
     // TODO: check pattern 
@@ -219,19 +420,20 @@ class paralg {
     }
     // load lines
     paracel::loader<T> ld(fn, worker_comm, parser, pattern, mix_flag);
-    paracel::list_type<paracel::str_type> lines = ld.fixload();
+    ld.set_pool(load_pool());
+    ld.set_cache(load_cache_dir, load_cache_tag);
+    ld.set_balance(load_balance_by, load_balance_seps);
+    // create graph, streamed with the loading for default_id_type ids
+    ld.load_graph(grp);
     paracel_sync();
-    // create graph 
-    ld.create_graph(lines, grp);
     set_decomp_info(pattern);
-    lines.resize(0); lines.shrink_to_fit(); paracel::cheat_to_os();
   }
 
   // only support paracel::bigraph<paracel::default_id_type> and paracel::bigraph<std::string>
-  template <class T, class G>
+  template <class T, class G, class P>
   void paracel_load_as_graph(paracel::bigraph<G> & grp,
                              const T & fn,
-                             parser_type & parser,
+                             P & parser,
                              const paracel::str_type & pattern = "fmap",
                              bool mix_flag = false) {
     if(pattern == "fset") {
@@ -240,20 +442,21 @@ class paralg {
     // TODO: check pattern 
     // load lines
     paracel::loader<T> ld(fn, worker_comm, parser, pattern, mix_flag);
-    paracel::list_type<paracel::str_type> lines = ld.fixload();
+    ld.set_pool(load_pool());
+    ld.set_cache(load_cache_dir, load_cache_tag);
+    ld.set_balance(load_balance_by, load_balance_seps);
+    // create graph, streamed with the loading for default_id_type ids
+    ld.load_graph(grp);
     paracel_sync();
-    // create graph 
-    ld.create_graph(lines, grp);
     set_decomp_info(pattern);
-    lines.resize(0); lines.shrink_to_fit(); paracel::cheat_to_os();
   }
 
-  template <class T>
+  template <class T, class P>
   void paracel_load_as_graph(paracel::bigraph_continuous & grp,
                              paracel::dict_type<paracel::default_id_type, paracel::default_id_type> & row_map,
                              paracel::dict_type<paracel::default_id_type, paracel::default_id_type> & col_map,
                              const T & fn,
-                             parser_type & parser,
+                             P & parser,
                              const paracel::str_type & pattern = "fmap",
                              bool mix_flag = false) {
     // TODO: check pattern 
@@ -262,38 +465,39 @@ class paralg {
     }
     // load lines
     paracel::loader<T> ld(fn, worker_comm, parser, pattern, mix_flag);
-    paracel::list_type<paracel::str_type> lines = ld.fixload();
+    ld.set_pool(load_pool());
+    ld.set_cache(load_cache_dir, load_cache_tag);
+    ld.set_balance(load_balance_by, load_balance_seps);
+    ld.load_graph(grp, row_map, col_map);
     paracel_sync();
-    // create graph 
-    ld.create_graph(lines, grp, row_map, col_map);
     set_decomp_info(pattern);
-    lines.resize(0); lines.shrink_to_fit(); paracel::cheat_to_os();
   }
 
-  template <class T, class G>
+  template <class T, class G, class P>
   void paracel_load_as_matrix(Eigen::SparseMatrix<double, Eigen::RowMajor> & blk_mtx,
                               paracel::dict_type<paracel::default_id_type, G> & row_map,
                               paracel::dict_type<paracel::default_id_type, G> & col_map,
                               const T & fn, 
-                              parser_type & parser,
+                              P & parser,
                               const paracel::str_type & pattern = "fsmap",
                               bool mix_flag = false) {
     // TODO: check pattern
     // load lines
     paracel::loader<T> ld(fn, worker_comm, parser, pattern, mix_flag);
-    paracel::list_type<paracel::str_type> lines = ld.fixload();
+    ld.set_pool(load_pool());
+    ld.set_cache(load_cache_dir, load_cache_tag);
+    ld.set_balance(load_balance_by, load_balance_seps);
+    // create sparse matrix, streamed with the loading for default_id_type ids
+    ld.load_matrix(blk_mtx, row_map, col_map);
     paracel_sync();
-    // create sparse matrix
-    ld.create_matrix(lines, blk_mtx, row_map, col_map);
     set_decomp_info(pattern);
-    lines.resize(0); lines.shrink_to_fit(); paracel::cheat_to_os();
   }
   
-  template <class T, class G>
+  template <class T, class G, class P>
   void paracel_load_as_matrix(Eigen::SparseMatrix<double, Eigen::RowMajor> & blk_mtx,
                               paracel::dict_type<paracel::default_id_type, G> & row_map,
                               const T & fn, 
-                              parser_type & parser,
+                              P & parser,
                               const paracel::str_type & pattern = "fsmap",
                               bool mix_flag = false) {
     paracel::dict_type<paracel::default_id_type, G> col_map;
@@ -303,10 +507,10 @@ class paralg {
   }
 
   // simple interface
-  template <class T>
+  template <class T, class P>
   void paracel_load_as_matrix(Eigen::SparseMatrix<double, Eigen::RowMajor> & blk_mtx,
                               const T & fn, 
-                              parser_type & parser,
+                              P & parser,
                               const paracel::str_type & pattern = "fsmap",
                               bool mix_flag = false) {
     return paralg::paracel_load_as_matrix(blk_mtx, rm, cm,
@@ -319,14 +523,12 @@ class paralg {
                               const T & fn, 
                               parser_type & parser) {
 
-    // load lines
+    // load lines or binary dense blocks
     paracel::loader<T> ld(fn, worker_comm, parser, "fvec", true);
-    paracel::list_type<paracel::str_type> lines = ld.fixload();
+    // create dense matrix
+    ld.load_matrix(blk_dense_mtx, row_map);
     paracel_sync();
-    // create sparse matrix
-    ld.create_matrix(lines, blk_dense_mtx, row_map);
     set_decomp_info("fvec");
-    lines.resize(0); lines.shrink_to_fit(); paracel::cheat_to_os();
   }
 
   // simple interface
@@ -341,6 +543,8 @@ class paralg {
 
   // put where you want to control iter with ssp
   void iter_commit() {
+    paracel::trace_scope tr("ps", "iter_commit");
+    async_flush();
     paracel::str_type clock_key;
     if(limit_s == 0) {
       clock_key = "client_clock_0";
@@ -362,6 +566,7 @@ class paralg {
   bool paracel_register_update(const paracel::str_type & file_name,
                                const paracel::str_type & func_name) {
     load_update_f(file_name, func_name);
+    async_flush();
     bool r = true;
     for(int i = 0; i < ps_obj->srv_sz; ++i) {
       r = r && ps_obj->kvm[i].register_update(file_name, func_name);
@@ -372,6 +577,7 @@ class paralg {
   bool paracel_register_bupdate(const paracel::str_type & file_name,
                                 const paracel::str_type & func_name) {
     //local_update_f(file_name, func_name);
+    async_flush();
     bool r = true;
     for(int i = 0; i < ps_obj->srv_sz; ++i) {
       r = r && ps_obj->kvm[i].register_bupdate(file_name, func_name);
@@ -381,6 +587,7 @@ class paralg {
 
   bool paracel_register_read_special(const paracel::str_type & file_name,
                                      const paracel::str_type & func_name) {
+    async_flush();
     bool r = true;
     for(int i = 0; i < ps_obj->srv_sz; ++i) {
       r = r && ps_obj->kvm[i].register_pullall_special(file_name,
@@ -391,6 +598,7 @@ class paralg {
 
   bool paracel_register_remove_special(const paracel::str_type & file_name,
                                        const paracel::str_type & func_name) {
+    async_flush();
     bool r = true;
     for(int i = 0; i < ps_obj->srv_sz; ++i) {
       r = r && ps_obj->kvm[i].register_remove_special(file_name, func_name);
@@ -398,10 +606,32 @@ class paralg {
     return r;
   }
 
+  /**
+   * Serve reads of a hot key from n servers(n <= 0 means all of them).
+   * The owning server registers the copies and forwards every change it
+   * applies to them, whoever wrote it, so one call from any worker is
+   * enough. Copies carry the owner's version of the key and never go back
+   * to an older value, writes and updates return once their copies are
+   * sent. paracel_read spreads over the copies by worker id(or replica_id),
+   * workers that did not call this learn the count from the owner on their
+   * first read of key. paracel_read_multi/readall always go to the owner.
+   */
+  bool paracel_set_replicas(const paracel::str_type & key, int n = 0) {
+    return ps_obj->set_replicas(key, n);
+  }
+
+  // copies of key this worker spreads its paracel_read over(1 until it
+  // registered them or read key once since the owner keeps them)
+  int paracel_replica_num(const paracel::str_type & key) {
+    return ps_obj->replica_num(key);
+  }
+
   template <class V>
   bool paracel_read(const paracel::str_type & key,
                     V & val,
                     int replica_id = -1) {
+    op_timer tm(pull_ns, "paracel_read");
+    async_flush();
     if(ssp_switch) {
       /*
          std::cout << "--------------" << std::endl;
@@ -410,9 +640,7 @@ class paralg {
          std::cout << "--------------" << std::endl;
       */  
       if(clock == 0 || clock == total_iters) { // check total_iters for last pull
-        cached_para[key] = boost::any_cast<V>(ps_obj->
-                                              kvm[ps_obj->p_ring->get_server(key)].
-                                              pull<V>(key));
+        cached_para[key] = boost::any_cast<V>(ps_obj->pull_replica<V>(key, replica_slot(replica_id)));
         val = boost::any_cast<V>(cached_para[key]);
       } else if(stale_cache + limit_s > clock) {
         // cache hit
@@ -424,25 +652,23 @@ class paralg {
           stale_cache = ps_obj->
               kvm[clock_server].pull_int(paracel::str_type("server_clock"));
         }
-        cached_para[key] = boost::any_cast<V>(ps_obj->
-                                              kvm[ps_obj->p_ring->get_server(key)].
-                                              pull<V>(key));
+        cached_para[key] = boost::any_cast<V>(ps_obj->pull_replica<V>(key, replica_slot(replica_id)));
         val = boost::any_cast<V>(cached_para[key]);
       }
       return true;
     }
-    return ps_obj->kvm[ps_obj->p_ring->get_server(key)].pull(key, val); 
+    return ps_obj->pull_replica(key, val, replica_slot(replica_id));
   }
 
   template <class V>
   V paracel_read(const paracel::str_type & key,
                  int replica_id = -1) {
+    op_timer tm(pull_ns, "paracel_read");
+    async_flush();
     if(ssp_switch) {
       V val;
       if(clock == 0 || clock == total_iters) {
-        cached_para[key] = boost::any_cast<V>(ps_obj->
-                                              kvm[ps_obj->p_ring->get_server(key)].
-                                              pull<V>(key));
+        cached_para[key] = boost::any_cast<V>(ps_obj->pull_replica<V>(key, replica_slot(replica_id)));
         val = boost::any_cast<V>(cached_para[key]);
       } else if(stale_cache + limit_s > clock) {
         val = boost::any_cast<V>(cached_para[key]);
@@ -451,19 +677,19 @@ class paralg {
           stale_cache = ps_obj->
               kvm[clock_server].pull_int(paracel::str_type("server_clock"));
         }
-        cached_para[key] = boost::any_cast<V>(ps_obj->
-                                              kvm[ps_obj->p_ring->get_server(key)].
-                                              pull<V>(key));
+        cached_para[key] = boost::any_cast<V>(ps_obj->pull_replica<V>(key, replica_slot(replica_id)));
         val = boost::any_cast<V>(cached_para[key]);
       }
       return val;
     }
-    return ps_obj->kvm[ps_obj->p_ring->get_server(key)].pull<V>(key);
+    return ps_obj->pull_replica<V>(key, replica_slot(replica_id));
   }
 
   template <class V>
   void paracel_read_multi(const paracel::list_type<paracel::str_type> & keys,
                           paracel::dict_type<paracel::str_type, V> & vals) {
+    op_timer tm(pull_ns, "paracel_read_multi");
+    async_flush();
     vals.clear();
     paracel::list_type<paracel::list_type<paracel::str_type> > lst_lst(ps_obj->srv_sz);
     for(size_t k = 0; k < keys.size(); ++k) {
@@ -482,6 +708,8 @@ class paralg {
   template<class V>
   paracel::list_type<V> 
   paracel_read_multi(const paracel::list_type<paracel::str_type> & keys) {
+    op_timer tm(pull_ns, "paracel_read_multi");
+    async_flush();
     paracel::list_type<V> vals;
     paracel::dict_type<paracel::str_type, size_t> indx_map;
     paracel::list_type<paracel::list_type<paracel::str_type> > lst_lst(ps_obj->srv_sz);
@@ -536,6 +764,8 @@ class paralg {
   // TODO
   template<class V>
   paracel::dict_type<paracel::str_type, V> paracel_readall() {
+    op_timer tm(pull_ns, "paracel_readall");
+    async_flush();
     paracel::dict_type<paracel::str_type, V> d;
     for(int indx = 0; indx < ps_obj->srv_sz; ++indx) {
       auto tmp = ps_obj->kvm[indx].pullall<V>();
@@ -548,6 +778,7 @@ class paralg {
   
   template<class V, class F>
   void paracel_readall_handle(F & func) {
+    async_flush();
     for(int indx = 0; indx < ps_obj->srv_sz; ++indx) {
       paracel::dict_type<paracel::str_type, V> d;
       auto tmp = ps_obj->kvm[indx].pullall<V>();
@@ -562,6 +793,8 @@ class paralg {
   paracel::dict_type<paracel::str_type, V>
   paracel_read_special(const paracel::str_type & file_name,
                        const paracel::str_type & func_name) {
+    op_timer tm(pull_ns, "paracel_read_special");
+    async_flush();
     paracel::dict_type<paracel::str_type, V> d;
     for(int indx = 0; indx < ps_obj->srv_sz; ++indx) {
       auto tmp = ps_obj->kvm[indx].pullall_special<V>(file_name, func_name);
@@ -576,6 +809,7 @@ class paralg {
   void paracel_read_special_handle(const paracel::str_type & file_name,
                                    const paracel::str_type & func_name,
                                    F & func) {
+    async_flush();
     for(int indx = 0; indx < ps_obj->srv_sz; ++indx) {
       paracel::dict_type<paracel::str_type, V> d;
       auto tmp = ps_obj->kvm[indx].pullall_special<V>(file_name, func_name);
@@ -649,10 +883,25 @@ class paralg {
   bool paracel_write(const paracel::str_type & key,
                      const V & val,
                      bool replica_flag = false) {
+    op_timer tm(push_ns, "paracel_write");
     auto indx = ps_obj->p_ring->get_server(key);
     if(ssp_switch) {
       cached_para[key] = boost::any_cast<V>(val);
     }
+    if(replica_flag && ps_obj->replica_num(key) == 1) {
+      ps_obj->set_replicas(key, 0);
+    }
+    if(indx == ps_obj->local_srv) {
+      // queued ops of this worker go first, they may touch the same key
+      async_flush();
+      return ps_obj->local_push(key, val);
+    }
+    if(p_commthrd) {
+      p_commthrd->post([this, indx, key, val] () {
+        return (ps_obj->kvm[indx]).push(key, val);
+      });
+      return true;
+    }
     return (ps_obj->kvm[indx]).push(key, val);
   }
 
@@ -660,12 +909,13 @@ class paralg {
                      const char* val,
                      bool replica_flag = false) {
     paracel::str_type v = val;
-    return paralg::paracel_write(key, v); 
+    return paralg::paracel_write(key, v, replica_flag);
   }
 
   // TODO: package
   template <class V>
   bool paracel_write_multi(const paracel::dict_type<paracel::str_type, V> & dct) {
+    op_timer tm(push_ns, "paracel_write_multi");
     if(ssp_switch) {
       for(auto & kv : dct) {
         cached_para[kv.first] = boost::any_cast<V>(kv.second);
@@ -678,6 +928,13 @@ class paralg {
     }
     for(size_t k = 0; k < dct_lst.size(); ++k) {
       if(dct_lst[k].size() != 0) {
+        if(p_commthrd) {
+          auto dct_k = std::move(dct_lst[k]);
+          p_commthrd->post([this, k, dct_k] () {
+            return ps_obj->kvm[k].push_multi(dct_k);
+          });
+          continue;
+        }
         if(ps_obj->kvm[k].push_multi(dct_lst[k]) == false) {
           r = false;
         }
@@ -691,6 +948,7 @@ class paralg {
                       const V & delta,
                       paracel::async_functor_type & update_future,
                       bool replica_flag = false) {
+    op_timer tm(push_ns, "paracel_update");
     if(ssp_switch) {
       if(!update_f) {
         // load default updater
@@ -706,6 +964,10 @@ class paralg {
       V nval = pk1.unpack(nv);
       cached_para[key] = boost::any_cast<V>(nval);
     }
+    async_flush();
+    if(replica_flag && ps_obj->replica_num(key) == 1) {
+      ps_obj->set_replicas(key, 0);
+    }
     ps_obj->kvm[ps_obj->p_ring->get_server(key)].update(key, delta, update_future);
   }
 
@@ -714,7 +976,7 @@ class paralg {
                       paracel::async_functor_type & update_future,
                       bool replica_flag = false) {
     paracel::str_type d = delta;
-    paralg::paracel_update(key, d, update_future);
+    paralg::paracel_update(key, d, update_future, replica_flag);
   }
   
   template <class V>
@@ -723,6 +985,7 @@ class paralg {
                       const paracel::str_type & file_name,
                       const paracel::str_type & func_name,
                       paracel::async_functor_type & update_future) {
+    op_timer tm(push_ns, "paracel_update");
     if(ssp_switch) {
       V val = boost::any_cast<V>(cached_para[key]);
       // pack<V> val to v & delta to d
@@ -733,6 +996,7 @@ class paralg {
       V nval = pk1.unpack(nv);
       cached_para[key] = boost::any_cast<V>(nval);
     }
+    async_flush();
     ps_obj->kvm[ps_obj->p_ring->get_server(key)].update(key,
                                                         delta,
                                                         file_name,
@@ -754,7 +1018,20 @@ class paralg {
   bool paracel_bupdate(const paracel::str_type & key,
                        const V & delta,
                        bool replica_flag = false) {
+    op_timer tm(push_ns, "paracel_bupdate");
     int indx = ps_obj->p_ring->get_server(key);
+    if(replica_flag && ps_obj->replica_num(key) == 1) {
+      ps_obj->set_replicas(key, 0);
+    }
+    if(p_commthrd && !ssp_switch) {
+      p_commthrd->post([this, indx, key, delta] () {
+        bool rr = false;
+        ps_obj->kvm[indx].bupdate(key, delta, rr);
+        return rr;
+      });
+      return true;
+    }
+    async_flush();
     bool r = false;
     auto new_val = ps_obj->kvm[indx].bupdate(key, delta, r);
     if(ssp_switch) {
@@ -782,7 +1059,20 @@ class paralg {
                        const paracel::str_type & file_name, 
                        const paracel::str_type & func_name,
                        bool replica_flag = false) {
+    op_timer tm(push_ns, "paracel_bupdate");
     int indx = ps_obj->p_ring->get_server(key);
+    if(replica_flag && ps_obj->replica_num(key) == 1) {
+      ps_obj->set_replicas(key, 0);
+    }
+    if(p_commthrd && !ssp_switch) {
+      p_commthrd->post([this, indx, key, delta, file_name, func_name] () {
+        bool rr = false;
+        ps_obj->kvm[indx].bupdate(key, delta, file_name, func_name, rr);
+        return rr;
+      });
+      return true;
+    }
+    async_flush();
     bool r = false;
     auto new_val = ps_obj->kvm[indx].bupdate(key,
                                              delta,
@@ -812,6 +1102,7 @@ class paralg {
                              const paracel::list_type<V> & deltas,
                              const paracel::str_type & file_name,
                              const paracel::str_type & func_name) {
+    op_timer tm(push_ns, "paracel_bupdate_multi");
     paracel::list_type<std::pair<paracel::list_type<paracel::str_type>,
                                 paracel::list_type<V> > > kd_lst(ps_obj->srv_sz);
     bool r = true;
@@ -820,6 +1111,20 @@ class paralg {
       kd_lst[indx].first.push_back(keys[i]);
       kd_lst[indx].second.push_back(deltas[i]);
     }
+    if(p_commthrd && !ssp_switch) {
+      for(size_t k = 0; k < kd_lst.size(); ++k) {
+        if(kd_lst[k].first.size() == 0) continue;
+        auto key_lst = std::move(kd_lst[k].first);
+        auto delta_lst = std::move(kd_lst[k].second);
+        p_commthrd->post([this, k, key_lst, delta_lst, file_name, func_name] () {
+          bool rr = false;
+          ps_obj->kvm[k].bupdate_multi(key_lst, delta_lst, file_name, func_name, rr);
+          return rr;
+        });
+      }
+      return true;
+    }
+    async_flush();
     for(size_t k = 0; k < kd_lst.size(); ++k) {
       auto key_lst = kd_lst[k].first;
       auto delta_lst = kd_lst[k].second;
@@ -843,11 +1148,25 @@ class paralg {
   bool paracel_bupdate_multi(const paracel::dict_type<paracel::str_type, V> & dct,
                              const paracel::str_type & file_name,
                              const paracel::str_type & func_name) {
+    op_timer tm(push_ns, "paracel_bupdate_multi");
     bool r = true;
     paracel::list_type<paracel::dict_type<paracel::str_type, V> > dct_lst(ps_obj->srv_sz);
     for(auto & kv : dct) {
       dct_lst[ps_obj->p_ring->get_server(kv.first)][kv.first] = kv.second;
     }
+    if(p_commthrd && !ssp_switch) {
+      for(size_t k = 0; k < dct_lst.size(); ++k) {
+        if(dct_lst[k].size() == 0) continue;
+        auto dct_k = std::move(dct_lst[k]);
+        p_commthrd->post([this, k, dct_k, file_name, func_name] () {
+          bool rr = false;
+          ps_obj->kvm[k].bupdate_multi(dct_k, file_name, func_name, rr);
+          return rr;
+        });
+      }
+      return true;
+    }
+    async_flush();
     for(size_t k = 0; k < dct_lst.size(); ++k) {
       if(dct_lst[k].size() != 0) {
         bool rr = false;
@@ -888,6 +1207,8 @@ class paralg {
   }
 
   void paracel_sync() {
+    op_timer tm(sync_ns, "paracel_sync");
+    async_flush();
     worker_comm.synchronize();
   }
 
@@ -912,13 +1233,15 @@ class paralg {
   }
 
   bool paracel_contains(const paracel::str_type & key) {
-    auto indx = ps_obj->p_ring->get_server(key);
-    return (ps_obj->kvm[indx]).contains(key);
+    op_timer tm(pull_ns, "paracel_contains");
+    async_flush();
+    return ps_obj->contains(key);
   }
 
   bool paracel_remove(const paracel::str_type & key) {
-    auto indx = ps_obj->p_ring->get_server(key);
-    return ps_obj->kvm[indx].remove(key);
+    op_timer tm(push_ns, "paracel_remove");
+    async_flush();
+    return ps_obj->remove(key);
   }
 
   bool paracel_remove_multi(const paracel::list_type<paracel::str_type> & key_lst) {
@@ -926,6 +1249,149 @@ class paralg {
     return true;
   }
 
+  /**
+   * Every server dumps its table to folder/snapshot_<server index> on its
+   * own host. Dumps run in forked children so serving is not blocked, the
+   * files show up once they are complete(written to .tmp then renamed).
+   * Returns once every dump finished, false if any of them failed(or one
+   * of those servers was still busy with an earlier snapshot).
+   */
+  bool paracel_snapshot(const paracel::str_type & folder) {
+    async_flush();
+    paracel_sync();
+    bool r = true;
+    paracel::list_type<int> started;
+    for(int i = 0; i < ps_obj->srv_sz; ++i) {
+      if((size_t)i % get_worker_size() == get_worker_id()) {
+        auto fn = paracel::todir(folder) + "snapshot_" + std::to_string(i);
+        if(ps_obj->kvm[i].snapshot(fn)) {
+          started.push_back(i);
+        } else {
+          r = false;
+        }
+      }
+    }
+    for(auto i : started) {
+      int state;
+      while((state = ps_obj->kvm[i].snapshot_status()) == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      }
+      r = state > 0 && r;
+    }
+    paracel_sync();
+    return r;
+  }
+
+  // server i mmaps folder/snapshot_<i>, keys stay on the shard that owned them
+  bool paracel_restore(const paracel::str_type & folder) {
+    async_flush();
+    bool r = true;
+    for(int i = 0; i < ps_obj->srv_sz; ++i) {
+      if((size_t)i % get_worker_size() == get_worker_id()) {
+        auto fn = paracel::todir(folder) + "snapshot_" + std::to_string(i);
+        r = ps_obj->kvm[i].restore(fn) && r;
+      }
+    }
+    paracel_sync();
+    return r;
+  }
+
+  /**
+   * Write the stats report of server i(see srv_stats.hpp) to
+   * folder/srv_stats_<i>, folder defaults to the output folder.
+   * reset starts a fresh measurement window on the servers.
+   */
+  void paracel_dump_stats(const paracel::str_type & folder = "",
+                          bool reset = false) {
+    async_flush();
+    auto dir = paracel::todir(folder.size() ? folder : output);
+    for(int i = 0; i < ps_obj->srv_sz; ++i) {
+      if((size_t)i % get_worker_size() == get_worker_id()) {
+        std::ofstream os(dir + "srv_stats_" + std::to_string(i));
+        os << ps_obj->kvm[i].stats(reset);
+      }
+    }
+    paracel_sync();
+  }
+
+  // the k most accessed keys over all servers with their estimated access counts
+  paracel::list_type<std::pair<paracel::str_type, uint64_t> >
+  paracel_hot_keys(size_t k = 10) {
+    async_flush();
+    paracel::dict_type<paracel::str_type, uint64_t> cnts;
+    for(int i = 0; i < ps_obj->srv_sz; ++i) {
+      std::istringstream is(ps_obj->kvm[i].stats());
+      paracel::str_type line;
+      while(std::getline(is, line)) {
+        if(!paracel::startswith(line, "key ")) continue;
+        auto pos = line.find(' ', 4);
+        if(pos == paracel::str_type::npos) continue;
+        auto key = line.substr(pos + 1);
+        if(paracel::startswith(key, paracel::replica_prefix)) {
+          key = key.substr(paracel::replica_prefix.size());
+        }
+        cnts[key] += std::stoull(line.substr(4, pos - 4));
+      }
+    }
+    paracel::list_type<std::pair<paracel::str_type, uint64_t> > r(cnts.begin(), cnts.end());
+    std::sort(r.begin(), r.end(),
+              [] (const std::pair<paracel::str_type, uint64_t> & a,
+                  const std::pair<paracel::str_type, uint64_t> & b) {
+                return a.second > b.second;
+              });
+    if(r.size() > k) r.resize(k);
+    return r;
+  }
+
+  /**
+   * Record ps calls, loader phases and(for embedded servers) request
+   * handling of this process, keeping the latest cap events per thread.
+   * Standalone servers trace when started with --trace.
+   */
+  void paracel_trace(bool flag, size_t cap = 1 << 16) {
+    if(flag) {
+      paracel::tracer::enable(cap);
+    } else {
+      paracel::tracer::disable();
+    }
+  }
+
+  /**
+   * Every worker dumps its events to folder/trace_<worker id>.json and asks
+   * its share of standalone servers for folder/trace_srv_<i>.json, then
+   * worker 0 merges them into folder/trace.json(chrome://tracing).
+   * pids are worker ids, server i shows up as pid worker_size + i.
+   * folder must be shared by all hosts for the merge.
+   */
+  void paracel_dump_trace(const paracel::str_type & folder = "") {
+    async_flush();
+    auto dir = paracel::todir(folder.size() ? folder : output);
+    auto wsz = get_worker_size();
+    paracel::tracer::dump(dir + "trace_" + std::to_string(get_worker_id()) + ".json",
+                          get_worker_id());
+    bool standalone = ps_obj && ps_obj->local_srv < 0;
+    if(standalone) {
+      for(int i = 0; i < ps_obj->srv_sz; ++i) {
+        if((size_t)i % wsz == get_worker_id()) {
+          ps_obj->kvm[i].trace_dump(dir + "trace_srv_" + std::to_string(i) + ".json",
+                                    wsz + i);
+        }
+      }
+    }
+    paracel_sync();
+    if(get_worker_id() == 0) {
+      paracel::list_type<paracel::str_type> fns;
+      for(size_t i = 0; i < wsz; ++i) {
+        fns.push_back(dir + "trace_" + std::to_string(i) + ".json");
+      }
+      for(int i = 0; standalone && i < ps_obj->srv_sz; ++i) {
+        fns.push_back(dir + "trace_srv_" + std::to_string(i) + ".json");
+      }
+      paracel::tracer::merge(fns, dir + "trace.json");
+    }
+    paracel_sync();
+  }
+
   template <class T>
   void pkl_dat(const T & m, std::string prefix = "tmp") {
     try {
@@ -1246,7 +1712,11 @@ class paralg {
     using dl_type = paracel::list_type<paracel::dict_type<paracel::str_type, paracel::str_type> >; 
 
    public:
-    parasrv(paracel::str_type hosts_dct_str) {
+    parasrv(paracel::str_type hosts_dct_str, paracel::Comm & comm) {
+      if(hosts_dct_str == paracel::embedded_srv) {
+        hosts_dct_str = start_embedded(comm);
+        local_srv = comm.get_rank();
+      }
       // init dct_lst
       dct_lst = paracel::get_hostnames_dict(hosts_dct_str);
       // init srv_sz
@@ -1268,15 +1738,287 @@ class paralg {
       delete p_ring;
     }
 
+    // keys owned by the in-process shard skip zmq, msgpack framing and copies
+
+    template <class V>
+    bool pull(const paracel::str_type & key, V & val) {
+      return pull_from(p_ring->get_server(key), key, val);
+    }
+
+    template <class V>
+    V pull(const paracel::str_type & key) {
+      if(p_ring->get_server(key) != local_srv) {
+        return kvm[p_ring->get_server(key)].pull<V>(key);
+      }
+      V val;
+      if(!pull(key, val)) {
+        ERROR_ABORT("key does not exist");
+      }
+      return val;
+    }
+
+    template <class V>
+    bool local_push(const paracel::str_type & key, const V & val) {
+      paracel::packer<V> pk(val);
+      paracel::str_type s;
+      pk.pack(s);
+      paracel::embedded_set(key, s);
+      return true;
+    }
+
+    bool contains(const paracel::str_type & key) {
+      auto indx = p_ring->get_server(key);
+      if(indx != local_srv) {
+        return kvm[indx].contains(key);
+      }
+      return paracel::embedded_contains(key);
+    }
+
+    // the owner drops the copies of a hot key itself
+    bool remove(const paracel::str_type & key) {
+      return remove_from(p_ring->get_server(key), key);
+    }
+
+    /**
+     * hot keys: copy 0 is the key on its owner, copy i(0 < i < n) is
+     * replica_key(key) on the i-th server after the owner. the owner keeps
+     * the copies up to date, replica_dct only tells this worker where to read
+     */
+    bool set_replicas(const paracel::str_type & key, int n) {
+      if(n <= 0 || n > srv_sz) n = srv_sz;
+      paracel::list_type<paracel::str_type> hosts, ports;
+      for(int i = 1; i < n; ++i) {
+        auto & srv = dct_lst[replica_server(key, i)];
+        hosts.push_back(srv["host"]);
+        ports.push_back(srv["ports"]);
+      }
+      bool r = kvm[p_ring->get_server(key)].set_replicas(key, hosts, ports);
+      std::lock_guard<std::mutex> lk(replica_mtx);
+      replica_dct[key] = n;
+      return r;
+    }
+
+    int replica_num(const paracel::str_type & key) {
+      std::lock_guard<std::mutex> lk(replica_mtx);
+      auto it = replica_dct.find(key);
+      return it == replica_dct.end() ? 1 : it->second;
+    }
+
+    /**
+     * read copy r % n of key, the owner's when that copy is not there yet.
+     * reads of keys without known copies go to the owner, which tells how
+     * many it keeps, so readers spread over them without registering
+     */
+    template <class V>
+    bool pull_replica(const paracel::str_type & key, V & val, size_t r) {
+      int n = replica_num(key);
+      if(n == 1) {
+        int copies = 1;
+        if(!pull_hot(key, val, copies)) return false;
+        if(copies > 1) {
+          std::lock_guard<std::mutex> lk(replica_mtx);
+          replica_dct[key] = copies;
+        }
+        return true;
+      }
+      int i = r % n;
+      if(i != 0 && pull_from(replica_server(key, i), replica_key(key), val)) {
+        return true;
+      }
+      return pull(key, val);
+    }
+
+    template <class V>
+    V pull_replica(const paracel::str_type & key, size_t r) {
+      V val;
+      if(!pull_replica(key, val, r)) {
+        ERROR_ABORT("key does not exist");
+      }
+      return val;
+    }
+
+   private:
+    int replica_server(const paracel::str_type & key, int i) {
+      return (p_ring->get_server(key) + i) % srv_sz;
+    }
+
+    static paracel::str_type replica_key(const paracel::str_type & key) {
+      return paracel::replica_prefix + key;
+    }
+
+    template <class V>
+    bool pull_from(int indx, const paracel::str_type & key, V & val) {
+      if(indx != local_srv) {
+        return kvm[indx].pull(key, val);
+      }
+      paracel::str_type s;
+      if(!paracel::embedded_get(key, s)) return false;
+      paracel::packer<V> pk;
+      val = pk.unpack(s);
+      return true;
+    }
+
+    template <class V>
+    bool pull_hot(const paracel::str_type & key, V & val, int & copies) {
+      auto indx = p_ring->get_server(key);
+      if(indx != local_srv) {
+        return kvm[indx].pull_hot(key, val, copies);
+      }
+      copies = paracel::embedded_copies(key);
+      return pull_from(indx, key, val);
+    }
+
+    bool remove_from(int indx, const paracel::str_type & key) {
+      if(indx != local_srv) {
+        return kvm[indx].remove(key);
+      }
+      return paracel::embedded_del(key);
+    }
+
+    // start the local shard, gather every rank's "host:ports" in rank order
+    paracel::str_type start_embedded(paracel::Comm & comm) {
+      auto local = std::to_string(comm.get_rank()) 
+          + paracel::seperator_inner 
+          + paracel::start_embedded_thrds();
+      paracel::list_type<paracel::str_type> srvs(comm.get_size());
+      auto collect = [&srvs] (const paracel::str_type & s) {
+        auto l = paracel::str_split_by_word(s, paracel::seperator_inner);
+        srvs[std::stoi(l[0])] = l[1];
+      };
+      comm.bcastring(local, collect);
+      paracel::str_type r;
+      for(size_t i = 0; i < srvs.size(); ++i) {
+        r += srvs[i];
+        if(i != srvs.size() - 1) {
+          r += paracel::seperator;
+        }
+      }
+      return r;
+    }
+
    public:
     dl_type dct_lst;
     int srv_sz = 1;
     l_type kvm;
     paracel::list_type<int> servers;
     paracel::ring<int> *p_ring;
+    int local_srv = -1; // index of the in-process shard in embedded mode
+
+   private:
+    paracel::dict_type<paracel::str_type, int> replica_dct;
+    std::mutex replica_mtx;
 
   }; // nested class parasrv 
 
+  // background thread draining queued push ops in fifo order
+  class commthrd {
+
+    using task_type = std::function<bool()>;
+
+   public:
+    commthrd(size_t queue_sz) : task_queue(queue_sz) {
+      thrd = std::thread(&commthrd::run, this);
+    }
+
+    virtual ~commthrd() {
+      task_queue.close();
+      thrd.join();
+    }
+
+    void post(task_type && task) {
+      {
+        std::lock_guard<std::mutex> lk(mtx);
+        pending += 1;
+      }
+      // counted before the push so run() can not see it first, rolled back
+      // if the queue is already closed
+      if(!task_queue.push(std::move(task))) {
+        std::lock_guard<std::mutex> lk(mtx);
+        failed = true;
+        pending -= 1;
+        if(pending == 0) drained.notify_all();
+      }
+    }
+
+    // wait for all posted ops, return false if any of them failed
+    bool flush() {
+      std::unique_lock<std::mutex> lk(mtx);
+      drained.wait(lk, [this] { return pending == 0; });
+      bool r = !failed;
+      failed = false;
+      return r;
+    }
+
+   private:
+    void run() {
+      task_type task;
+      while(task_queue.pop(task)) {
+        bool r = false;
+        try {
+          r = task();
+        } catch (const std::exception & e) {
+          ERROR_PRINT(e, "async push failed: ");
+        }
+        std::lock_guard<std::mutex> lk(mtx);
+        if(!r) failed = true;
+        pending -= 1;
+        if(pending == 0) drained.notify_all();
+      }
+    }
+
+   private:
+    paracel::bqueue<task_type> task_queue;
+    std::thread thrd;
+    std::mutex mtx;
+    std::condition_variable drained;
+    size_t pending = 0;
+    bool failed = false;
+
+  }; // nested class commthrd
+
+  // paracel_read picks its copy of a hot key by worker id unless told
+  size_t replica_slot(int replica_id) {
+    return replica_id < 0 ? get_worker_id() : (size_t)replica_id;
+  }
+
+  // adds the lifetime of a ps call to one of the profile buckets(and the trace)
+  class op_timer {
+   public:
+    op_timer(std::atomic<uint64_t> & bucket, const char *name) : acc(bucket),
+        tr("ps", name), t0(std::chrono::steady_clock::now()) {}
+
+    ~op_timer() {
+      acc += std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - t0).count();
+    }
+
+   private:
+    std::atomic<uint64_t> & acc;
+    paracel::trace_scope tr;
+    std::chrono::steady_clock::time_point t0;
+  };
+
+  paracel::thrdpool & get_pool() {
+    if(!p_pool) {
+      p_pool = new paracel::thrdpool;
+    }
+    return *p_pool;
+  }
+
+  // loading stays single-threaded until set_parallel_thrds asks for threads
+  paracel::thrdpool * load_pool() {
+    return load_parallel ? p_pool : NULL;
+  }
+
+  bool async_flush() {
+    if(!p_commthrd) return true;
+    bool r = p_commthrd->flush();
+    if(!r) {
+      ERROR_ABORT("async push failed before flush");
+    }
+    return r;
+  }
+
  private:
   int stale_cache, clock, total_iters;
   int clock_server = 0;
@@ -1287,6 +2029,19 @@ class paralg {
   int limit_s = 0;
   bool ssp_switch = false;
   parasrv *ps_obj;
+  commthrd *p_commthrd = NULL;
+  paracel::thrdpool *p_pool = NULL;
+  bool load_parallel = false;
+  paracel::str_type load_cache_dir;
+  paracel::str_type load_cache_tag;
+  paracel::str_type load_balance_by = "bytes";
+  paracel::str_type load_balance_seps = " \t,|";
+  bool loadall_share = false;
+  bool profile_flag = false;
+  std::chrono::steady_clock::time_point start_tp = std::chrono::steady_clock::now();
+  std::atomic<uint64_t> pull_ns{0};
+  std::atomic<uint64_t> push_ns{0};
+  std::atomic<uint64_t> sync_ns{0};
   paracel::dict_type<paracel::default_id_type, paracel::default_id_type> rm;
   paracel::dict_type<paracel::default_id_type, paracel::default_id_type> cm;
   paracel::dict_type<paracel::default_id_type, paracel::default_id_type> dm;
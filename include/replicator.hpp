@@ -0,0 +1,194 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#ifndef FILE_56e24437_2af0_40c4_b37b_1682e124a324_HPP
+#define FILE_56e24437_2af0_40c4_b37b_1682e124a324_HPP
+
+#include <stdint.h>
+
+#include <mutex>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <iostream>
+#include <condition_variable>
+
+#include "client.hpp"
+#include "paracel_types.hpp"
+
+namespace paracel {
+
+/**
+ * owner side of read replicas(see paralg::paracel_set_replicas)
+ *   a key registered here is copied, as replica_prefix + key, to its
+ *   replica servers after every change the owner applies, whoever issued
+ *   it. each change gets the next version of the key under the table lock
+ *   and replica servers keep the highest version they saw, so copies end up
+ *   at the owner's latest value in whatever order forwards land.
+ *   forwards go out from one thread to the replica servers' read port,
+ *   whose thread never waits on another server(nor on a full queue, the
+ *   queue is unbounded), so servers can not wait on each other in a cycle
+ */
+class replicator {
+
+ public:
+  replicator() {}
+
+  replicator(const replicator &) = delete;
+
+  replicator & operator=(const replicator &) = delete;
+
+  ~replicator() {
+    stop();
+  }
+
+  // under the table lock: copies of key go to the servers(host, ports),
+  // cur is its value now(NULL if absent)
+  void add(const paracel::str_type & key,
+           const paracel::list_type<paracel::str_type> & hosts,
+           const paracel::list_type<paracel::str_type> & ports,
+           const paracel::str_type *cur) {
+    auto & ent = reg[key];
+    ent.eps.clear();
+    for(size_t i = 0; i < hosts.size() && i < ports.size(); ++i) {
+      ent.eps.push_back(hosts[i] + paracel::seperator_inner + ports[i]);
+    }
+    changed(key, cur);
+  }
+
+  bool empty() const {
+    return reg.empty();
+  }
+
+  // under the table lock: copies of key including the owner's
+  int copies(const paracel::str_type & key) const {
+    auto it = reg.find(key);
+    return it == reg.end() ? 1 : (int)it->second.eps.size() + 1;
+  }
+
+  // under the table lock: key now holds *val(NULL: deleted), staged on the
+  // calling thread until its forward()
+  void changed(const paracel::str_type & key, const paracel::str_type *val) {
+    auto it = reg.find(key);
+    if(it == reg.end()) return;
+    uint64_t ver = ++it->second.ver;
+    for(auto & ep : it->second.eps) {
+      staged().push_back(item{ep, paracel::replica_prefix + key, ver,
+                              val != NULL, val ? *val : paracel::str_type()});
+    }
+  }
+
+  // under the table lock: every key is gone
+  void cleared() {
+    for(auto & kv : reg) changed(kv.first, NULL);
+  }
+
+  /**
+   * hand what the calling thread staged to the forwarding thread
+   *   wait: return once it went out. handlers of the read port must not
+   *   wait, replica servers apply forwards on that port
+   */
+  void forward(bool wait) {
+    auto & lst = staged();
+    if(lst.empty()) return;
+    std::unique_lock<std::mutex> lk(mtx);
+    if(stopped) {
+      lst.clear();
+      return;
+    }
+    if(!thrd.joinable()) thrd = std::thread(&replicator::run, this);
+    for(auto & it : lst) q.push_back(std::move(it));
+    issued += lst.size();
+    uint64_t ticket = issued;
+    lst.clear();
+    more.notify_one();
+    if(!wait) return;
+    sent_cv.wait(lk, [this, ticket] { return sent >= ticket; });
+  }
+
+  // forward what is queued, then stop the thread
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lk(mtx);
+      stopped = true;
+      more.notify_one();
+    }
+    if(thrd.joinable()) thrd.join();
+  }
+
+ private:
+  struct item {
+    paracel::str_type ep;
+    paracel::str_type key;
+    uint64_t ver;
+    bool set;
+    paracel::str_type val;
+  };
+
+  struct entry {
+    paracel::list_type<paracel::str_type> eps;
+    uint64_t ver = 0;
+  };
+
+  static paracel::list_type<item> & staged() {
+    static thread_local paracel::list_type<item> lst;
+    return lst;
+  }
+
+  void run() {
+    paracel::dict_type<paracel::str_type, std::unique_ptr<paracel::kvclt> > clts;
+    std::unique_lock<std::mutex> lk(mtx);
+    while(true) {
+      more.wait(lk, [this] { return stopped || !q.empty(); });
+      if(q.empty()) break;
+      item it = std::move(q.front());
+      q.pop_front();
+      lk.unlock();
+      auto & clt = clts[it.ep];
+      if(!clt) {
+        auto l = paracel::str_split_by_word(it.ep, paracel::seperator_inner);
+        clt.reset(new paracel::kvclt(l[0], l[1]));
+      }
+      bool r = false;
+      try {
+        r = it.set ? clt->replica_push(it.key, it.ver, it.val) :
+            clt->replica_del(it.key, it.ver);
+      } catch (const std::exception & e) {
+        ERROR_PRINT(e, "replica forward failed: ");
+      }
+      if(!r) {
+        std::cerr << "replica forward of " << it.key << " to " << it.ep << " failed" << std::endl;
+      }
+      lk.lock();
+      sent += 1;
+      sent_cv.notify_all();
+    }
+  }
+
+ private:
+  paracel::dict_type<paracel::str_type, entry> reg;
+  std::thread thrd;
+  std::mutex mtx;
+  std::condition_variable more, sent_cv;
+  std::deque<item> q;
+  uint64_t issued = 0;
+  uint64_t sent = 0;
+  bool stopped = false;
+
+}; // class replicator
+
+} // namespace paracel
+
+#endif
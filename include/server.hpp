@@ -22,13 +22,20 @@
 
 #include <thread>
 #include <mutex>
+#include <chrono>
 #include <functional>
+#include <condition_variable>
 
 #include "zmq.hpp"
 #include "utils.hpp"
 #include "packer.hpp"
 #include "kv_def.hpp"
 #include "proxy.hpp"
+#include "wal.hpp"
+#include "replicator.hpp"
+#include "snapshot.hpp"
+#include "srv_stats.hpp"
+#include "utils/trace.hpp"
 #include "paracel_types.hpp"
 
 namespace paracel {
@@ -44,20 +51,144 @@ static paracel::str_type local_parse_port(paracel::str_type && s) {
   return std::move(l[2]);
 }
 
+// every server thread keeps its own stats, the stats op merges them
+std::mutex stats_mtx;
+paracel::list_type<paracel::srv_stats *> stats_lst;
+
+static paracel::srv_stats & local_stats() {
+  static thread_local paracel::srv_stats *p_stats = NULL;
+  if(!p_stats) {
+    p_stats = new paracel::srv_stats;
+    std::lock_guard<std::mutex> lk(stats_mtx);
+    stats_lst.push_back(p_stats);
+  }
+  return *p_stats;
+}
+
+static paracel::str_type stats_report(bool reset) {
+  paracel::srv_stats all;
+  std::lock_guard<std::mutex> lk(stats_mtx);
+  for(auto p_stats : stats_lst) {
+    p_stats->merge_to(all);
+    if(reset) p_stats->clear();
+  }
+  return all.report();
+}
+
+// bytes replied by the calling thread
+static size_t & local_sent() {
+  static thread_local size_t sent = 0;
+  return sent;
+}
+
+static void free_str_buf(void *data, void *hint) {
+  delete static_cast<paracel::str_type *>(hint);
+}
+
+// zero-copy: val is moved into a buffer zmq owns and frees once sent
 static void rep_send(zmq::socket_t & sock, paracel::str_type & val) {
-  zmq::message_t req(val.size());
-  std::memcpy((void *)req.data(), &val[0], val.size());
+  auto p_buf = new paracel::str_type(std::move(val));
+  local_sent() += p_buf->size();
+  zmq::message_t req((void *)p_buf->data(), p_buf->size(), free_str_buf, p_buf);
   sock.send(req);
 }
 
 template <class V>
-static void rep_pack_send(zmq::socket_t & sock, V & val) {
+static paracel::str_type rep_pack(V & val) {
   paracel::packer<V> pk(val);
   paracel::str_type r;
   pk.pack(r);
-  zmq::message_t req(r.size());
-  std::memcpy((void *)req.data(), &r[0], r.size());
-  sock.send(req);
+  return r;
+}
+
+template <class V>
+static void rep_pack_send(zmq::socket_t & sock, V & val) {
+  auto r = rep_pack(val);
+  rep_send(sock, r);
+}
+
+// optional write-ahead log of tbl_store mutations, see wal.hpp
+paracel::wal *srv_wal = NULL;
+
+// copies of hot keys this server owns, see replicator.hpp
+paracel::replicator srv_replicator;
+
+// highest version applied to each replica this server holds
+paracel::dict_type<paracel::str_type, uint64_t> replica_ver;
+
+// every applied mutation of tbl_store goes through these, under the lock
+static void record_set(const paracel::str_type & key,
+                       const paracel::str_type & val) {
+  if(srv_wal) srv_wal->append_set(key, val);
+  srv_replicator.changed(key, &val);
+}
+
+static void record_del(const paracel::str_type & key) {
+  if(srv_wal) srv_wal->append_del(key);
+  srv_replicator.changed(key, NULL);
+}
+
+static void record_clear() {
+  if(srv_wal) srv_wal->append_clear();
+  srv_replicator.cleared();
+}
+
+// run func under the lock once spilled values of keys are back in memory,
+// they are read from disk without the lock so other threads go on meanwhile
+template <class F>
+static void locked_read(const paracel::list_type<paracel::str_type> & keys,
+                        F func) {
+  paracel::tiered_kvs::cold_batch batch;
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    if(!paracel::tbl_store.plan_cold(keys, batch)) {
+      func();
+      return;
+    }
+  }
+  paracel::tiered_kvs::read_cold_batch(batch);
+  std::lock_guard<std::mutex> lk(mutex);
+  paracel::tbl_store.publish(batch);
+  func();
+}
+
+std::mutex snapshot_mtx;
+pid_t snapshot_pid = -1; // dump in progress
+int snapshot_state = -1; // snapshot_poll result of the last dump
+
+// under snapshot_mtx: reap a finished dump, only a complete one starts a
+// new log segment, so the log never loses records a good snapshot does not
+// cover
+static int snapshot_check() {
+  if(snapshot_pid > 0) {
+    snapshot_state = paracel::snapshot_poll(snapshot_pid);
+    if(snapshot_state != 0) {
+      snapshot_pid = -1;
+      if(snapshot_state > 0 && srv_wal) srv_wal->rotate();
+    }
+  }
+  return snapshot_state;
+}
+
+/**
+ * one snapshot at a time: a forked child dumps a copy-on-write image of the
+ * table taken under the lock, serving goes on meanwhile. false if the fork
+ * failed or a dump is still running, snapshot_status tells how it ended
+ */
+static bool snapshot_serve(const paracel::str_type & fn) {
+  std::lock_guard<std::mutex> lk(snapshot_mtx);
+  if(snapshot_check() == 0) return false;
+  {
+    std::lock_guard<std::mutex> tbl_lk(mutex);
+    snapshot_pid = paracel::snapshot_bg(paracel::tbl_store, fn);
+  }
+  snapshot_state = snapshot_pid > 0 ? 0 : -1;
+  return snapshot_pid > 0;
+}
+
+static int snapshot_status() {
+  std::lock_guard<std::mutex> lk(snapshot_mtx);
+  return snapshot_check();
 }
 
 void kv_filter4pullall(const paracel::dict_type<paracel::str_type, paracel::str_type> & dct, 
@@ -70,6 +201,18 @@ void kv_filter4pullall(const paracel::dict_type<paracel::str_type, paracel::str_
   }
 }
 
+// read copies of hot keys are not part of pullall results
+void drop_replicas(paracel::dict_type<paracel::str_type, paracel::str_type> & dct) {
+  auto sz = paracel::replica_prefix.size();
+  for(auto it = dct.begin(); it != dct.end(); ) {
+    if(it->first.compare(0, sz, paracel::replica_prefix) == 0) {
+      it = dct.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
 void kv_filter4remove(const paracel::dict_type<paracel::str_type, paracel::str_type> & dct,
                       filter_result filter_func) {
   for(auto & kv : dct) { 
@@ -81,6 +224,7 @@ void kv_filter4remove(const paracel::dict_type<paracel::str_type, paracel::str_t
     }
     if(filter_func(key, v)) {
       paracel::tbl_store.del(key);
+      record_del(key);
     }
   }
 }
@@ -92,10 +236,12 @@ std::string kv_update(const paracel::str_type & key,
   auto exist = paracel::tbl_store.get(key, val);
   if(!exist) {
     paracel::tbl_store.set(key, v_or_delta);
+    record_set(key, v_or_delta);
     return v_or_delta;
   }
   std::string new_val = update_func(val, v_or_delta);
   paracel::tbl_store.set(key, new_val);
+  record_set(key, new_val);
   return new_val;
 }
 
@@ -110,6 +256,19 @@ kvs_update(const paracel::list_type<paracel::str_type> & key_lst,
   return new_vals;
 }
 
+// receive a request, false once the context is terminated(the socket is
+// closed then so the termination can finish)
+static bool srv_recv(zmq::socket_t & sock, zmq::message_t & s) {
+  try {
+    sock.recv(&s);
+  } catch (const zmq::error_t & e) {
+    if(e.num() != ETERM) throw;
+    sock.close();
+    return false;
+  }
+  return true;
+}
+
 // thread entry for ssp 
 void thrd_exec_ssp(zmq::socket_t & sock) {
   
@@ -119,7 +278,7 @@ void thrd_exec_ssp(zmq::socket_t & sock) {
   while(1) {
     
     zmq::message_t s;
-    sock.recv(&s);
+    if(!srv_recv(sock, s)) return;
     auto scrip = paracel::str_type(static_cast<const char *>(s.data()), s.size());
     auto msg = paracel::str_split_by_word(scrip, paracel::seperator);
     auto indicator = pk.unpack(msg[0]);
@@ -224,20 +383,44 @@ void thrd_exec(zmq::socket_t & sock) {
 
   while(1) {
     zmq::message_t s;
-    sock.recv(&s);
+    if(!srv_recv(sock, s)) return;
     auto scrip = paracel::str_type(static_cast<const char *>(s.data()), s.size());
     auto msg = paracel::str_split_by_word(scrip, paracel::seperator);
     auto indicator = pk.unpack(msg[0]);
+    auto t0 = std::chrono::steady_clock::now();
+    size_t sent0 = local_sent();
+    auto & st = local_stats();
+    paracel::trace_scope tr("srv", indicator);
     
+    if(indicator == "stats") {
+      paracel::packer<bool> pk_b;
+      auto result = stats_report(msg.size() > 1 && pk_b.unpack(msg[1]));
+      rep_pack_send(sock, result);
+    }
+    if(indicator == "trace_dump") {
+      auto fn = pk.unpack(msg[1]);
+      paracel::packer<int> pk_i;
+      bool result = paracel::tracer::dump(fn, pk_i.unpack(msg[2]));
+      rep_pack_send(sock, result);
+    }
     if(indicator == "contains") {
       auto key = pk.unpack(msg[1]);
-      auto result = paracel::tbl_store.contains(key);
+      st.touch(key);
+      bool result;
+      {
+        std::lock_guard<std::mutex> lk(mutex);
+        result = paracel::tbl_store.contains(key);
+      }
       rep_pack_send(sock, result);
     }
     if(indicator == "pull") {
       auto key = pk.unpack(msg[1]);
+      st.touch(key);
       paracel::str_type result;
-      auto exist = paracel::tbl_store.get(key, result);
+      bool exist;
+      locked_read({key}, [&] () {
+        exist = paracel::tbl_store.get(key, result);
+      });
       if(!exist) {
         paracel::str_type tmp = "nokey";
         rep_send(sock, tmp); 
@@ -245,21 +428,54 @@ void thrd_exec(zmq::socket_t & sock) {
         rep_send(sock, result);
       }
     }
+    if(indicator == "pull_hot") {
+      // the value led by the number of copies of key, 4 bytes little endian
+      auto key = pk.unpack(msg[1]);
+      st.touch(key);
+      paracel::str_type result;
+      bool exist;
+      uint32_t n;
+      locked_read({key}, [&] () {
+        exist = paracel::tbl_store.get(key, result);
+        n = srv_replicator.copies(key);
+      });
+      if(!exist) {
+        paracel::str_type tmp = "nokey";
+        rep_send(sock, tmp);
+      } else {
+        paracel::str_type rep(4, '\0');
+        for(int i = 0; i < 4; ++i) rep[i] = (char)(n >> (8 * i));
+        rep += result;
+        rep_send(sock, rep);
+      }
+    }
     if(indicator == "pull_multi") {
       paracel::packer<paracel::list_type<paracel::str_type> > pk_l; 
       auto key_lst = pk_l.unpack(msg[1]);
-      auto result = paracel::tbl_store.get_multi(key_lst);
+      for(auto & key : key_lst) st.touch(key);
+      paracel::list_type<paracel::str_type> result;
+      locked_read(key_lst, [&] () {
+        paracel::tbl_store.get_multi(key_lst, result);
+      });
       rep_pack_send(sock, result);
     }
     if(indicator == "pull_multi_check") {
       paracel::packer<paracel::list_type<paracel::str_type> > pk_l;
       auto key_lst = pk_l.unpack(msg[1]);
+      for(auto & key : key_lst) st.touch(key);
       paracel::dict_type<paracel::str_type, paracel::str_type> dct;
-      paracel::tbl_store.get_multi(key_lst, dct);
+      locked_read(key_lst, [&] () {
+        paracel::tbl_store.get_multi(key_lst, dct);
+      });
       rep_pack_send(sock, dct);
     }
     if(indicator == "pullall") {
-      auto dct = paracel::tbl_store.getall();
+      paracel::dict_type<paracel::str_type, paracel::str_type> dct;
+      {
+        std::lock_guard<std::mutex> lk(mutex);
+        dct = paracel::tbl_store.getall();
+      }
+      drop_replicas(dct);
       rep_pack_send(sock, dct);
     }
     if(indicator == "pullall_special") {
@@ -275,7 +491,12 @@ void thrd_exec(zmq::socket_t & sock) {
         }
         // TODO
       }
-      auto dct = paracel::tbl_store.getall();
+      paracel::dict_type<paracel::str_type, paracel::str_type> dct;
+      {
+        std::lock_guard<std::mutex> lk(mutex);
+        dct = paracel::tbl_store.getall();
+      }
+      drop_replicas(dct);
       paracel::dict_type<paracel::str_type, paracel::str_type> new_dct;
       kv_filter4pullall(dct, 
                         new_dct, 
@@ -308,12 +529,27 @@ void thrd_exec(zmq::socket_t & sock) {
       bool result = true; 
       rep_pack_send(sock, result);
     }
-    mutex.lock();
+    if(indicator == "snapshot") {
+      auto fn = pk.unpack(msg[1]);
+      bool result = snapshot_serve(fn);
+      rep_pack_send(sock, result);
+    }
+    if(indicator == "snapshot_status") {
+      int result = snapshot_status();
+      rep_pack_send(sock, result);
+    }
+    // mutating ops: reply only after their log records are durable
+    paracel::str_type reply;
+    bool has_reply = false;
+    std::unique_lock<std::mutex> tbl_lk(mutex);
     if(indicator == "push") {
       auto key = pk.unpack(msg[1]);
+      st.touch(key);
       paracel::tbl_store.set(key, msg[2]);
+      record_set(key, msg[2]);
       bool result = true;
-      rep_pack_send(sock, result);
+      reply = rep_pack(result);
+      has_reply = true;
     }
     if(indicator == "push_multi") {
       paracel::packer<paracel::list_type<paracel::str_type> > pk_l;
@@ -323,10 +559,28 @@ void thrd_exec(zmq::socket_t & sock) {
       assert(key_lst.size() == val_lst.size());
       for(int i = 0; i < (int)key_lst.size(); ++i) {
         kv_pairs[key_lst[i]] = val_lst[i];
+        st.touch(key_lst[i]);
       }
       paracel::tbl_store.set_multi(kv_pairs);
+      for(auto & kv : kv_pairs) {
+        record_set(kv.first, kv.second);
+      }
       bool result = true;
-      rep_pack_send(sock, result);
+      reply = rep_pack(result);
+      has_reply = true;
+    }
+    if(indicator == "set_replicas") {
+      paracel::packer<paracel::list_type<paracel::str_type> > pk_l;
+      auto key = pk.unpack(msg[1]);
+      paracel::str_type cur;
+      bool exist = paracel::tbl_store.get(key, cur);
+      srv_replicator.add(key,
+                         pk_l.unpack(msg[2]),
+                         pk_l.unpack(msg[3]),
+                         exist ? &cur : NULL);
+      bool result = true;
+      reply = rep_pack(result);
+      has_reply = true;
     }
     if(indicator == "update" || indicator == "bupdate") {
       if(msg.size() > 3) {
@@ -344,8 +598,10 @@ void thrd_exec(zmq::socket_t & sock) {
         }
       }
       auto key = pk.unpack(msg[1]);
+      st.touch(key);
       std::string result = kv_update(key, msg[2], update_f);
-      rep_send(sock, result);
+      reply = std::move(result);
+      has_reply = true;
     }
     if(indicator == "bupdate_multi") {
       if(msg.size() > 3) {
@@ -366,13 +622,38 @@ void thrd_exec(zmq::socket_t & sock) {
       auto key_lst = pk_l.unpack(msg[1]);
       auto v_or_delta_lst = pk_l.unpack(msg[2]);
       assert(key_lst.size() == v_or_delta_lst.size());
+      for(auto & key : key_lst) st.touch(key);
       auto result = kvs_update(key_lst, v_or_delta_lst, update_f);
-      rep_pack_send(sock, result);
+      reply = rep_pack(result);
+      has_reply = true;
+    }
+    if(indicator == "replica_push" || indicator == "replica_del") {
+      auto key = pk.unpack(msg[1]);
+      paracel::packer<uint64_t> pk_v;
+      auto ver = pk_v.unpack(msg[2]);
+      // forwards of one key may land out of order, keep the newest
+      auto & held = replica_ver[key];
+      if(ver > held) {
+        held = ver;
+        if(indicator == "replica_push") {
+          auto val = pk.unpack(msg[3]);
+          paracel::tbl_store.set(key, val);
+          record_set(key, val);
+        } else if(paracel::tbl_store.del(key)) {
+          record_del(key);
+        }
+      }
+      bool result = true;
+      reply = rep_pack(result);
+      has_reply = true;
     }
     if(indicator == "remove") {
       auto key = pk.unpack(msg[1]);
+      st.touch(key);
       auto result = paracel::tbl_store.del(key);
-      rep_pack_send(sock, result);
+      if(result) record_del(key);
+      reply = rep_pack(result);
+      has_reply = true;
     }
     if(indicator == "remove_special") {
       if(msg.size() == 3) {
@@ -386,31 +667,70 @@ void thrd_exec(zmq::socket_t & sock) {
         }
       }
       auto dct = paracel::tbl_store.getall();
+      drop_replicas(dct);
       kv_filter4remove(dct, remove_special_f);
       bool result = true;
-      rep_pack_send(sock, result);
+      reply = rep_pack(result);
+      has_reply = true;
     }
     if(indicator == "clear") { 
       paracel::tbl_store.clean();
+      record_clear();
       bool result = true;
-      rep_pack_send(sock, result);
+      reply = rep_pack(result);
+      has_reply = true;
+    }
+    if(indicator == "restore") {
+      auto fn = pk.unpack(msg[1]);
+      bool result = true;
+      try {
+        paracel::snapshot_load(paracel::tbl_store, fn);
+        // restored pairs are neither in the log nor on the replicas
+        paracel::tbl_store.traverse([] (const paracel::str_type & k,
+                                         const paracel::str_type & v) {
+          record_set(k, v);
+        });
+      } catch (const std::runtime_error & e) {
+        ERROR_PRINT(e, "restore failed: ");
+        result = false;
+      }
+      reply = rep_pack(result);
+      has_reply = true;
+    }
+    size_t lsn = srv_wal ? srv_wal->appended() : 0;
+    tbl_lk.unlock();
+    // ops of the read port only queue their forwards: replica servers apply
+    // forwards on that port, a wait there could close a cycle
+    bool read_port = indicator == "remove" || indicator == "remove_special" ||
+        indicator == "clear" || indicator == "restore";
+    srv_replicator.forward(!read_port);
+    if(has_reply) {
+      if(lsn) srv_wal->wait(lsn);
+      rep_send(sock, reply);
     }
-    mutex.unlock();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - t0).count();
+    st.record(indicator, s.size(), local_sent() - sent0, ns);
 
   } // while
 
 } // thrd_exec
 
-// init_host is the hostname of starter
-void init_thrds(const paracel::str_type & init_host, 
-                const paracel::str_type & init_port) {
+// bind one REP socket per server thread, return "hostname:port0,port1,..."
+// socket files of the ipc endpoints bound by bind_thrds
+static std::mutex ipc_mtx;
+static paracel::list_type<paracel::str_type> ipc_files;
 
-  zmq::context_t context(2);
-  zmq::socket_t sock(context, ZMQ_REQ);
-  
-  paracel::str_type info = "tcp://" + init_host + ":" + init_port;
-  sock.connect(info.c_str());
+static void unlink_ipc() {
+  std::lock_guard<std::mutex> lk(ipc_mtx);
+  for(auto & fn : ipc_files) {
+    unlink(fn.c_str());
+  }
+  ipc_files.clear();
+}
 
+static paracel::str_type bind_thrds(zmq::context_t & context,
+                                    std::vector<zmq::socket_t *> & sock_pt_lst) {
   char hostname[1024], freeport[1024];
   size_t size = sizeof(freeport);
   
@@ -420,19 +740,67 @@ void init_thrds(const paracel::str_type & init_host,
   ports += ":";
 
   // create sock in every thrd
-  std::vector<zmq::socket_t *> sock_pt_lst;
   for(int i = 0; i < paracel::threads_num; ++i) {
     zmq::socket_t *tmp;
     tmp = new zmq::socket_t(context, ZMQ_REP);
     sock_pt_lst.push_back(tmp);
+    // unanswered replies do not hold up shutdown
+    int linger = 0;
+    tmp->setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
     sock_pt_lst.back()->bind("tcp://*:*");
+    size = sizeof(freeport);
     sock_pt_lst.back()->getsockopt(ZMQ_LAST_ENDPOINT, &freeport, &size);
+    auto port = local_parse_port(paracel::str_type(freeport));
+    // co-located clients connect here instead of going through tcp, the pid
+    // keeps files left by a crashed run apart from this one
+    auto ipc_info = paracel::ipc_prefix + std::to_string(getpid()) + "_" + port;
+    sock_pt_lst.back()->bind(ipc_info.c_str());
+    {
+      std::lock_guard<std::mutex> lk(ipc_mtx);
+      ipc_files.push_back(ipc_info.substr(std::string("ipc://").size()));
+    }
     if(i == paracel::threads_num - 1) {
-      ports += local_parse_port(paracel::str_type(freeport));
+      ports += port;
     } else {
-      ports += local_parse_port(std::move(paracel::str_type(freeport))) + ",";
+      ports += port + ",";
     }
   }
+  return ports + paracel::ipc_mark + std::to_string(getpid());
+}
+
+static std::mutex compact_mtx;
+static std::condition_variable compact_cv;
+static bool compact_stop = false;
+
+// give memory of overwritten and deleted values back to the os now and then
+static void compact_exec() {
+  std::unique_lock<std::mutex> lk(compact_mtx);
+  while(!compact_cv.wait_for(lk, std::chrono::seconds(10), [] { return compact_stop; })) {
+    std::lock_guard<std::mutex> tbl_lk(mutex);
+    paracel::tbl_store.compact_mem();
+  }
+}
+
+static void stop_compact() {
+  {
+    std::lock_guard<std::mutex> lk(compact_mtx);
+    compact_stop = true;
+  }
+  compact_cv.notify_all();
+}
+
+// init_host is the hostname of starter
+void init_thrds(const paracel::str_type & init_host, 
+                const paracel::str_type & init_port) {
+
+  zmq::context_t context(2);
+  zmq::socket_t sock(context, ZMQ_REQ);
+  
+  paracel::str_type info = "tcp://" + init_host + ":" + init_port;
+  sock.connect(info.c_str());
+
+  std::vector<zmq::socket_t *> sock_pt_lst;
+  auto ports = bind_thrds(context, sock_pt_lst);
 
   zmq::message_t request(ports.size());
   std::memcpy((void *)request.data(), &ports[0], ports.size());
@@ -446,14 +814,18 @@ void init_thrds(const paracel::str_type & init_host,
     threads.push_back(std::thread(thrd_exec, std::ref(*sock_pt_lst[i])));
   }
   threads.push_back(std::thread(thrd_exec_ssp, std::ref(*sock_pt_lst.back())));
+  std::thread compact_thrd(compact_exec);
 
   for(auto & thrd : threads) {
     thrd.join();
   }
+  stop_compact();
+  compact_thrd.join();
 
   for(int i = 0; i < paracel::threads_num; ++i) {
     delete sock_pt_lst[i];
   }
+  unlink_ipc();
 
   zmq_ctx_destroy(context);
 } // init_thrds
@@ -0,0 +1,167 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#ifndef FILE_3b96cac0_852c_461c_858b_6f6b44b56fc3_HPP
+#define FILE_3b96cac0_852c_461c_858b_6f6b44b56fc3_HPP
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/types.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+
+#include "kv.hpp"
+#include "paracel_types.hpp"
+
+namespace paracel {
+
+/**
+ * snapshot file layout(host byte order)
+ *   magic[8] | count(u64) | count * [klen(u32) | key | vlen(u64) | val]
+ */
+const char snapshot_magic[8] = {'P', 'R', 'C', 'L', 'S', 'N', 'P', '1'};
+
+// write tbl(kvs<str, str> or tiered_kvs) to fn through a temp file, the rename makes it atomic
+template <class T>
+bool snapshot_dump(const T & tbl,
+                   const paracel::str_type & fn) {
+  auto tmp_fn = fn + ".tmp";
+  std::ofstream os(tmp_fn, std::ios::binary | std::ios::trunc);
+  if(!os) return false;
+  uint64_t cnt = tbl.size();
+  os.write(snapshot_magic, sizeof(snapshot_magic));
+  os.write((const char *)&cnt, sizeof(cnt));
+  tbl.traverse([&os] (const paracel::str_type & k, const paracel::str_type & v) {
+    uint32_t klen = k.size();
+    uint64_t vlen = v.size();
+    os.write((const char *)&klen, sizeof(klen));
+    os.write(k.data(), klen);
+    os.write((const char *)&vlen, sizeof(vlen));
+    os.write(v.data(), vlen);
+  });
+  os.flush();
+  if(!os) return false;
+  os.close();
+  return std::rename(tmp_fn.c_str(), fn.c_str()) == 0;
+}
+
+/**
+ * fork a child that dumps tbl to fn and return its pid(-1 on failure)
+ *   the child works on a copy-on-write image of the table, so the caller
+ *   keeps serving. hold the lock guarding tbl writes across this call,
+ *   reap the child with snapshot_wait or snapshot_poll.
+ */
+template <class T>
+pid_t snapshot_bg(const T & tbl,
+                  const paracel::str_type & fn) {
+  pid_t pid = fork();
+  if(pid == 0) {
+    _exit(snapshot_dump(tbl, fn) ? 0 : 1);
+  }
+  return pid;
+}
+
+// wait for the child of snapshot_bg, true if its dump is complete on disk
+inline bool snapshot_wait(pid_t pid) {
+  if(pid <= 0) return false;
+  int status = 0;
+  while(waitpid(pid, &status, 0) < 0) {
+    if(errno != EINTR) return false;
+  }
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// non-blocking snapshot_wait: 0 while the child runs, then 1 if its dump is
+// complete on disk and -1 if not(the child is reaped once it is not 0)
+inline int snapshot_poll(pid_t pid) {
+  if(pid <= 0) return -1;
+  int status = 0;
+  pid_t r;
+  while((r = waitpid(pid, &status, WNOHANG)) < 0) {
+    if(errno != EINTR) return -1;
+  }
+  if(r == 0) return 0;
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 1 : -1;
+}
+
+// mmap fn and insert every record into tbl, return number of records
+template <class T>
+size_t snapshot_load(T & tbl,
+                     const paracel::str_type & fn) {
+  int fd = open(fn.c_str(), O_RDONLY);
+  if(fd < 0) {
+    throw std::runtime_error("snapshot_load: can not open " + fn);
+  }
+  struct stat st;
+  if(fstat(fd, &st) != 0) {
+    close(fd);
+    throw std::runtime_error("snapshot_load: can not stat " + fn);
+  }
+  size_t sz = st.st_size;
+  uint64_t cnt = 0;
+  if(sz < sizeof(snapshot_magic) + sizeof(cnt)) {
+    close(fd);
+    throw std::runtime_error("snapshot_load: truncated file " + fn);
+  }
+  void *addr = mmap(NULL, sz, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+  close(fd);
+  if(addr == MAP_FAILED) {
+    throw std::runtime_error("snapshot_load: mmap failed on " + fn);
+  }
+  madvise(addr, sz, MADV_SEQUENTIAL);
+  const char *p = static_cast<const char *>(addr);
+  const char *end = p + sz;
+  auto fail = [&] (const paracel::str_type & info) {
+    munmap(addr, sz);
+    throw std::runtime_error("snapshot_load: " + info + " in " + fn);
+  };
+  if(std::memcmp(p, snapshot_magic, sizeof(snapshot_magic)) != 0) {
+    fail("bad magic");
+  }
+  p += sizeof(snapshot_magic);
+  std::memcpy(&cnt, p, sizeof(cnt));
+  p += sizeof(cnt);
+  tbl.reserve(tbl.size() + cnt);
+  for(uint64_t i = 0; i < cnt; ++i) {
+    uint32_t klen;
+    uint64_t vlen;
+    if((size_t)(end - p) < sizeof(klen)) fail("truncated record");
+    std::memcpy(&klen, p, sizeof(klen));
+    p += sizeof(klen);
+    if((size_t)(end - p) < klen + sizeof(vlen)) fail("truncated record");
+    const char *k = p;
+    p += klen;
+    std::memcpy(&vlen, p, sizeof(vlen));
+    p += sizeof(vlen);
+    if((uint64_t)(end - p) < vlen) fail("truncated record");
+    tbl.set(paracel::str_type(k, klen), paracel::str_type(p, vlen));
+    p += vlen;
+  }
+  munmap(addr, sz);
+  return cnt;
+}
+
+} // namespace paracel
+
+#endif
@@ -0,0 +1,117 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#ifndef FILE_33d721f2_4424_4386_9b69_da9a5dedeef0_HPP
+#define FILE_33d721f2_4424_4386_9b69_da9a5dedeef0_HPP
+
+#include <stdint.h>
+
+#include <mutex>
+#include <string>
+#include <sstream>
+#include <algorithm>
+
+#include "paracel_types.hpp"
+#include "utils/sketch.hpp"
+
+namespace paracel {
+
+struct op_stat {
+  uint64_t cnt = 0;
+  uint64_t bytes_in = 0;
+  uint64_t bytes_out = 0;
+  uint64_t total_ns = 0;
+  uint64_t max_ns = 0;
+
+  void merge(const op_stat & o) {
+    cnt += o.cnt;
+    bytes_in += o.bytes_in;
+    bytes_out += o.bytes_out;
+    total_ns += o.total_ns;
+    max_ns = std::max(max_ns, o.max_ns);
+  }
+};
+
+/**
+ * access statistics of one server thread
+ *   per-op count, bytes and latency plus the most accessed keys.
+ *   the owning thread writes, the stats op reads through merge_to.
+ */
+class srv_stats {
+
+ public:
+  void touch(const paracel::str_type & key) {
+    std::lock_guard<std::mutex> lk(mtx);
+    keys.add(key);
+  }
+
+  void record(const paracel::str_type & op,
+              size_t bytes_in,
+              size_t bytes_out,
+              uint64_t ns) {
+    std::lock_guard<std::mutex> lk(mtx);
+    auto & s = ops[op];
+    s.cnt += 1;
+    s.bytes_in += bytes_in;
+    s.bytes_out += bytes_out;
+    s.total_ns += ns;
+    s.max_ns = std::max(s.max_ns, ns);
+  }
+
+  void merge_to(srv_stats & dst) {
+    std::lock_guard<std::mutex> lk(mtx);
+    for(auto & kv : ops) {
+      dst.ops[kv.first].merge(kv.second);
+    }
+    dst.keys.merge(keys);
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lk(mtx);
+    ops.clear();
+    keys.clear();
+  }
+
+  /**
+   * one record per line
+   *   op <name> <cnt> <bytes_in> <bytes_out> <avg_us> <max_us>
+   *   key <estimated accesses> <key>
+   */
+  paracel::str_type report() {
+    std::lock_guard<std::mutex> lk(mtx);
+    std::ostringstream os;
+    for(auto & kv : ops) {
+      auto & s = kv.second;
+      os << "op " << kv.first << " " << s.cnt << " "
+          << s.bytes_in << " " << s.bytes_out << " "
+          << (s.cnt ? s.total_ns / 1000. / s.cnt : 0.) << " "
+          << s.max_ns / 1000. << '\n';
+    }
+    for(auto & kv : keys.top()) {
+      os << "key " << kv.second << " " << kv.first << '\n';
+    }
+    return os.str();
+  }
+
+ private:
+  std::mutex mtx;
+  paracel::dict_type<paracel::str_type, op_stat> ops;
+  paracel::heavy_hitters keys;
+
+}; // class srv_stats
+
+} // namespace paracel
+
+#endif
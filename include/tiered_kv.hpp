@@ -0,0 +1,483 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#ifndef FILE_9b7601b7_cae7_4b96_ad74_c3ed70575ff4_HPP
+#define FILE_9b7601b7_cae7_4b96_ad74_c3ed70575ff4_HPP
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+
+#include <list>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/optional/optional.hpp>
+
+#include "paracel_types.hpp"
+#include "utils/arena.hpp"
+#include "utils/ext_utility.hpp"
+
+namespace paracel {
+
+/**
+ * string table with an optional disk tier, interface follows kvs
+ *   without enable_spill everything lives in memory like kvs.
+ *   with it, once keys plus values in memory exceed mem_limit bytes the least
+ *   recently used values are appended to a spill file; only their keys and
+ *   file offsets stay in memory. a read of a spilled key brings it back.
+ *   values in memory are kept in an arena(see utils/arena.hpp) and
+ *   overwritten in place when they fit, compact_mem gives back the memory
+ *   of sparse slabs.
+ *   not thread-safe, callers serialize access(server threads use paracel::mutex).
+ *   plan_cold/read_cold_batch/publish let them read spilled values without
+ *   holding their lock.
+ */
+class tiered_kvs {
+
+ private:
+  using K = paracel::str_type;
+  using V = paracel::str_type;
+  using lru_type = std::list<const K *>;
+
+  struct hot_node {
+    paracel::arena::blk val;
+    lru_type::iterator pos;
+  };
+
+  struct cold_node {
+    uint64_t off;
+    uint64_t len;
+  };
+
+ public:
+  // spilled values read outside the caller's lock, see plan_cold
+  struct cold_batch {
+    int fd = -1;
+    uint64_t gen = 0;
+    std::vector<std::pair<K, cold_node> > items;
+    std::vector<V> vals;
+    std::vector<bool> done;
+
+    cold_batch() {}
+    cold_batch(const cold_batch &) = delete;
+    cold_batch & operator=(const cold_batch &) = delete;
+    ~cold_batch() { if(fd >= 0) close(fd); }
+  };
+
+  tiered_kvs() {}
+
+  tiered_kvs(const tiered_kvs &) = delete;
+
+  tiered_kvs & operator=(const tiered_kvs &) = delete;
+
+  virtual ~tiered_kvs() {
+    for(auto & kv : hot) {
+      mem.free(kv.second.val);
+    }
+    if(fd >= 0) close(fd);
+  }
+
+  // keep at most limit bytes in memory, spill the rest to a file in dir
+  void enable_spill(const paracel::str_type & dir, size_t limit) {
+    int nfd = open_spill_file(dir);
+    if(nfd < 0) {
+      throw std::runtime_error("tiered_kvs: can not create spill file in " + dir);
+    }
+    if(fd >= 0) {
+      // move what was spilled so far
+      std::vector<K> keys;
+      for(auto & kv : cold) keys.push_back(kv.first);
+      for(auto & k : keys) promote(k);
+      close(fd);
+    }
+    spill_dir = dir;
+    fd = nfd;
+    file_end = dead = 0;
+    ++spill_gen;
+    mem_limit = limit;
+    evict();
+  }
+
+  bool contains(const K & k) {
+    return hot.count(k) || cold.count(k);
+  }
+
+  void set(const K & k, const V & v) {
+    auto it = hot.find(k);
+    if(it != hot.end()) {
+      hot_bytes = hot_bytes - it->second.val.len + v.size();
+      mem.assign(it->second.val, v.data(), v.size());
+      touch(it);
+    } else {
+      drop_cold(k);
+      insert_hot(k, v);
+    }
+    evict();
+  }
+
+  void set_multi(const paracel::dict_type<K, V> & kvdict) {
+    for(auto & kv : kvdict) {
+      set(kv.first, kv.second);
+    }
+  }
+
+  boost::optional<V> get(const K & k) {
+    V v;
+    if(get(k, v)) {
+      return boost::optional<V>(v);
+    }
+    return boost::none;
+  }
+
+  bool get(const K & k, V & v) {
+    auto it = find_hot(k);
+    if(it == hot.end()) return false;
+    v.assign(it->second.val.ptr, it->second.val.len);
+    return true;
+  }
+
+  paracel::list_type<V>
+  get_multi(const paracel::list_type<K> & keylst) {
+    paracel::list_type<V> valst;
+    get_multi(keylst, valst);
+    return valst;
+  }
+
+  void get_multi(const paracel::list_type<K> & keylst,
+                 paracel::list_type<V> & valst) {
+    prefetch(keylst);
+    for(auto & key : keylst) {
+      auto it = find_hot(key);
+      if(it == hot.end()) {
+        throw std::out_of_range("tiered_kvs::get_multi: no key " + key);
+      }
+      valst.push_back(V(it->second.val.ptr, it->second.val.len));
+    }
+  }
+
+  void get_multi(const paracel::list_type<K> & keylst,
+                 paracel::dict_type<K, V> & valdct) {
+    valdct.clear();
+    prefetch(keylst);
+    for(auto & key : keylst) {
+      auto it = find_hot(key);
+      if(it != hot.end()) {
+        valdct[key] = V(it->second.val.ptr, it->second.val.len);
+      }
+    }
+  }
+
+  /**
+   * under the lock: note the spilled values among keylst into batch, return
+   * false when there are none. batch keeps its own handle of the spill file.
+   */
+  bool plan_cold(const paracel::list_type<K> & keylst, cold_batch & batch) {
+    if(fd < 0 || cold.empty()) return false;
+    for(auto & key : keylst) {
+      auto cit = cold.find(key);
+      if(cit != cold.end()) batch.items.emplace_back(key, cit->second);
+    }
+    if(batch.items.empty()) return false;
+    batch.fd = dup(fd);
+    if(batch.fd < 0) {
+      batch.items.clear();
+      return false;
+    }
+    batch.gen = spill_gen;
+    return true;
+  }
+
+  // without the lock: read the values noted by plan_cold
+  static void read_cold_batch(cold_batch & batch) {
+    for(auto & item : batch.items) {
+      posix_fadvise(batch.fd, item.second.off, item.second.len, POSIX_FADV_WILLNEED);
+    }
+    batch.vals.resize(batch.items.size());
+    batch.done.assign(batch.items.size(), false);
+    for(size_t i = 0; i < batch.items.size(); ++i) {
+      batch.done[i] = pread_all(batch.fd, batch.items[i].second, batch.vals[i]);
+    }
+  }
+
+  // under the lock again: bring back the values nobody changed meanwhile
+  void publish(cold_batch & batch) {
+    if(batch.gen != spill_gen) return;
+    for(size_t i = 0; i < batch.items.size(); ++i) {
+      if(!batch.done[i]) continue;
+      auto & k = batch.items[i].first;
+      auto cit = cold.find(k);
+      if(cit == cold.end() ||
+         cit->second.off != batch.items[i].second.off ||
+         cit->second.len != batch.items[i].second.len) {
+        continue;
+      }
+      dead += cit->second.len;
+      cold.erase(cit);
+      insert_hot(k, batch.vals[i]);
+    }
+    evict();
+  }
+
+  bool del(const K & k) {
+    auto it = hot.find(k);
+    if(it != hot.end()) {
+      hot_bytes -= k.size() + it->second.val.len;
+      mem.free(it->second.val);
+      lru.erase(it->second.pos);
+      hot.erase(it);
+      return true;
+    }
+    return drop_cold(k);
+  }
+
+  void clean() {
+    for(auto & kv : hot) {
+      mem.free(kv.second.val);
+    }
+    hot.clear();
+    lru.clear();
+    cold.clear();
+    hot_bytes = 0;
+    if(fd >= 0) {
+      if(ftruncate(fd, 0) != 0) {}
+      file_end = dead = 0;
+      ++spill_gen;
+    }
+  }
+
+  paracel::dict_type<K, V> getall() {
+    paracel::dict_type<K, V> dct;
+    traverse([&dct] (const K & k, const V & v) { dct[k] = v; });
+    return dct;
+  }
+
+  // visit every pair, spilled values are read without being brought back
+  template <class F>
+  void traverse(F func) const {
+    V v;
+    for(auto & kv : hot) {
+      v.assign(kv.second.val.ptr, kv.second.val.len);
+      func(kv.first, v);
+    }
+    for(auto & kv : cold) {
+      read_cold(kv.second, v);
+      func(kv.first, v);
+    }
+  }
+
+  size_t size() const {
+    return hot.size() + cold.size();
+  }
+
+  void reserve(size_t n) {
+    hot.reserve(std::min(n, (size_t)1 << 24));
+  }
+
+  // bytes of keys plus values kept in memory
+  size_t mem_bytes() const {
+    return hot_bytes;
+  }
+
+  size_t spilled() const {
+    return cold.size();
+  }
+
+  // bytes the value arena holds from the os
+  size_t mem_reserved() const {
+    return mem.reserved();
+  }
+
+  /**
+   * move values out of sparse arena slabs so they go back to the os
+   *   only scans the table when enough memory is wasted, return true if it did
+   */
+  bool compact_mem() {
+    if(!mem.fragmented() || !mem.begin_compaction()) return false;
+    for(auto & kv : hot) {
+      if(mem.evacuating(kv.second.val)) {
+        mem.relocate(kv.second.val);
+      }
+    }
+    mem.end_compaction();
+    return true;
+  }
+
+ private:
+  using hot_iter = paracel::dict_type<K, hot_node>::iterator;
+
+  void touch(hot_iter it) {
+    lru.splice(lru.begin(), lru, it->second.pos);
+  }
+
+  void insert_hot(const K & k, const V & v) {
+    auto r = hot.emplace(k, hot_node());
+    auto it = r.first;
+    it->second.val = mem.alloc(v.size());
+    std::memcpy(it->second.val.ptr, v.data(), v.size());
+    lru.push_front(&it->first);
+    it->second.pos = lru.begin();
+    hot_bytes += k.size() + v.size();
+  }
+
+  hot_iter find_hot(const K & k) {
+    auto it = hot.find(k);
+    if(it != hot.end()) {
+      touch(it);
+      return it;
+    }
+    if(!cold.count(k)) return hot.end();
+    it = promote(k);
+    evict(&it->first);
+    return it;
+  }
+
+  hot_iter promote(const K & k) {
+    auto cit = cold.find(k);
+    V v;
+    read_cold(cit->second, v);
+    dead += cit->second.len;
+    cold.erase(cit);
+    insert_hot(k, v);
+    return hot.find(k);
+  }
+
+  bool drop_cold(const K & k) {
+    auto cit = cold.find(k);
+    if(cit == cold.end()) return false;
+    dead += cit->second.len;
+    cold.erase(cit);
+    return true;
+  }
+
+  // spill least recently used values until under mem_limit, keep `pin` hot
+  void evict(const K *pin = NULL) {
+    if(fd < 0) return;
+    while(hot_bytes > mem_limit && !lru.empty()) {
+      const K *pk = lru.back();
+      if(pk == pin) {
+        if(lru.size() == 1) break;
+        lru.splice(lru.begin(), lru, std::prev(lru.end()));
+        continue;
+      }
+      auto it = hot.find(*pk);
+      auto & v = it->second.val;
+      cold_node node{file_end, v.len};
+      write_all(v.ptr, v.len, file_end);
+      file_end += v.len;
+      hot_bytes -= it->first.size() + v.len;
+      mem.free(v);
+      lru.pop_back();
+      cold[it->first] = node;
+      hot.erase(it);
+    }
+    if(dead > ((uint64_t)64 << 20) && dead * 2 > file_end) {
+      compact();
+    }
+  }
+
+  // rewrite live spilled values into a fresh file
+  void compact() {
+    int nfd = open_spill_file(spill_dir);
+    if(nfd < 0) return;
+    uint64_t end = 0;
+    V v;
+    for(auto & kv : cold) {
+      read_cold(kv.second, v);
+      if(pwrite(nfd, v.data(), v.size(), end) != (ssize_t)v.size()) {
+        close(nfd);
+        return;
+      }
+      kv.second.off = end;
+      end += v.size();
+    }
+    close(fd);
+    fd = nfd;
+    file_end = end;
+    dead = 0;
+    ++spill_gen;
+  }
+
+  // unlinked right away, so the file goes away with the process
+  static int open_spill_file(const paracel::str_type & dir) {
+    auto fn = paracel::todir(dir) + "paracel_spill_XXXXXX";
+    std::vector<char> tmpl(fn.begin(), fn.end());
+    tmpl.push_back('\0');
+    int nfd = mkstemp(&tmpl[0]);
+    if(nfd >= 0) unlink(&tmpl[0]);
+    return nfd;
+  }
+
+  // kernel reads spilled values of a batch ahead while we walk it
+  void prefetch(const paracel::list_type<K> & keylst) {
+    if(fd < 0 || cold.empty()) return;
+    for(auto & key : keylst) {
+      auto cit = cold.find(key);
+      if(cit != cold.end()) {
+        posix_fadvise(fd, cit->second.off, cit->second.len, POSIX_FADV_WILLNEED);
+      }
+    }
+  }
+
+  void read_cold(const cold_node & node, V & v) const {
+    if(!pread_all(fd, node, v)) {
+      throw std::runtime_error("tiered_kvs: spill file read failed");
+    }
+  }
+
+  static bool pread_all(int rfd, const cold_node & node, V & v) {
+    v.resize(node.len);
+    uint64_t done = 0;
+    while(done < node.len) {
+      ssize_t n = pread(rfd, &v[0] + done, node.len - done, node.off + done);
+      if(n <= 0) return false;
+      done += n;
+    }
+    return true;
+  }
+
+  void write_all(const char *p, size_t n, uint64_t off) {
+    size_t done = 0;
+    while(done < n) {
+      ssize_t r = pwrite(fd, p + done, n - done, off + done);
+      if(r <= 0) {
+        throw std::runtime_error("tiered_kvs: spill file write failed");
+      }
+      done += r;
+    }
+  }
+
+ private:
+  paracel::arena mem;
+  paracel::dict_type<K, hot_node> hot;
+  lru_type lru; // most recently used first
+  paracel::dict_type<K, cold_node> cold;
+  size_t hot_bytes = 0;
+  size_t mem_limit = 0;
+  paracel::str_type spill_dir;
+  int fd = -1;
+  uint64_t file_end = 0;
+  uint64_t dead = 0; // bytes of the spill file no longer referenced
+  uint64_t spill_gen = 0; // bumped whenever spilled offsets change meaning
+
+}; // class tiered_kvs
+
+} // namespace paracel
+
+#endif
@@ -0,0 +1,284 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#ifndef FILE_8331b4bb_97c5_495d_b20d_cc30bb0b6ab4_HPP
+#define FILE_8331b4bb_97c5_495d_b20d_cc30bb0b6ab4_HPP
+
+#include <stdint.h>
+#include <sys/mman.h>
+
+#include <set>
+#include <new>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+namespace paracel {
+
+/**
+ * size-class arena for table values
+ *   small blocks(<= 64KB) live in 1MB mmap-ed slabs, one size class per
+ *   slab, freed slots are chained into a per-slab free list. a slab whose
+ *   last block is freed goes back to the os right away.
+ *   big blocks come from malloc and grow with realloc.
+ *
+ *   the arena can not move blocks on its own: compaction marks sparse slabs
+ *   with begin_compaction, the owner relocates every block for which
+ *   evacuating() holds and then calls end_compaction.
+ *   not thread-safe.
+ */
+class arena {
+
+ private:
+  struct slab {
+    char *base;
+    uint32_t cls;
+    uint32_t nslots;
+    uint32_t used = 0;
+    uint32_t bump = 0; // slots at and after bump were never handed out
+    uint32_t free_head = nil;
+    bool in_partial = false;
+    bool evacuating = false;
+  };
+
+  static const uint32_t nil = (uint32_t)-1;
+  static const size_t slab_bytes = 1 << 20;
+  static const size_t max_small = 64 << 10;
+
+ public:
+  struct blk {
+    char *ptr = NULL;
+    size_t len = 0;
+    size_t cap = 0;
+    slab *s = NULL; // NULL for big blocks
+  };
+
+  arena() : partial(classes().size()) {}
+
+  arena(const arena &) = delete;
+
+  arena & operator=(const arena &) = delete;
+
+  // big blocks belong to the owner, it must free them before
+  virtual ~arena() {
+    for(auto s : all) {
+      munmap(s->base, slab_bytes);
+      delete s;
+    }
+  }
+
+  blk alloc(size_t len) {
+    blk b;
+    b.len = len;
+    if(len > max_small) {
+      b.ptr = static_cast<char *>(std::malloc(len));
+      if(!b.ptr) throw std::bad_alloc();
+      b.cap = len;
+      big_bytes += len;
+      return b;
+    }
+    uint32_t cls = cls_of(len);
+    slab *s = pick(cls);
+    size_t csz = classes()[cls];
+    uint32_t idx;
+    if(s->free_head != nil) {
+      idx = s->free_head;
+      std::memcpy(&s->free_head, s->base + idx * csz, sizeof(uint32_t));
+    } else {
+      idx = s->bump++;
+    }
+    s->used += 1;
+    slot_bytes += csz;
+    b.ptr = s->base + idx * csz;
+    b.cap = csz;
+    b.s = s;
+    return b;
+  }
+
+  void free(blk & b) {
+    if(!b.ptr) return;
+    slab *s = b.s;
+    if(!s) {
+      std::free(b.ptr);
+      big_bytes -= b.cap;
+    } else {
+      size_t csz = classes()[s->cls];
+      uint32_t idx = (b.ptr - s->base) / csz;
+      std::memcpy(b.ptr, &s->free_head, sizeof(uint32_t));
+      s->free_head = idx;
+      s->used -= 1;
+      slot_bytes -= csz;
+      if(s->used == 0) {
+        release(s);
+      } else if(!s->in_partial && !s->evacuating) {
+        s->in_partial = true;
+        partial[s->cls].push_back(s);
+      }
+    }
+    b = blk();
+  }
+
+  // overwrite b with p[0, len), in place when the block still fits well
+  void assign(blk & b, const char *p, size_t len) {
+    if(b.ptr && len <= b.cap && len * 2 >= b.cap) {
+      std::memcpy(b.ptr, p, len);
+      b.len = len;
+      return;
+    }
+    if(b.ptr && !b.s && len > max_small) {
+      char *np = static_cast<char *>(std::realloc(b.ptr, len));
+      if(!np) throw std::bad_alloc();
+      big_bytes = big_bytes - b.cap + len;
+      std::memcpy(np, p, len);
+      b.ptr = np;
+      b.len = b.cap = len;
+      return;
+    }
+    blk nb = alloc(len);
+    std::memcpy(nb.ptr, p, len);
+    free(b);
+    b = nb;
+  }
+
+  // bytes of unused slots in slabs
+  size_t slack() const {
+    return all.size() * slab_bytes - slot_bytes;
+  }
+
+  // bytes taken from the os
+  size_t reserved() const {
+    return all.size() * slab_bytes + big_bytes;
+  }
+
+  bool fragmented() const {
+    return slack() > ((size_t)16 << 20) && slack() * 4 > slot_bytes;
+  }
+
+  /**
+   * stop allocating from slabs less than half used, in size classes that
+   * have at least two of them. return false if there is nothing to do
+   */
+  bool begin_compaction() {
+    bool any = false;
+    for(auto & cand : partial) {
+      size_t sparse = 0;
+      for(auto s : cand) {
+        if(s->used * 2 < s->nslots) sparse += 1;
+      }
+      if(sparse < 2) continue;
+      std::vector<slab *> keep;
+      for(auto s : cand) {
+        if(s->used * 2 < s->nslots) {
+          s->evacuating = true;
+          s->in_partial = false;
+        } else {
+          keep.push_back(s);
+        }
+      }
+      cand.swap(keep);
+      any = true;
+    }
+    return any;
+  }
+
+  bool evacuating(const blk & b) const {
+    return b.s && b.s->evacuating;
+  }
+
+  // move b into a slab that is not being evacuated
+  void relocate(blk & b) {
+    blk nb = alloc(b.len);
+    std::memcpy(nb.ptr, b.ptr, b.len);
+    free(b);
+    b = nb;
+  }
+
+  // slabs the owner did not fully drain go back to allocation
+  void end_compaction() {
+    for(auto s : all) {
+      if(s->evacuating) {
+        s->evacuating = false;
+        s->in_partial = true;
+        partial[s->cls].push_back(s);
+      }
+    }
+  }
+
+ private:
+  // 8 byte steps up to 128, then four classes per power of two
+  static const std::vector<size_t> & classes() {
+    static const std::vector<size_t> cls = [] {
+      std::vector<size_t> r;
+      for(size_t sz = 8; sz <= 128; sz += 8) {
+        r.push_back(sz);
+      }
+      for(size_t base = 128; base < max_small; base *= 2) {
+        for(size_t k = 1; k <= 4; ++k) {
+          r.push_back(base + base / 4 * k);
+        }
+      }
+      return r;
+    }();
+    return cls;
+  }
+
+  static uint32_t cls_of(size_t len) {
+    auto & cls = classes();
+    return std::lower_bound(cls.begin(), cls.end(), len) - cls.begin();
+  }
+
+  slab * pick(uint32_t cls) {
+    auto & cand = partial[cls];
+    while(!cand.empty()) {
+      slab *s = cand.back();
+      if(s->used < s->nslots) return s;
+      s->in_partial = false;
+      cand.pop_back();
+    }
+    void *p = mmap(NULL, slab_bytes, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(p == MAP_FAILED) throw std::bad_alloc();
+    slab *s = new slab;
+    s->base = static_cast<char *>(p);
+    s->cls = cls;
+    s->nslots = slab_bytes / classes()[cls];
+    s->in_partial = true;
+    cand.push_back(s);
+    all.insert(s);
+    return s;
+  }
+
+  void release(slab *s) {
+    if(s->in_partial) {
+      auto & cand = partial[s->cls];
+      cand.erase(std::find(cand.begin(), cand.end(), s));
+    }
+    all.erase(s);
+    munmap(s->base, slab_bytes);
+    delete s;
+  }
+
+ private:
+  std::vector<std::vector<slab *> > partial; // per class, slabs with free slots
+  std::set<slab *> all;
+  size_t slot_bytes = 0; // bytes of handed out slots
+  size_t big_bytes = 0;
+
+}; // class arena
+
+} // namespace paracel
+
+#endif
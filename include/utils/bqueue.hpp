@@ -0,0 +1,94 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#ifndef FILE_155da87e_c441_4906_8798_ebd7c204cf3f_HPP
+#define FILE_155da87e_c441_4906_8798_ebd7c204cf3f_HPP
+
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <condition_variable>
+
+namespace paracel {
+
+/**
+ * bounded blocking queue
+ *   push blocks while the queue is full(backpressure on producer)
+ *   pop blocks while the queue is empty, returns false once closed and drained
+ */
+template <class T>
+class bqueue {
+
+ public:
+  bqueue(size_t cap = 1024) : capacity(cap == 0 ? 1 : cap) {}
+
+  bqueue(const bqueue &) = delete;
+
+  bqueue & operator=(const bqueue &) = delete;
+
+  bool push(T && item) {
+    std::unique_lock<std::mutex> lk(mtx);
+    not_full.wait(lk, [this] { return closed || q.size() < capacity; });
+    if(closed) return false;
+    q.push_back(std::move(item));
+    not_empty.notify_one();
+    return true;
+  }
+
+  bool push(const T & item) {
+    T tmp(item);
+    return push(std::move(tmp));
+  }
+
+  bool pop(T & item) {
+    std::unique_lock<std::mutex> lk(mtx);
+    not_empty.wait(lk, [this] { return closed || !q.empty(); });
+    if(q.empty()) return false;
+    item = std::move(q.front());
+    q.pop_front();
+    not_full.notify_one();
+    return true;
+  }
+
+  // wake up all blocked producers and consumers
+  void close() {
+    std::lock_guard<std::mutex> lk(mtx);
+    closed = true;
+    not_full.notify_all();
+    not_empty.notify_all();
+  }
+
+  size_t size() {
+    std::lock_guard<std::mutex> lk(mtx);
+    return q.size();
+  }
+
+  size_t get_capacity() const {
+    return capacity;
+  }
+
+ private:
+  size_t capacity;
+  bool closed = false;
+  std::deque<T> q;
+  std::mutex mtx;
+  std::condition_variable not_full;
+  std::condition_variable not_empty;
+
+}; // class bqueue
+
+} // namespace paracel
+
+#endif
@@ -0,0 +1,142 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#ifndef FILE_69630865_9b96_4158_b02b_6f136cc88844_HPP
+#define FILE_69630865_9b96_4158_b02b_6f136cc88844_HPP
+
+#include <stdint.h>
+
+#include <vector>
+#include <algorithm>
+
+namespace paracel {
+
+/**
+ * hdr-style histogram of non-negative integers(latencies in ns)
+ *   every power of two is split into 16 linear buckets, so a reported
+ *   percentile is within 1/16 of the recorded value at any magnitude.
+ *   not thread-safe.
+ */
+class log_histogram {
+
+ private:
+  static const int sub_bits = 4;
+  static const uint64_t sub_cnt = 1 << sub_bits;
+
+ public:
+  log_histogram() : buckets((64 - sub_bits + 1) * sub_cnt, 0) {}
+
+  void record(uint64_t v) {
+    buckets[indx(v)] += 1;
+    cnt += 1;
+    sum += v;
+    vmin = cnt == 1 ? v : std::min(vmin, v);
+    vmax = std::max(vmax, v);
+  }
+
+  void merge(const log_histogram & o) {
+    if(o.cnt == 0) return;
+    for(size_t i = 0; i < buckets.size(); ++i) {
+      buckets[i] += o.buckets[i];
+    }
+    vmin = cnt == 0 ? o.vmin : std::min(vmin, o.vmin);
+    vmax = std::max(vmax, o.vmax);
+    cnt += o.cnt;
+    sum += o.sum;
+  }
+
+  // smallest bucket bound covering fraction q(0 <= q <= 1) of the records
+  uint64_t percentile(double q) const {
+    if(cnt == 0) return 0;
+    uint64_t target = (uint64_t)(q * cnt + 0.5);
+    if(target == 0) target = 1;
+    uint64_t acc = 0;
+    for(size_t i = 0; i < buckets.size(); ++i) {
+      acc += buckets[i];
+      if(acc >= target) {
+        return std::min(upper(i), vmax);
+      }
+    }
+    return vmax;
+  }
+
+  uint64_t count() const { return cnt; }
+
+  uint64_t total() const { return sum; }
+
+  uint64_t min() const { return vmin; }
+
+  uint64_t max() const { return vmax; }
+
+  double mean() const {
+    return cnt ? (double)sum / cnt : 0.;
+  }
+
+  void clear() {
+    std::fill(buckets.begin(), buckets.end(), 0);
+    cnt = sum = vmin = vmax = 0;
+  }
+
+  // buckets followed by count, sum, min and max, to ship a histogram over mpi
+  std::vector<uint64_t> to_list() const {
+    std::vector<uint64_t> r(buckets);
+    r.push_back(cnt);
+    r.push_back(sum);
+    r.push_back(vmin);
+    r.push_back(vmax);
+    return r;
+  }
+
+  static log_histogram from_list(const std::vector<uint64_t> & lst) {
+    log_histogram h;
+    if(lst.size() != h.buckets.size() + 4) return h;
+    std::copy(lst.begin(), lst.begin() + h.buckets.size(), h.buckets.begin());
+    auto it = lst.begin() + h.buckets.size();
+    h.cnt = it[0];
+    h.sum = it[1];
+    h.vmin = it[2];
+    h.vmax = it[3];
+    return h;
+  }
+
+ private:
+  static size_t indx(uint64_t v) {
+    if(v < sub_cnt) return v;
+    int e = 63 - __builtin_clzll(v); // e >= sub_bits
+    uint64_t sub = (v >> (e - sub_bits)) & (sub_cnt - 1);
+    return (e - sub_bits + 1) * sub_cnt + sub;
+  }
+
+  // largest value falling into bucket i
+  static uint64_t upper(size_t i) {
+    if(i < sub_cnt) return i;
+    int e = i / sub_cnt + sub_bits - 1;
+    uint64_t sub = i % sub_cnt;
+    uint64_t lo = (uint64_t)1 << e | sub << (e - sub_bits);
+    return lo + ((uint64_t)1 << (e - sub_bits)) - 1;
+  }
+
+ private:
+  std::vector<uint64_t> buckets;
+  uint64_t cnt = 0;
+  uint64_t sum = 0;
+  uint64_t vmin = 0;
+  uint64_t vmax = 0;
+
+}; // class log_histogram
+
+} // namespace paracel
+
+#endif
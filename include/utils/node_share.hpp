@@ -0,0 +1,131 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#ifndef FILE_ea303abc_a7f5_4bc0_ba2e_4efc4eed721a_HPP
+#define FILE_ea303abc_a7f5_4bc0_ba2e_4efc4eed721a_HPP
+
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+
+#include <mpi.h>
+
+#include "paracel_types.hpp"
+#include "utils/comm.hpp"
+#include "utils/str_view.hpp"
+
+namespace paracel {
+
+/**
+ * blocks every rank needs, produced once per node and shared through an
+ * mpi shared memory window among the ranks of that node
+ *   construction and destruction are collective over comm
+ */
+class node_share {
+
+ public:
+  node_share(const paracel::Comm & comm) {
+    MPI_Comm_dup(comm.get_comm(), &all);
+    MPI_Comm_split_type(comm.get_comm(), MPI_COMM_TYPE_SHARED,
+                        (int)comm.get_rank(), MPI_INFO_NULL, &node);
+    MPI_Comm_rank(node, &rk);
+    MPI_Comm_size(node, &sz);
+  }
+
+  node_share(const node_share &) = delete;
+
+  node_share & operator=(const node_share &) = delete;
+
+  ~node_share() {
+    MPI_Comm_free(&node);
+    MPI_Comm_free(&all);
+  }
+
+  // rank within the node and ranks on the node
+  int get_rank() const { return rk; }
+
+  int get_size() const { return sz; }
+
+  /**
+   * f(i, str_view) on every rank for blocks i = 0, ..., nblk - 1 in order
+   *   blocks go in rounds of one per rank of the node: each rank calls
+   *   read(i) for its block of the round and copies the returned string to
+   *   the window, then every rank walks all blocks of the round. the views
+   *   are valid during the call only. nblk must agree over comm.
+   *   when read or f throws on any rank, every rank of comm throws once the
+   *   collective steps are done, so none is left waiting on the others
+   */
+  template <class R, class F>
+  void for_each_block(size_t nblk, R && read, F && f) {
+    std::exception_ptr err;
+    for(size_t r = 0; r < nblk; r += sz) {
+      paracel::str_type buf;
+      if(r + rk < nblk && !err) {
+        try {
+          buf = read(r + rk);
+        } catch (...) {
+          err = std::current_exception();
+        }
+      }
+      // the ranks of the node stop together, before the window
+      int failed = err ? 1 : 0;
+      MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_MAX, node);
+      if(failed) break;
+      char *base = NULL;
+      MPI_Win win;
+      MPI_Win_allocate_shared((MPI_Aint)buf.size(), 1, MPI_INFO_NULL, node, &base, &win);
+      MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+      if(buf.size()) std::memcpy(base, buf.data(), buf.size());
+      paracel::str_type().swap(buf);
+      // writes of every rank are visible before anyone reads
+      MPI_Win_sync(win);
+      MPI_Barrier(node);
+      MPI_Win_sync(win);
+      for(int k = 0; k < sz && r + k < nblk; ++k) {
+        MPI_Aint n = 0;
+        int unit = 0;
+        char *p = NULL;
+        MPI_Win_shared_query(win, k, &n, &unit, &p);
+        try {
+          f(r + k, paracel::str_view(n ? p : "", (size_t)n));
+        } catch (...) {
+          err = std::current_exception();
+          break;
+        }
+      }
+      MPI_Win_unlock_all(win);
+      // collective, so no segment goes while a rank still reads it
+      MPI_Win_free(&win);
+    }
+    // nodes run different numbers of rounds, so they agree only at the end
+    int failed = err ? 1 : 0;
+    MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_MAX, all);
+    if(err) {
+      std::rethrow_exception(err);
+    }
+    if(failed) {
+      throw std::runtime_error("node_share: reading a block failed on another rank\n");
+    }
+  }
+
+ private:
+  MPI_Comm all, node;
+  int rk = 0, sz = 1;
+
+}; // class node_share
+
+} // namespace paracel
+
+#endif
@@ -0,0 +1,75 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#ifndef FILE_02c9bf9c_0ed3_4a61_aac7_9711d0116a88_HPP
+#define FILE_02c9bf9c_0ed3_4a61_aac7_9711d0116a88_HPP
+
+#include <stdint.h>
+#include <mpi.h>
+
+#include "utils/comm.hpp"
+
+namespace paracel {
+
+/**
+ * one uint64 counter per rank in an mpi window, which any rank updates
+ * with one-sided atomics: the owner does not take part
+ *   construction and destruction are collective over comm
+ */
+class rma_counters {
+
+ public:
+  rma_counters(const paracel::Comm & comm, uint64_t init = 0) : m_comm(comm.get_comm()) {
+    MPI_Win_allocate(sizeof(uint64_t), sizeof(uint64_t),
+                     MPI_INFO_NULL, m_comm, &base, &win);
+    int rk;
+    MPI_Comm_rank(m_comm, &rk);
+    MPI_Win_lock(MPI_LOCK_EXCLUSIVE, rk, 0, win);
+    *base = init;
+    MPI_Win_unlock(rk, win);
+    // every counter is set before anyone touches it
+    MPI_Barrier(m_comm);
+    MPI_Win_lock_all(0, win);
+  }
+
+  rma_counters(const rma_counters &) = delete;
+
+  rma_counters & operator=(const rma_counters &) = delete;
+
+  ~rma_counters() {
+    MPI_Win_unlock_all(win);
+    // nobody is still working on a counter when the window goes
+    MPI_Barrier(m_comm);
+    MPI_Win_free(&win);
+  }
+
+  // add v to the counter of rank, return its value before
+  uint64_t fetch_add(int rank, uint64_t v) {
+    uint64_t old = 0;
+    MPI_Fetch_and_op(&v, &old, MPI_UINT64_T, rank, 0, MPI_SUM, win);
+    MPI_Win_flush(rank, win);
+    return old;
+  }
+
+ private:
+  MPI_Comm m_comm;
+  MPI_Win win;
+  uint64_t *base = NULL;
+
+}; // class rma_counters
+
+} // namespace paracel
+
+#endif
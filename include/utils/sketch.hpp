@@ -0,0 +1,191 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#ifndef FILE_6364ac0d_2d5b_4bb5_bc7c_b33a17fed8d8_HPP
+#define FILE_6364ac0d_2d5b_4bb5_bc7c_b33a17fed8d8_HPP
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+#include "paracel_types.hpp"
+#include "utils/hash.hpp"
+
+namespace paracel {
+
+/**
+ * count-min sketch over string keys
+ *   estimate never undercounts, it overcounts by at most total / width
+ *   with probability 1 - 2^-depth. sketches of the same shape can be merged.
+ */
+class count_min {
+
+ public:
+  count_min(size_t w = 4096, size_t d = 4) : width(w), depth(d), cnts(w * d, 0) {}
+
+  // add n to key, return the new estimate
+  uint64_t add(const paracel::str_type & key, uint64_t n = 1) {
+    size_t h = std::hash<paracel::str_type>()(key);
+    uint64_t est = UINT64_MAX;
+    for(size_t i = 0; i < depth; ++i) {
+      auto & c = cnts[i * width + slot(h, i)];
+      c += n;
+      est = std::min(est, c);
+    }
+    total += n;
+    return est;
+  }
+
+  uint64_t estimate(const paracel::str_type & key) const {
+    size_t h = std::hash<paracel::str_type>()(key);
+    uint64_t est = UINT64_MAX;
+    for(size_t i = 0; i < depth; ++i) {
+      est = std::min(est, cnts[i * width + slot(h, i)]);
+    }
+    return est;
+  }
+
+  void merge(const count_min & other) {
+    if(other.width != width || other.depth != depth) {
+      throw std::invalid_argument("count_min::merge: shape mismatch");
+    }
+    for(size_t i = 0; i < cnts.size(); ++i) {
+      cnts[i] += other.cnts[i];
+    }
+    total += other.total;
+  }
+
+  uint64_t get_total() const {
+    return total;
+  }
+
+  void clear() {
+    std::fill(cnts.begin(), cnts.end(), 0);
+    total = 0;
+  }
+
+ private:
+  size_t slot(size_t h, size_t i) const {
+    return paracel::utils::hash_value_combine(h, i + 1) % width;
+  }
+
+ private:
+  size_t width, depth;
+  std::vector<uint64_t> cnts;
+  uint64_t total = 0;
+
+}; // class count_min
+
+/**
+ * approximate top-k frequent keys
+ *   keeps k candidates ranked by their count-min estimate, a key displaces
+ *   the weakest candidate once its estimate is larger
+ */
+class heavy_hitters {
+
+ public:
+  heavy_hitters(size_t k = 32,
+                size_t width = 4096,
+                size_t depth = 4) : topk(k), sketch(width, depth) {}
+
+  void add(const paracel::str_type & key, uint64_t n = 1) {
+    uint64_t est = sketch.add(key, n);
+    auto it = cands.find(key);
+    if(it != cands.end()) {
+      it->second = est;
+      return;
+    }
+    if(cands.size() < topk) {
+      cands[key] = est;
+      min_est = cands.size() == 1 ? est : std::min(min_est, est);
+      return;
+    }
+    if(est <= min_est) return;
+    auto weakest = cands.begin();
+    for(auto iter = cands.begin(); iter != cands.end(); ++iter) {
+      if(iter->second < weakest->second) weakest = iter;
+    }
+    if(est <= weakest->second) {
+      min_est = weakest->second;
+      return;
+    }
+    cands.erase(weakest);
+    cands[key] = est;
+    min_est = est;
+    for(auto & kv : cands) {
+      min_est = std::min(min_est, kv.second);
+    }
+  }
+
+  // candidates of both are re-ranked with the merged sketch
+  void merge(const heavy_hitters & other) {
+    sketch.merge(other.sketch);
+    std::vector<paracel::str_type> keys;
+    for(auto & kv : cands) keys.push_back(kv.first);
+    for(auto & kv : other.cands) keys.push_back(kv.first);
+    cands.clear();
+    for(auto & key : keys) {
+      cands[key] = sketch.estimate(key);
+    }
+    auto lst = top();
+    cands.clear();
+    for(auto & kv : lst) {
+      cands[kv.first] = kv.second;
+    }
+    min_est = lst.empty() ? 0 : lst.back().second;
+  }
+
+  // most frequent first
+  paracel::list_type<std::pair<paracel::str_type, uint64_t> > top() const {
+    paracel::list_type<std::pair<paracel::str_type, uint64_t> > lst(cands.begin(), cands.end());
+    std::sort(lst.begin(), lst.end(),
+              [] (const std::pair<paracel::str_type, uint64_t> & a,
+                  const std::pair<paracel::str_type, uint64_t> & b) {
+                return a.second > b.second;
+              });
+    if(lst.size() > topk) lst.resize(topk);
+    return lst;
+  }
+
+  uint64_t estimate(const paracel::str_type & key) const {
+    return sketch.estimate(key);
+  }
+
+  uint64_t get_total() const {
+    return sketch.get_total();
+  }
+
+  void clear() {
+    sketch.clear();
+    cands.clear();
+    min_est = 0;
+  }
+
+ private:
+  size_t topk;
+  count_min sketch;
+  paracel::dict_type<paracel::str_type, uint64_t> cands;
+  uint64_t min_est = 0;
+
+}; // class heavy_hitters
+
+} // namespace paracel
+
+#endif
@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#ifndef FILE_896c4194_aaef_4ca0_8589_1b37eff3a46c_HPP
+#define FILE_896c4194_aaef_4ca0_8589_1b37eff3a46c_HPP
+
+#include <cstring>
+#include <algorithm>
+
+#include "paracel_types.hpp"
+
+namespace paracel {
+
+/**
+ * non-owning view of a char range, a small subset of c++17 string_view
+ *   the viewed memory(a mapped file, a line buffer) must outlive it
+ */
+class str_view {
+
+ public:
+  static const size_t npos = static_cast<size_t>(-1);
+
+  str_view() {}
+
+  str_view(const char *p, size_t n) : ptr(p), len(n) {}
+
+  str_view(const char *s) : ptr(s), len(std::strlen(s)) {}
+
+  str_view(const paracel::str_type & s) : ptr(s.data()), len(s.size()) {}
+
+  const char * data() const { return ptr; }
+
+  size_t size() const { return len; }
+
+  bool empty() const { return len == 0; }
+
+  char operator[](size_t i) const { return ptr[i]; }
+
+  const char * begin() const { return ptr; }
+
+  const char * end() const { return ptr + len; }
+
+  str_view substr(size_t pos, size_t n = npos) const {
+    pos = std::min(pos, len);
+    return str_view(ptr + pos, std::min(n, len - pos));
+  }
+
+  size_t find(char c, size_t pos = 0) const {
+    if(pos >= len) return npos;
+    const void *p = std::memchr(ptr + pos, c, len - pos);
+    return p ? static_cast<const char *>(p) - ptr : npos;
+  }
+
+  paracel::str_type str() const {
+    return paracel::str_type(ptr, len);
+  }
+
+  bool operator==(const str_view & o) const {
+    return len == o.len && std::memcmp(ptr, o.ptr, len) == 0;
+  }
+
+  bool operator!=(const str_view & o) const {
+    return !(*this == o);
+  }
+
+ private:
+  const char *ptr = "";
+  size_t len = 0;
+
+}; // class str_view
+
+} // namespace paracel
+
+#endif
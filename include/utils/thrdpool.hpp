@@ -0,0 +1,281 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#ifndef FILE_3c1f6a0e_8d52_4b7e_a4f9_2e6d0b51c7a3_HPP
+#define FILE_3c1f6a0e_8d52_4b7e_a4f9_2e6d0b51c7a3_HPP
+
+#include <sched.h>
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <exception>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+
+namespace paracel {
+
+// number of cores this process is allowed to run on
+inline size_t avail_cores() {
+  cpu_set_t cs;
+  CPU_ZERO(&cs);
+  if(sched_getaffinity(0, sizeof(cs), &cs) == 0) {
+    int n = CPU_COUNT(&cs);
+    if(n > 0) return (size_t)n;
+  }
+  size_t n = std::thread::hardware_concurrency();
+  return n == 0 ? 1 : n;
+}
+
+/**
+ * work-stealing thread pool
+ *   a parallel_* call splits its range into chunks spread over the worker
+ *   deques, every worker pops its own deque from the back and steals from
+ *   the front of the others when it runs dry.
+ *   the calling thread joins the computation on its own chunks, so nested
+ *   calls from inside a body are fine.
+ */
+class thrdpool {
+
+ private:
+  struct batch {
+    batch(size_t n) : pending(n) {}
+    std::function<void(size_t, size_t, size_t)> body; // (lo, hi, slot)
+    std::atomic<size_t> pending;
+    std::mutex mtx;
+    std::condition_variable done;
+    std::exception_ptr err;
+  };
+
+  struct task {
+    batch *b;
+    size_t lo, hi;
+  };
+
+  struct wdeque {
+    std::mutex mtx;
+    std::deque<task> q;
+  };
+
+ public:
+  // nthrds == 0 means one slot per available core
+  thrdpool(size_t nthrds = 0) {
+    nslots = nthrds == 0 ? paracel::avail_cores() : nthrds;
+    for(size_t i = 0; i < nslots; ++i) {
+      deques.emplace_back(new wdeque);
+    }
+    // the last slot belongs to the calling thread
+    for(size_t i = 0; i + 1 < nslots; ++i) {
+      workers.push_back(std::thread(&thrdpool::worker_loop, this, i));
+    }
+  }
+
+  thrdpool(const thrdpool &) = delete;
+
+  thrdpool & operator=(const thrdpool &) = delete;
+
+  virtual ~thrdpool() {
+    {
+      std::lock_guard<std::mutex> lk(mtx);
+      stop = true;
+    }
+    wake.notify_all();
+    for(auto & t : workers) {
+      t.join();
+    }
+  }
+
+  // number of threads working on a parallel_* call, including the caller
+  size_t size() const {
+    return nslots;
+  }
+
+  /**
+   * call func(i) for every i in [begin, end)
+   *   grain is the chunk size, 0 picks about four chunks per thread
+   *   the first exception thrown by func is rethrown here
+   */
+  template <class F>
+  void parallel_for(size_t begin, size_t end, F func, size_t grain = 0) {
+    run(begin, end, grain,
+        [&func] (size_t lo, size_t hi, size_t) {
+          for(size_t i = lo; i < hi; ++i) {
+            func(i);
+          }
+        });
+  }
+
+  /**
+   * reduce over [begin, end) with one accumulator per thread
+   *   func(i, acc) folds element i into the thread local acc(starting at init)
+   *   combine(a, b) merges two accumulators, applied in slot order at the end
+   */
+  template <class T, class F, class R>
+  T parallel_reduce(size_t begin, size_t end,
+                    const T & init,
+                    F func,
+                    R combine,
+                    size_t grain = 0) {
+    std::vector<T> accs(nslots, init);
+    run(begin, end, grain,
+        [&func, &accs] (size_t lo, size_t hi, size_t slot) {
+          T & acc = accs[slot];
+          for(size_t i = lo; i < hi; ++i) {
+            func(i, acc);
+          }
+        });
+    T r = init;
+    for(auto & acc : accs) {
+      r = combine(r, acc);
+    }
+    return r;
+  }
+
+ private:
+  static int & local_slot() {
+    static thread_local int slot = -1;
+    return slot;
+  }
+
+  static thrdpool *& local_pool() {
+    static thread_local thrdpool *pool = NULL;
+    return pool;
+  }
+
+  // pool workers use their own slot, any outside thread uses the last one
+  size_t current_slot() {
+    if(local_pool() == this) return (size_t)local_slot();
+    return nslots - 1;
+  }
+
+  void run(size_t begin, size_t end, size_t grain,
+           std::function<void(size_t, size_t, size_t)> body) {
+    if(end <= begin) return;
+    size_t n = end - begin;
+    if(grain == 0) {
+      grain = std::max((size_t)1, n / (nslots * 4));
+    }
+    size_t ntasks = (n + grain - 1) / grain;
+    size_t slot = current_slot();
+    if(nslots == 1 || ntasks == 1) {
+      body(begin, end, slot);
+      return;
+    }
+    batch b(ntasks);
+    b.body = std::move(body);
+    {
+      std::lock_guard<std::mutex> lk(mtx);
+      queued += ntasks;
+    }
+    // round-robin chunks, the caller keeps its share in its own deque
+    for(size_t k = 0; k < ntasks; ++k) {
+      size_t lo = begin + k * grain;
+      size_t hi = std::min(end, lo + grain);
+      wdeque & dq = *deques[(slot + k) % nslots];
+      std::lock_guard<std::mutex> lk(dq.mtx);
+      dq.q.push_back(task{&b, lo, hi});
+    }
+    wake.notify_all();
+    // help with chunks of this batch only, then wait for the stolen ones
+    task t;
+    while(b.pending.load() > 0 && take(slot, &b, t)) {
+      execute(t, slot);
+    }
+    std::unique_lock<std::mutex> lk(b.mtx);
+    b.done.wait(lk, [&b] { return b.pending.load() == 0; });
+    if(b.err) {
+      std::rethrow_exception(b.err);
+    }
+  }
+
+  // pop from own back, else steal from front of others
+  // only tasks of batch `only` are considered unless it is NULL
+  bool take(size_t slot, batch *only, task & t) {
+    {
+      wdeque & dq = *deques[slot];
+      std::lock_guard<std::mutex> lk(dq.mtx);
+      for(auto it = dq.q.rbegin(); it != dq.q.rend(); ++it) {
+        if(only == NULL || it->b == only) {
+          t = *it;
+          dq.q.erase(std::next(it).base());
+          queued -= 1;
+          return true;
+        }
+      }
+    }
+    for(size_t k = 1; k < nslots; ++k) {
+      wdeque & dq = *deques[(slot + k) % nslots];
+      std::lock_guard<std::mutex> lk(dq.mtx);
+      for(auto it = dq.q.begin(); it != dq.q.end(); ++it) {
+        if(only == NULL || it->b == only) {
+          t = *it;
+          dq.q.erase(it);
+          queued -= 1;
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  void execute(const task & t, size_t slot) {
+    batch *b = t.b;
+    try {
+      b->body(t.lo, t.hi, slot);
+    } catch (...) {
+      std::lock_guard<std::mutex> lk(b->mtx);
+      if(!b->err) b->err = std::current_exception();
+    }
+    // notify under the lock, the waiter owns b and may destroy it right after
+    std::lock_guard<std::mutex> lk(b->mtx);
+    if(b->pending.fetch_sub(1) == 1) {
+      b->done.notify_all();
+    }
+  }
+
+  void worker_loop(size_t slot) {
+    local_pool() = this;
+    local_slot() = (int)slot;
+    task t;
+    while(true) {
+      if(take(slot, NULL, t)) {
+        execute(t, slot);
+        continue;
+      }
+      std::unique_lock<std::mutex> lk(mtx);
+      wake.wait(lk, [this] { return stop || queued.load() > 0; });
+      if(stop) return;
+    }
+  }
+
+ private:
+  size_t nslots = 1;
+  std::vector<std::unique_ptr<wdeque> > deques;
+  std::vector<std::thread> workers;
+  std::atomic<size_t> queued{0};
+  std::mutex mtx;
+  std::condition_variable wake;
+  bool stop = false;
+
+}; // class thrdpool
+
+} // namespace paracel
+
+#endif
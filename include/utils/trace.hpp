@@ -0,0 +1,251 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#ifndef FILE_3debf220_0ae9_471f_b854_a3584c25895d_HPP
+#define FILE_3debf220_0ae9_471f_b854_a3584c25895d_HPP
+
+#include <stdint.h>
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
+#include "paracel_types.hpp"
+
+namespace paracel {
+
+/**
+ * process wide event tracer, off until enable() is called
+ *   every thread appends complete events(name, start, duration) to its own
+ *   ring buffer, so only the latest cap events per thread are kept.
+ *   dump writes them in chrome trace format(chrome://tracing, perfetto):
+ *   a json array whose closing bracket is optional, so the dumps of many
+ *   processes merge by concatenation(see merge).
+ *   timestamps are wall clock microseconds to line up across hosts.
+ */
+class tracer {
+
+ private:
+  struct event {
+    const char *cat;
+    char name[32];
+    uint64_t ts;
+    uint64_t dur;
+  };
+
+  struct ring {
+    std::mutex mtx;
+    std::vector<event> evts;
+    size_t next = 0;
+    bool full = false;
+    int tid;
+  };
+
+  struct state {
+    std::atomic<bool> on{false};
+    size_t cap = 1 << 16;
+    std::mutex mtx;
+    std::vector<ring *> rings;
+  };
+
+ public:
+  // cap is the number of events kept per thread
+  static void enable(size_t cap = 1 << 16) {
+    auto & st = get_state();
+    {
+      std::lock_guard<std::mutex> lk(st.mtx);
+      st.cap = cap;
+    }
+    st.on = true;
+  }
+
+  static void disable() {
+    get_state().on = false;
+  }
+
+  static bool on() {
+    return get_state().on.load(std::memory_order_relaxed);
+  }
+
+  static uint64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+  }
+
+  static void record(const char *cat,
+                     const char *name,
+                     size_t len,
+                     uint64_t ts,
+                     uint64_t dur) {
+    ring & r = local_ring();
+    std::lock_guard<std::mutex> lk(r.mtx);
+    if(r.evts.empty()) return;
+    event & e = r.evts[r.next];
+    e.cat = cat;
+    size_t n = std::min(len, sizeof(e.name) - 1);
+    std::memcpy(e.name, name, n);
+    e.name[n] = '\0';
+    e.ts = ts;
+    e.dur = dur;
+    r.next += 1;
+    if(r.next == r.evts.size()) {
+      r.next = 0;
+      r.full = true;
+    }
+  }
+
+  // write every buffered event tagged with pid to fn, return false on io error
+  static bool dump(const paracel::str_type & fn, int pid) {
+    std::ofstream os(fn);
+    if(!os) return false;
+    os << "[\n";
+    auto & st = get_state();
+    std::lock_guard<std::mutex> lk(st.mtx);
+    for(auto p : st.rings) {
+      std::lock_guard<std::mutex> rlk(p->mtx);
+      size_t n = p->full ? p->evts.size() : p->next;
+      size_t first = p->full ? p->next : 0;
+      for(size_t i = 0; i < n; ++i) {
+        auto & e = p->evts[(first + i) % p->evts.size()];
+        os << "{\"name\":\"" << escape(e.name) << "\",\"cat\":\"" << e.cat
+            << "\",\"ph\":\"X\",\"ts\":" << e.ts << ",\"dur\":" << e.dur
+            << ",\"pid\":" << pid << ",\"tid\":" << p->tid << "},\n";
+      }
+    }
+    return (bool)os;
+  }
+
+  // concatenate the dumps in fns into one trace file
+  static bool merge(const paracel::list_type<paracel::str_type> & fns,
+                    const paracel::str_type & out) {
+    std::ofstream os(out);
+    if(!os) return false;
+    os << "[\n";
+    for(auto & fn : fns) {
+      std::ifstream f(fn);
+      paracel::str_type line;
+      while(std::getline(f, line)) {
+        if(line == "[") continue;
+        os << line << '\n';
+      }
+    }
+    return (bool)os;
+  }
+
+  static void clear() {
+    auto & st = get_state();
+    std::lock_guard<std::mutex> lk(st.mtx);
+    for(auto p : st.rings) {
+      std::lock_guard<std::mutex> rlk(p->mtx);
+      p->next = 0;
+      p->full = false;
+    }
+  }
+
+ private:
+  static state & get_state() {
+    static state st;
+    return st;
+  }
+
+  // buffers live as long as the process, a dump may outlive their thread
+  static ring & local_ring() {
+    static thread_local ring *p_ring = NULL;
+    if(!p_ring) {
+      auto & st = get_state();
+      std::lock_guard<std::mutex> lk(st.mtx);
+      p_ring = new ring;
+      p_ring->evts.resize(st.cap);
+      p_ring->tid = st.rings.size();
+      st.rings.push_back(p_ring);
+    }
+    return *p_ring;
+  }
+
+  static paracel::str_type escape(const char *s) {
+    paracel::str_type r;
+    for(; *s; ++s) {
+      if(*s == '"' || *s == '\\') r += '\\';
+      if((unsigned char)*s < 0x20) continue;
+      r += *s;
+    }
+    return r;
+  }
+
+}; // class tracer
+
+/**
+ * records [construction, destruction) as one event when tracing is on
+ *   next(name) closes the current event and opens the following phase
+ */
+class trace_scope {
+
+ public:
+  // n must outlive the scope(string literals), nothing is copied when off
+  trace_scope(const char *c, const char *n) : cat(c) {
+    open(n);
+  }
+
+  trace_scope(const char *c, const paracel::str_type & n) : cat(c) {
+    if(tracer::on()) {
+      sname = n;
+      open(sname.c_str());
+    }
+  }
+
+  trace_scope(const trace_scope &) = delete;
+
+  trace_scope & operator=(const trace_scope &) = delete;
+
+  ~trace_scope() {
+    close();
+  }
+
+  void next(const char *n) {
+    close();
+    open(n);
+  }
+
+ private:
+  void open(const char *n) {
+    if(!tracer::on()) return;
+    name = n;
+    ts = tracer::now_us();
+    active = true;
+  }
+
+  void close() {
+    if(!active) return;
+    tracer::record(cat, name, std::strlen(name), ts, tracer::now_us() - ts);
+    active = false;
+  }
+
+ private:
+  const char *cat;
+  const char *name = NULL;
+  paracel::str_type sname;
+  uint64_t ts = 0;
+  bool active = false;
+
+}; // class trace_scope
+
+} // namespace paracel
+
+#endif
@@ -0,0 +1,285 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#ifndef FILE_5f760f4a_ef6f_41a2_993e_a7c075eefff6_HPP
+#define FILE_5f760f4a_ef6f_41a2_993e_a7c075eefff6_HPP
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <utility>
+#include <stdexcept>
+#include <condition_variable>
+
+#include "kv.hpp"
+#include "paracel_types.hpp"
+
+namespace paracel {
+
+/**
+ * append-only log of table mutations
+ *   records hold the resulting state(set/del/clear) rather than the request,
+ *   so replaying a log over any snapshot taken while it was written is safe.
+ *   record: op(u8) | klen(u32) | vlen(u64) | key | val | checksum(u32)
+ *
+ *   append only copies into a buffer; a flusher thread writes and fdatasyncs
+ *   whatever has piled up since the last round, so many requests from all
+ *   server threads share one sync(group commit). wait(lsn) blocks until
+ *   record lsn is durable.
+ */
+class wal {
+
+ public:
+  enum op_type : uint8_t { op_set = 1, op_del = 2, op_clear = 3 };
+
+  wal(const paracel::str_type & fn, bool sync_flag = true) :
+      filename(fn), sync(sync_flag) {
+    fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if(fd < 0) {
+      throw std::runtime_error("wal: can not open " + filename);
+    }
+    flusher = std::thread(&wal::flush_loop, this);
+  }
+
+  wal(const wal &) = delete;
+
+  wal & operator=(const wal &) = delete;
+
+  virtual ~wal() {
+    {
+      std::lock_guard<std::mutex> lk(mtx);
+      stop = true;
+    }
+    has_data.notify_all();
+    flusher.join();
+    close(fd);
+  }
+
+  // return the lsn of the appended record
+  size_t append_set(const paracel::str_type & key,
+                    const paracel::str_type & val) {
+    return append(op_set, key, val);
+  }
+
+  size_t append_del(const paracel::str_type & key) {
+    return append(op_del, key, paracel::str_type());
+  }
+
+  size_t append_clear() {
+    return append(op_clear, paracel::str_type(), paracel::str_type());
+  }
+
+  // lsn of the latest appended record
+  size_t appended() {
+    std::lock_guard<std::mutex> lk(mtx);
+    return last_lsn;
+  }
+
+  // block until every record up to lsn hit the disk
+  void wait(size_t lsn) {
+    std::unique_lock<std::mutex> lk(mtx);
+    durable.wait(lk, [this, lsn] { return durable_lsn >= lsn || stop; });
+  }
+
+  /**
+   * start a new log segment: the current one is kept as fn.prev
+   *   records appended so far go to the old segment, later ones to the new.
+   *   call once a snapshot is complete, recovery then needs that snapshot
+   *   plus fn.prev and fn only. does not wait for the disk: the flusher
+   *   finishes and closes the old segment before it writes the new one
+   */
+  void rotate() {
+    std::lock_guard<std::mutex> lk(mtx);
+    auto prev = filename + ".prev";
+    if(std::rename(filename.c_str(), prev.c_str()) != 0) {
+      throw std::runtime_error("wal: can not rename " + filename);
+    }
+    int nfd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if(nfd < 0) {
+      throw std::runtime_error("wal: can not open " + filename);
+    }
+    // an earlier rotation not flushed yet keeps its place in line
+    retired.push_back(std::make_pair(fd, paracel::str_type()));
+    retired.back().second.swap(buf);
+    fd = nfd;
+  }
+
+  /**
+   * apply every intact record of log fn to tbl, return number of records
+   *   a torn tail(crash in the middle of a write) is cut off the file
+   */
+  template <class T>
+  static size_t replay(T & tbl, const paracel::str_type & fn) {
+    int rfd = open(fn.c_str(), O_RDWR);
+    if(rfd < 0) return 0;
+    struct stat st;
+    if(fstat(rfd, &st) != 0 || st.st_size == 0) {
+      close(rfd);
+      return 0;
+    }
+    size_t sz = st.st_size;
+    void *addr = mmap(NULL, sz, PROT_READ, MAP_PRIVATE | MAP_POPULATE, rfd, 0);
+    if(addr == MAP_FAILED) {
+      close(rfd);
+      throw std::runtime_error("wal: mmap failed on " + fn);
+    }
+    madvise(addr, sz, MADV_SEQUENTIAL);
+    const char *base = static_cast<const char *>(addr);
+    size_t off = 0, cnt = 0;
+    const size_t head_sz = sizeof(uint8_t) + sizeof(uint32_t) + sizeof(uint64_t);
+    while(sz - off >= head_sz + sizeof(uint32_t)) {
+      const char *p = base + off;
+      uint8_t op;
+      uint32_t klen;
+      uint64_t vlen;
+      std::memcpy(&op, p, sizeof(op));
+      std::memcpy(&klen, p + sizeof(op), sizeof(klen));
+      std::memcpy(&vlen, p + sizeof(op) + sizeof(klen), sizeof(vlen));
+      uint64_t body = (uint64_t)head_sz + klen + vlen;
+      if(sz - off - sizeof(uint32_t) < body) break;
+      uint32_t crc;
+      std::memcpy(&crc, p + body, sizeof(crc));
+      if(crc != checksum(p, body)) break;
+      const char *k = p + head_sz;
+      if(op == op_set) {
+        tbl.set(paracel::str_type(k, klen), paracel::str_type(k + klen, vlen));
+      } else if(op == op_del) {
+        tbl.del(paracel::str_type(k, klen));
+      } else if(op == op_clear) {
+        tbl.clean();
+      } else {
+        break;
+      }
+      off += body + sizeof(uint32_t);
+      cnt += 1;
+    }
+    munmap(addr, sz);
+    if(off != sz) {
+      if(ftruncate(rfd, off) != 0) {
+        close(rfd);
+        throw std::runtime_error("wal: can not cut torn tail of " + fn);
+      }
+    }
+    close(rfd);
+    return cnt;
+  }
+
+ private:
+  // fnv-1a, only guards against torn or garbage tails
+  static uint32_t checksum(const char *p, size_t n) {
+    uint32_t h = 2166136261u;
+    for(size_t i = 0; i < n; ++i) {
+      h ^= (uint8_t)p[i];
+      h *= 16777619u;
+    }
+    return h;
+  }
+
+  size_t append(uint8_t op,
+                const paracel::str_type & key,
+                const paracel::str_type & val) {
+    paracel::str_type rec;
+    uint32_t klen = key.size();
+    uint64_t vlen = val.size();
+    rec.reserve(sizeof(op) + sizeof(klen) + sizeof(vlen) + klen + vlen + sizeof(uint32_t));
+    rec.append((const char *)&op, sizeof(op));
+    rec.append((const char *)&klen, sizeof(klen));
+    rec.append((const char *)&vlen, sizeof(vlen));
+    rec.append(key);
+    rec.append(val);
+    uint32_t crc = checksum(rec.data(), rec.size());
+    rec.append((const char *)&crc, sizeof(crc));
+    size_t lsn;
+    {
+      std::lock_guard<std::mutex> lk(mtx);
+      buf.append(rec);
+      lsn = ++last_lsn;
+    }
+    has_data.notify_one();
+    return lsn;
+  }
+
+  void flush_loop() {
+    paracel::str_type batch;
+    while(true) {
+      size_t lsn;
+      int wfd;
+      paracel::list_type<std::pair<int, paracel::str_type> > old;
+      {
+        std::unique_lock<std::mutex> lk(mtx);
+        has_data.wait(lk, [this] { return stop || !buf.empty() || !retired.empty(); });
+        if(buf.empty() && retired.empty() && stop) return;
+        old.swap(retired);
+        batch.swap(buf);
+        lsn = last_lsn;
+        wfd = fd;
+      }
+      // rotated segments first, in order, then the current one
+      for(auto & seg : old) {
+        write_all(seg.first, seg.second);
+        if(sync) fdatasync(seg.first);
+        close(seg.first);
+      }
+      write_all(wfd, batch);
+      if(sync) fdatasync(wfd);
+      batch.clear();
+      {
+        std::lock_guard<std::mutex> lk(mtx);
+        durable_lsn = lsn;
+      }
+      durable.notify_all();
+    }
+  }
+
+  static void write_all(int wfd, const paracel::str_type & data) {
+    size_t off = 0;
+    while(off < data.size()) {
+      ssize_t n = write(wfd, data.data() + off, data.size() - off);
+      if(n < 0) {
+        perror("wal write");
+        abort();
+      }
+      off += n;
+    }
+  }
+
+ private:
+  paracel::str_type filename;
+  bool sync = true;
+  int fd = -1;
+  paracel::str_type buf;
+  // segments cut by rotate with their unwritten records, for the flusher
+  paracel::list_type<std::pair<int, paracel::str_type> > retired;
+  size_t last_lsn = 0;
+  size_t durable_lsn = 0;
+  bool stop = false;
+  std::mutex mtx;
+  std::condition_variable has_data;
+  std::condition_variable durable;
+  std::thread flusher;
+
+}; // class wal
+
+} // namespace paracel
+
+#endif
@@ -123,6 +123,9 @@ if __name__ == '__main__':
     optpar.add_option('--group_server',
                       action='store', type='string', dest='server_group',
                       help='mesos case: which group for server to run')
+    optpar.add_option('--embedded', default=False,
+                      action='store_true', dest='embedded',
+                      help='host a parameter server shard inside every worker instead of starting standalone servers')
     (options, args) = optpar.parse_args()
 
     nsrv = 1
@@ -152,6 +155,16 @@ if __name__ == '__main__':
                                   options.hostfile,
                                   options.worker_group)
 
+    if options.embedded:
+        entry_cmd = ''
+        if args:
+            entry_cmd = ' '.join(args)
+        alg_cmd_lst = [worker_starter, str(nworker), entry_cmd, '--server_info', 'embedded', '--cfg_file', options.config]
+        alg_cmd = ' '.join(alg_cmd_lst)
+        logger.info(alg_cmd)
+        os.system(alg_cmd)
+        sys.exit(0)
+
     #initport = random.randint(30000, 65000)
     #initport = get_free_port()
     initport = 11777
@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#include <thread>
+#include <vector>
+
+#include "embedded.hpp"
+#include "server.hpp"
+
+namespace paracel {
+
+namespace {
+
+std::mutex embedded_mtx;
+paracel::list_type<zmq::context_t *> contexts;
+paracel::list_type<zmq::socket_t *> sockets;
+paracel::list_type<std::thread> threads;
+std::thread compact_thrd;
+
+} // namespace
+
+paracel::str_type start_embedded_thrds() {
+  std::lock_guard<std::mutex> lk(embedded_mtx);
+  zmq::context_t *p_context = new zmq::context_t(2);
+  std::vector<zmq::socket_t *> sock_pt_lst;
+  auto ports = bind_thrds(*p_context, sock_pt_lst);
+  for(int i = 0; i < paracel::threads_num - 1; ++i) {
+    threads.push_back(std::thread(thrd_exec, std::ref(*sock_pt_lst[i])));
+  }
+  threads.push_back(std::thread(thrd_exec_ssp, std::ref(*sock_pt_lst.back())));
+  if(!compact_thrd.joinable()) {
+    compact_thrd = std::thread(compact_exec);
+  }
+  contexts.push_back(p_context);
+  sockets.insert(sockets.end(), sock_pt_lst.begin(), sock_pt_lst.end());
+  return ports;
+}
+
+void drain_embedded_forwards() {
+  srv_replicator.stop();
+}
+
+void stop_embedded_thrds() {
+  std::lock_guard<std::mutex> lk(embedded_mtx);
+  // blocked server threads fail with ETERM, close their sockets and return,
+  // which lets the context terminate
+  for(auto p_context : contexts) {
+    p_context->close();
+  }
+  for(auto & thrd : threads) {
+    thrd.join();
+  }
+  stop_compact();
+  if(compact_thrd.joinable()) {
+    compact_thrd.join();
+  }
+  for(auto p_sock : sockets) {
+    delete p_sock;
+  }
+  unlink_ipc();
+  for(auto p_context : contexts) {
+    delete p_context;
+  }
+  threads.clear();
+  sockets.clear();
+  contexts.clear();
+}
+
+bool embedded_get(const paracel::str_type & key, paracel::str_type & val) {
+  bool r;
+  locked_read({key}, [&] () { r = paracel::tbl_store.get(key, val); });
+  return r;
+}
+
+// same bookkeeping as the "push" and "remove" ops of thrd_exec
+void embedded_set(const paracel::str_type & key, const paracel::str_type & val) {
+  size_t lsn = 0;
+  {
+    std::lock_guard<std::mutex> lk(paracel::mutex);
+    paracel::tbl_store.set(key, val);
+    record_set(key, val);
+    if(srv_wal) lsn = srv_wal->appended();
+  }
+  srv_replicator.forward(true);
+  if(lsn) srv_wal->wait(lsn);
+}
+
+bool embedded_contains(const paracel::str_type & key) {
+  std::lock_guard<std::mutex> lk(paracel::mutex);
+  return paracel::tbl_store.contains(key);
+}
+
+bool embedded_del(const paracel::str_type & key) {
+  bool r = false;
+  size_t lsn = 0;
+  {
+    std::lock_guard<std::mutex> lk(paracel::mutex);
+    r = paracel::tbl_store.del(key);
+    if(r) record_del(key);
+    if(srv_wal) lsn = srv_wal->appended();
+  }
+  srv_replicator.forward(true);
+  if(lsn) srv_wal->wait(lsn);
+  return r;
+}
+
+int embedded_copies(const paracel::str_type & key) {
+  std::lock_guard<std::mutex> lk(paracel::mutex);
+  return srv_replicator.copies(key);
+}
+
+} // namespace paracel
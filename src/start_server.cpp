@@ -19,13 +19,39 @@
 
 DEFINE_string(start_host, "beater7", "host name of start node\n");
 DEFINE_string(init_port, "7773", "init port");
+DEFINE_string(restore, "", "snapshot file to load before serving");
+DEFINE_string(wal, "", "write-ahead log file, replayed(after --restore) at start");
+DEFINE_bool(wal_sync, true, "fdatasync every group commit of the write-ahead log");
+DEFINE_string(spill_dir, "", "folder for values spilled out of memory");
+DEFINE_int64(mem_limit, 0, "MB of keys and values kept in memory, needs --spill_dir");
+DEFINE_bool(trace, false, "record request handling for paralg::paracel_dump_trace");
 
 int main(int argc, char *argv[])
 {
   google::SetUsageMessage("[options]\n\
   			--start_host\tdefault: balin\n\
-			--init_port\n");
+			--init_port\n\
+			--restore\n\
+			--wal\n\
+			--wal_sync\n\
+			--spill_dir\n\
+			--mem_limit\n\
+			--trace\n");
   google::ParseCommandLineFlags(&argc, &argv, true);
+  if(FLAGS_trace) {
+    paracel::tracer::enable();
+  }
+  if(FLAGS_spill_dir.size()) {
+    paracel::tbl_store.enable_spill(FLAGS_spill_dir, (size_t)FLAGS_mem_limit << 20);
+  }
+  if(FLAGS_restore.size()) {
+    paracel::snapshot_load(paracel::tbl_store, FLAGS_restore);
+  }
+  if(FLAGS_wal.size()) {
+    paracel::wal::replay(paracel::tbl_store, FLAGS_wal + ".prev");
+    paracel::wal::replay(paracel::tbl_store, FLAGS_wal);
+    paracel::srv_wal = new paracel::wal(FLAGS_wal, FLAGS_wal_sync);
+  }
   paracel::init_thrds(FLAGS_start_host, FLAGS_init_port); // join inside
   return 0;
 }
@@ -0,0 +1,92 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE ARENA_TEST
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include "utils/arena.hpp"
+#include "test.hpp"
+
+static std::string str(const paracel::arena::blk & b) {
+  return std::string(b.ptr, b.len);
+}
+
+BOOST_AUTO_TEST_CASE (arena_test) {
+  {
+    paracel::arena mem;
+    auto b = mem.alloc(5);
+    std::memcpy(b.ptr, "hello", 5);
+    PARACEL_CHECK_EQUAL(b.cap, 8);
+    PARACEL_CHECK_EQUAL(str(b), "hello");
+    // fits: overwritten in place
+    char *p = b.ptr;
+    mem.assign(b, "world!", 6);
+    BOOST_CHECK(b.ptr == p);
+    PARACEL_CHECK_EQUAL(str(b), "world!");
+    // grows out of its class
+    std::string s(1000, 'x');
+    mem.assign(b, s.data(), s.size());
+    PARACEL_CHECK_EQUAL(str(b), s);
+    BOOST_CHECK(b.cap >= 1000);
+    // big blocks
+    std::string big(1 << 20, 'y');
+    mem.assign(b, big.data(), big.size());
+    PARACEL_CHECK_EQUAL(str(b), big);
+    big.append(1000, 'z');
+    mem.assign(b, big.data(), big.size());
+    PARACEL_CHECK_EQUAL(str(b), big);
+    mem.free(b);
+    BOOST_CHECK(b.ptr == NULL);
+    PARACEL_CHECK_EQUAL(mem.reserved(), 0);
+  }
+  {
+    // free three of every four blocks, compaction gives the slabs back
+    paracel::arena mem;
+    std::vector<paracel::arena::blk> blks;
+    for(int i = 0; i < 100000; ++i) {
+      auto b = mem.alloc(256);
+      std::memset(b.ptr, i % 128, 256);
+      blks.push_back(b);
+    }
+    std::vector<paracel::arena::blk> live;
+    std::vector<int> ids;
+    for(int i = 0; i < 100000; ++i) {
+      if(i % 4 == 0) {
+        live.push_back(blks[i]);
+        ids.push_back(i);
+      } else {
+        mem.free(blks[i]);
+      }
+    }
+    size_t before = mem.reserved();
+    BOOST_CHECK(mem.fragmented());
+    BOOST_CHECK(mem.begin_compaction());
+    for(auto & b : live) {
+      if(mem.evacuating(b)) mem.relocate(b);
+    }
+    mem.end_compaction();
+    BOOST_CHECK(mem.reserved() * 3 < before);
+    BOOST_CHECK(!mem.fragmented());
+    for(size_t k = 0; k < live.size(); ++k) {
+      PARACEL_CHECK_EQUAL(str(live[k]), std::string(256, ids[k] % 128));
+      mem.free(live[k]);
+    }
+    PARACEL_CHECK_EQUAL(mem.reserved(), 0);
+  }
+}
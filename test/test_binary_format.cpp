@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE BINARY_FORMAT_TEST
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include <boost/test/unit_test.hpp>
+
+#include "load/binary_format.hpp"
+#include "utils.hpp"
+#include "test.hpp"
+
+static std::string tmp_name(const std::string & s) {
+  return "/tmp/paracel_test_binary_" + s + "_" + std::to_string((long long)getpid());
+}
+
+BOOST_AUTO_TEST_CASE (csr_test) {
+  auto fn = tmp_name("csr");
+  {
+    paracel::binary::writer w(fn, paracel::binary::csr, 0, 2);
+    uint64_t c0[] = {2, 3}, c1[] = {1}, c2[] = {4, 5, 6};
+    double v0[] = {0.5, 1.}, v1[] = {2.}, v2[] = {3., 4., 5.};
+    w.add_row(1, c0, v0, 2);
+    w.add_row(2, c1, v1, 1);
+    w.add_row(1, c2, v2, 3);
+  }
+  BOOST_CHECK(paracel::binary::is_binary(fn));
+  paracel::binary::reader r(fn);
+  PARACEL_CHECK_EQUAL(r.kind(), paracel::binary::csr);
+  PARACEL_CHECK_EQUAL(r.n_blocks(), 2);
+  PARACEL_CHECK_EQUAL(r.n_rows(), 3);
+  PARACEL_CHECK_EQUAL(r.n_vals(), 6);
+  paracel::list_type<paracel::compact_triple_type> tpls;
+  for(uint64_t b = 0; b < r.n_blocks(); ++b) {
+    auto blk = r.get_block(b);
+    BOOST_CHECK(reinterpret_cast<uintptr_t>(blk.vals) % 8 == 0);
+    for(uint64_t i = 0; i < blk.rows; ++i) {
+      for(uint64_t k = blk.row_ptr[i]; k < blk.row_ptr[i + 1]; ++k) {
+        tpls.push_back(paracel::compact_triple_type(blk.row_ids[i], blk.col_ids[k], blk.vals[k]));
+      }
+    }
+  }
+  using tpl = paracel::compact_triple_type;
+  paracel::list_type<tpl> expect = {
+    tpl(1, 2, 0.5), tpl(1, 3, 1.), tpl(2, 1, 2.), tpl(1, 4, 3.), tpl(1, 5, 4.), tpl(1, 6, 5.)
+  };
+  BOOST_CHECK(tpls == expect);
+  std::remove(fn.c_str());
+}
+
+BOOST_AUTO_TEST_CASE (dense_test) {
+  auto fn = tmp_name("dense");
+  {
+    paracel::binary::writer w(fn, paracel::binary::dense, 3);
+    double r0[] = {1., 2., 3.}, r1[] = {4., 5., 6.};
+    w.add_row(10, r0);
+    w.add_row(20, r1);
+    uint64_t c[] = {1};
+    BOOST_CHECK_THROW(w.add_row(30, c, r0, 1), std::invalid_argument);
+  }
+  paracel::binary::reader r(fn);
+  PARACEL_CHECK_EQUAL(r.kind(), paracel::binary::dense);
+  PARACEL_CHECK_EQUAL(r.dim(), 3);
+  PARACEL_CHECK_EQUAL(r.n_blocks(), 1);
+  auto blk = r.get_block(0);
+  PARACEL_CHECK_EQUAL(blk.rows, 2);
+  PARACEL_CHECK_EQUAL(blk.row_ids[1], 20);
+  PARACEL_CHECK_EQUAL(blk.vals[4], 5.);
+  std::remove(fn.c_str());
+}
+
+BOOST_AUTO_TEST_CASE (corrupt_test) {
+  auto fn = tmp_name("bad");
+  {
+    std::ofstream os(fn);
+    os << "1 2\n";
+  }
+  BOOST_CHECK(!paracel::binary::is_binary(fn));
+  BOOST_CHECK_THROW(paracel::binary::reader r(fn), std::runtime_error);
+  {
+    paracel::binary::writer w(fn, paracel::binary::dense, 2);
+    double v[] = {1., 2.};
+    w.add_row(1, v);
+  }
+  // drop the last word of the index
+  std::string s;
+  {
+    std::ifstream is(fn, std::ios::binary);
+    s.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+  }
+  {
+    std::ofstream os(fn, std::ios::binary | std::ios::trunc);
+    os << s.substr(0, s.size() - 8);
+  }
+  BOOST_CHECK(paracel::binary::is_binary(fn));
+  BOOST_CHECK_THROW(paracel::binary::reader r(fn), std::runtime_error);
+  std::remove(fn.c_str());
+}
@@ -0,0 +1,65 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE BQUEUE_TEST
+
+#include <boost/test/unit_test.hpp>
+
+#include <thread>
+#include <vector>
+#include "utils/bqueue.hpp"
+#include "test.hpp"
+
+BOOST_AUTO_TEST_CASE (bqueue_test) {
+  {
+    paracel::bqueue<int> q(4);
+    for(int i = 0; i < 4; ++i) {
+      q.push(i);
+    }
+    PARACEL_CHECK_EQUAL(q.size(), 4);
+    for(int i = 0; i < 4; ++i) {
+      int v = -1;
+      BOOST_CHECK(q.pop(v));
+      PARACEL_CHECK_EQUAL(v, i);
+    }
+    q.close();
+    int v = -1;
+    BOOST_CHECK(!q.pop(v));
+    BOOST_CHECK(!q.push(7));
+  }
+  {
+    // producer blocks on a full queue until the consumer drains it
+    paracel::bqueue<int> q(2);
+    int n = 1000;
+    std::thread producer([&] {
+      for(int i = 0; i < n; ++i) {
+        q.push(i);
+      }
+      q.close();
+    });
+    std::vector<int> got;
+    int v;
+    while(q.pop(v)) {
+      BOOST_CHECK(q.size() <= 2);
+      got.push_back(v);
+    }
+    producer.join();
+    PARACEL_CHECK_EQUAL((int)got.size(), n);
+    for(int i = 0; i < n; ++i) {
+      PARACEL_CHECK_EQUAL(got[i], i);
+    }
+  }
+}
@@ -0,0 +1,96 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE GRAPH_CACHE_TEST
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <string>
+#include <fstream>
+#include <boost/test/unit_test.hpp>
+
+#include "load/graph_cache.hpp"
+#include "utils.hpp"
+#include "test.hpp"
+
+static void dump(const std::string & fn, const std::string & s) {
+  std::ofstream os(fn, std::ios::trunc);
+  os << s;
+}
+
+BOOST_AUTO_TEST_CASE (graph_cache_test) {
+  using tpl = paracel::compact_triple_type;
+  // a folder of its own, so concurrent runs do not share cache files
+  std::string dir = "/tmp/paracel_test_graph_cache_" + std::to_string((long long)getpid());
+  BOOST_REQUIRE(mkdir(dir.c_str(), 0755) == 0);
+  paracel::str_type fn = dir + "/input.txt";
+  dump(fn, "1 2\n2 3\n");
+  paracel::list_type<paracel::str_type> fns = {fn};
+
+  paracel::graph_cache gc(dir, fns, "fsv", false, 1, 2, "tag");
+  BOOST_CHECK(!gc.valid());
+  paracel::list_type<tpl> tpls = {
+    tpl(1, 2, 1.), tpl(2, 3, 0.5), tpl(18446744073709551615ULL, 0, -2.25)
+  };
+  paracel::dict_type<paracel::default_id_type, paracel::default_id_type> rm, cm;
+  rm[0] = 7; rm[1] = 9; cm[0] = 3;
+  BOOST_CHECK(gc.write(tpls, &rm, &cm));
+  BOOST_CHECK(gc.valid());
+
+  paracel::list_type<tpl> got;
+  paracel::dict_type<paracel::default_id_type, paracel::default_id_type> rm2, cm2;
+  BOOST_CHECK(gc.read([&got] (paracel::default_id_type a,
+                              paracel::default_id_type b,
+                              double w) {
+    got.push_back(tpl(a, b, w));
+  }, &rm2, &cm2));
+  BOOST_CHECK(got == tpls);
+  BOOST_CHECK(rm2 == rm);
+  BOOST_CHECK(cm2 == cm);
+
+  // another rank, rank count, tag or pattern does not see it
+  paracel::graph_cache gc1(dir, fns, "fsv", false, 0, 2, "tag");
+  paracel::graph_cache gc2(dir, fns, "fsv", false, 1, 3, "tag");
+  paracel::graph_cache gc3(dir, fns, "fsv", false, 1, 2, "other");
+  paracel::graph_cache gc4(dir, fns, "fmap", false, 1, 2, "tag");
+  BOOST_CHECK(!gc1.valid());
+  BOOST_CHECK(!gc2.valid());
+  BOOST_CHECK(!gc3.valid());
+  BOOST_CHECK(!gc4.valid());
+  BOOST_CHECK(!gc1.read([] (paracel::default_id_type,
+                            paracel::default_id_type,
+                            double) {}));
+
+  // a modified input gets a new file name
+  dump(fn, "1 2\n2 3\n3 4\n");
+  paracel::graph_cache gc5(dir, fns, "fsv", false, 1, 2, "tag");
+  BOOST_CHECK(gc5.get_path() != gc.get_path());
+  BOOST_CHECK(!gc5.valid());
+
+  // a truncated file is rejected
+  {
+    std::ifstream is(gc.get_path(), std::ios::binary);
+    std::string s((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+    dump(gc.get_path(), s.substr(0, s.size() - 8));
+  }
+  BOOST_CHECK(!gc.valid());
+
+  std::remove(gc.get_path().c_str());
+  std::remove(fn.c_str());
+  rmdir(dir.c_str());
+}
@@ -0,0 +1,170 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE GZIP_INPUT_TEST
+
+#include <unistd.h>
+#include <zlib.h>
+
+#include <cstdio>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/test/unit_test.hpp>
+
+#include "load/gzip_input.hpp"
+#include "load/partition.hpp"
+#include "utils/thrdpool.hpp"
+#include "utils.hpp"
+#include "test.hpp"
+
+static std::string tmp_name(const std::string & s) {
+  return "/tmp/paracel_test_gzip_" + s + "_" + std::to_string((long long)getpid());
+}
+
+static paracel::list_type<std::string> gen_lines(int n) {
+  paracel::list_type<std::string> lines;
+  for(int i = 0; i < n; ++i) {
+    lines.push_back(std::to_string(i) + " " + std::to_string(i * 7 % 101) + ":0.5");
+  }
+  return lines;
+}
+
+static void write_plain(const std::string & fn,
+                        const paracel::list_type<std::string> & lines) {
+  gzFile f = gzopen(fn.c_str(), "wb");
+  for(auto & l : lines) {
+    gzwrite(f, l.data(), l.size());
+    gzwrite(f, "\n", 1);
+  }
+  gzclose(f);
+}
+
+static void write_framed(const std::string & fn,
+                         const paracel::list_type<std::string> & lines,
+                         size_t frame_bytes) {
+  paracel::gz::frame_writer w(fn, 6, frame_bytes);
+  for(auto & l : lines) w.write_line(l);
+}
+
+static std::string slurp(const std::string & fn) {
+  std::ifstream is(fn, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+}
+
+BOOST_AUTO_TEST_CASE (gzip_lines_test) {
+  auto lines = gen_lines(20000);
+  auto fn1 = tmp_name("plain"), fn2 = tmp_name("framed");
+  write_plain(fn1, lines);
+  write_framed(fn2, lines, 4096);
+  for(auto & fn : {fn1, fn2}) {
+    auto s = slurp(fn);
+    paracel::list_type<std::string> got;
+    // framed files read as plain multi-member gzip too
+    paracel::gz::for_each_line(s.data(), s.size(), [&got] (const paracel::str_view & l) {
+      got.push_back(l.str());
+    });
+    BOOST_CHECK(got == lines);
+  }
+  auto s1 = slurp(fn1), s2 = slurp(fn2);
+  PARACEL_CHECK_EQUAL(paracel::gz::detect(s1.data(), s1.size()), paracel::gz::plain);
+  PARACEL_CHECK_EQUAL(paracel::gz::detect(s2.data(), s2.size()), paracel::gz::framed);
+  PARACEL_CHECK_EQUAL(paracel::gz::detect("1 2\n", 4), paracel::gz::none);
+
+  // every frame inflates on its own and ends a line
+  auto frs = paracel::gz::frames(s2.data(), s2.size());
+  BOOST_CHECK(frs.size() > 10);
+  std::string text, buf;
+  for(auto & fr : frs) {
+    paracel::gz::inflate_frame(s2.data(), fr, buf);
+    BOOST_CHECK(buf.back() == '\n');
+    text += buf;
+  }
+  std::string expect;
+  for(auto & l : lines) expect += l + "\n";
+  BOOST_CHECK(text == expect);
+
+  // a flipped byte fails the crc, a cut file breaks the chain of frames
+  s2[frs[3].off + 30] ^= 1;
+  BOOST_CHECK_THROW(paracel::gz::inflate_frame(s2.data(), frs[3], buf), std::runtime_error);
+  BOOST_CHECK_THROW(paracel::gz::frames(s2.data(), s2.size() - 5), std::runtime_error);
+  BOOST_CHECK_THROW(paracel::gz::for_each_line(s1.data(), s1.size() - 20,
+                                               [] (const paracel::str_view &) {}),
+                    std::runtime_error);
+  std::remove(fn1.c_str());
+  std::remove(fn2.c_str());
+}
+
+BOOST_AUTO_TEST_CASE (gzip_partition_test) {
+  auto lines = gen_lines(30000);
+  auto fn1 = tmp_name("p_plain"), fn2 = tmp_name("p_framed"), fn3 = tmp_name("p_text");
+  paracel::list_type<std::string> half1(lines.begin(), lines.begin() + 10000);
+  paracel::list_type<std::string> half2(lines.begin() + 10000, lines.begin() + 20000);
+  paracel::list_type<std::string> half3(lines.begin() + 20000, lines.end());
+  write_plain(fn1, half1);
+  write_framed(fn2, half2, 2048);
+  {
+    std::ofstream os(fn3);
+    for(auto & l : half3) os << l << "\n";
+  }
+  paracel::thrdpool pool(3);
+  for(int np : {1, 3, 7}) {
+    paracel::partition p({fn1, fn2, fn3}, np, "fmap");
+    p.set_pool(&pool);
+    p.files_partition();
+    auto slst = p.get_start_list();
+    auto elst = p.get_end_list();
+    paracel::list_type<std::string> got;
+    for(size_t i = 0; i < slst.size(); ++i) {
+      auto part = p.files_load_lines_impl(slst[i], elst[i]);
+      got.insert(got.end(), part.begin(), part.end());
+    }
+    BOOST_CHECK(got == lines);
+  }
+  std::remove(fn1.c_str());
+  std::remove(fn2.c_str());
+  std::remove(fn3.c_str());
+}
+
+BOOST_AUTO_TEST_CASE (gzip_balance_test) {
+  // gzip input counts by its inflated size when balancing records
+  auto lines = gen_lines(30000);
+  auto fn1 = tmp_name("b_framed"), fn2 = tmp_name("b_text");
+  paracel::list_type<std::string> half1(lines.begin(), lines.begin() + 20000);
+  paracel::list_type<std::string> half2(lines.begin() + 20000, lines.end());
+  write_framed(fn1, half1, 2048);
+  {
+    std::ofstream os(fn2);
+    for(auto & l : half2) os << l << "\n";
+  }
+  int np = 6;
+  paracel::partition p({fn1, fn2}, np, "linesplit");
+  p.set_balance("records");
+  p.files_partition();
+  auto slst = p.get_start_list();
+  auto elst = p.get_end_list();
+  paracel::list_type<std::string> got;
+  for(size_t i = 0; i < slst.size(); ++i) {
+    auto part = p.files_load_lines_impl(slst[i], elst[i]);
+    BOOST_CHECK(part.size() > lines.size() / np * 2 / 3);
+    BOOST_CHECK(part.size() < lines.size() / np * 4 / 3);
+    got.insert(got.end(), part.begin(), part.end());
+  }
+  BOOST_CHECK(got == lines);
+  std::remove(fn1.c_str());
+  std::remove(fn2.c_str());
+}
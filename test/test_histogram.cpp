@@ -0,0 +1,59 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE HISTOGRAM_TEST
+
+#include <boost/test/unit_test.hpp>
+
+#include "utils/histogram.hpp"
+#include "test.hpp"
+
+BOOST_AUTO_TEST_CASE (histogram_test) {
+  paracel::log_histogram h;
+  PARACEL_CHECK_EQUAL(h.percentile(0.5), 0);
+  for(uint64_t v = 1; v <= 1000; ++v) {
+    h.record(v);
+  }
+  PARACEL_CHECK_EQUAL(h.count(), 1000);
+  PARACEL_CHECK_EQUAL(h.min(), 1);
+  PARACEL_CHECK_EQUAL(h.max(), 1000);
+  PARACEL_CHECK_EQUAL(h.total(), 500500);
+  BOOST_CHECK_CLOSE(h.mean(), 500.5, 1e-9);
+  // within 1/16 of the exact value
+  auto p50 = h.percentile(0.5);
+  BOOST_CHECK(p50 >= 500 && p50 <= 500 + 500 / 16);
+  auto p99 = h.percentile(0.99);
+  BOOST_CHECK(p99 >= 990 && p99 <= 1000);
+  PARACEL_CHECK_EQUAL(h.percentile(1.), 1000);
+  PARACEL_CHECK_EQUAL(h.percentile(0.), 1);
+
+  // large magnitudes
+  paracel::log_histogram big;
+  big.record((uint64_t)3 << 40);
+  auto p = big.percentile(0.5);
+  BOOST_CHECK(p == (uint64_t)3 << 40);
+
+  big.merge(h);
+  PARACEL_CHECK_EQUAL(big.count(), 1001);
+  PARACEL_CHECK_EQUAL(big.min(), 1);
+  PARACEL_CHECK_EQUAL(big.max(), (uint64_t)3 << 40);
+  auto copy = paracel::log_histogram::from_list(big.to_list());
+  PARACEL_CHECK_EQUAL(copy.count(), 1001);
+  PARACEL_CHECK_EQUAL(copy.min(), 1);
+  PARACEL_CHECK_EQUAL(copy.percentile(0.5), big.percentile(0.5));
+  h.clear();
+  PARACEL_CHECK_EQUAL(h.count(), 0);
+}
@@ -0,0 +1,92 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+// unit test for the loader's graph cache with a file missing on one rank
+// (any worker number)
+
+#include <cstdio>
+#include <tuple>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#include "utils/comm.hpp"
+#include "load/loader.hpp"
+#include "load/graph_cache.hpp"
+
+using triple_lst = paracel::list_type<std::tuple<paracel::default_id_type,
+                                                 paracel::default_id_type,
+                                                 double> >;
+
+static triple_lst graph_triples(paracel::digraph<paracel::default_id_type> & grp) {
+  triple_lst r;
+  auto f = [&r] (paracel::default_id_type a, paracel::default_id_type b, double w) {
+    r.push_back(std::make_tuple(a, b, w));
+  };
+  grp.traverse(f);
+  std::sort(r.begin(), r.end());
+  return r;
+}
+
+static triple_lst cached_load(paracel::Comm & comm,
+                              const std::string & fn,
+                              const std::string & dir) {
+  paracel::loader<std::string> ld(fn, comm, paracel::gen_triple_parser(), "fsv", false);
+  ld.set_cache(dir, "test");
+  paracel::digraph<paracel::default_id_type> g;
+  ld.load_graph(g);
+  return graph_triples(g);
+}
+
+int main(int argc, char *argv[])
+{
+  paracel::main_env comm_main_env(argc, argv);
+  paracel::Comm comm(MPI_COMM_WORLD);
+  auto rk = comm.get_rank();
+  auto np = comm.get_size();
+  std::string fn = "/tmp/paracel_test_load_cache.txt";
+  std::string dir = "/tmp/";
+  if(rk == 0) {
+    std::ofstream os(fn);
+    for(long i = 0; i < 2000; ++i) {
+      os << i << " " << (i * 7 % 101) << " " << (i % 5 + 1) * 0.5 << "\n";
+    }
+  }
+  comm.synchronize();
+  paracel::graph_cache mine(dir, paracel::expand(fn), "fsv", false, rk, np, "test");
+
+  auto g1 = cached_load(comm, fn, dir);
+  bool ok = !g1.empty() && mine.valid();
+  // rank 0 lost its file: every rank reloads instead of waiting on it
+  if(rk == 0) std::remove(mine.get_path().c_str());
+  comm.synchronize();
+  auto g2 = cached_load(comm, fn, dir);
+  ok = ok && g2 == g1 && mine.valid();
+  // and the rewritten files serve the next load
+  auto g3 = cached_load(comm, fn, dir);
+  ok = ok && g3 == g1;
+
+  long good = ok;
+  comm.allreduce(good);
+  ok = good == (long)np;
+  comm.synchronize();
+  std::remove(mine.get_path().c_str());
+  if(rk == 0) {
+    std::cout << (ok ? "ok" : "failed") << std::endl;
+    std::remove(fn.c_str());
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+// unit test for loader::load_graph/load_matrix against fixload and
+// create_graph/create_matrix(any worker number)
+
+#include <cstdio>
+#include <tuple>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+
+#include "utils/comm.hpp"
+#include "load/loader.hpp"
+
+using triple_lst = paracel::list_type<std::tuple<paracel::default_id_type,
+                                                 paracel::default_id_type,
+                                                 double> >;
+
+static triple_lst graph_triples(paracel::digraph<paracel::default_id_type> & grp) {
+  triple_lst r;
+  auto f = [&r] (paracel::default_id_type a, paracel::default_id_type b, double w) {
+    r.push_back(std::make_tuple(a, b, w));
+  };
+  grp.traverse(f);
+  std::sort(r.begin(), r.end());
+  return r;
+}
+
+// entries of a block matrix by original ids
+static triple_lst matrix_triples(Eigen::SparseMatrix<double, Eigen::RowMajor> & mtx,
+                                 paracel::dict_type<paracel::default_id_type, paracel::default_id_type> & rm,
+                                 paracel::dict_type<paracel::default_id_type, paracel::default_id_type> & cm) {
+  triple_lst r;
+  for(int k = 0; k < mtx.outerSize(); ++k) {
+    for(Eigen::SparseMatrix<double, Eigen::RowMajor>::InnerIterator it(mtx, k); it; ++it) {
+      r.push_back(std::make_tuple(rm[it.row()], cm[it.col()], it.value()));
+    }
+  }
+  std::sort(r.begin(), r.end());
+  return r;
+}
+
+template <class P>
+static bool same_load(paracel::Comm & comm,
+                      const std::string & fn,
+                      P parser,
+                      const std::string & pattern,
+                      bool mix) {
+  bool ok = true;
+  {
+    paracel::loader<std::string> ld1(fn, comm, parser, pattern, mix);
+    auto lines = ld1.fixload();
+    paracel::digraph<paracel::default_id_type> g1;
+    ld1.create_graph(lines, g1);
+    // a few lines per chunk, so the stream runs many rounds
+    paracel::loader<std::string> ld2(fn, comm, parser, pattern, mix);
+    ld2.set_chunk_lines(7);
+    paracel::digraph<paracel::default_id_type> g2;
+    ld2.load_graph(g2);
+    ok = ok && g1.e() > 0 && graph_triples(g1) == graph_triples(g2);
+  }
+  {
+    paracel::loader<std::string> ld1(fn, comm, parser, pattern, mix);
+    auto lines = ld1.fixload();
+    Eigen::SparseMatrix<double, Eigen::RowMajor> m1, m2;
+    paracel::dict_type<paracel::default_id_type, paracel::default_id_type> rm1, cm1, rm2, cm2;
+    ld1.create_matrix(lines, m1, rm1, cm1);
+    paracel::loader<std::string> ld2(fn, comm, parser, pattern, mix);
+    ld2.set_chunk_lines(7);
+    ld2.load_matrix(m2, rm2, cm2);
+    ok = ok && matrix_triples(m1, rm1, cm1) == matrix_triples(m2, rm2, cm2);
+  }
+  return ok;
+}
+
+int main(int argc, char *argv[])
+{
+  paracel::main_env comm_main_env(argc, argv);
+  paracel::Comm comm(MPI_COMM_WORLD);
+  auto rk = comm.get_rank();
+  std::string fsv_fn = "/tmp/paracel_test_load_stream_fsv.txt";
+  std::string fmap_fn = "/tmp/paracel_test_load_stream_fmap.txt";
+  std::string bad_fn = "/tmp/paracel_test_load_stream_bad.txt";
+  // long lines at the front give the first ranks far fewer lines, so they
+  // run out of chunks while the others still exchange
+  long n = 3000;
+  if(rk == 0) {
+    std::ofstream fsv(fsv_fn), fmap(fmap_fn), bad(bad_fn);
+    for(long i = 0; i < n; ++i) {
+      long a = i < n / 10 ? 100000000000L + i : i;
+      fsv << a << " " << (i * 7 % 101) << " " << (i % 5 + 1) * 0.5 << "\n";
+      fmap << i << " " << (i * 3 % 97) << ":0.5";
+      for(long j = 1; j < (i < n / 10 ? 40 : 2); ++j) {
+        fmap << "|" << (i + j) % 89;
+      }
+      fmap << "\n";
+      bad << (i == n / 2 ? std::string("bad") : std::to_string(i) + " 1 0.5") << "\n";
+    }
+  }
+  comm.synchronize();
+
+  bool ok = true;
+  bool r = same_load(comm, fsv_fn, paracel::gen_triple_parser(), "fsv", false);
+  if(rk == 0) std::cout << "fsv " << (r ? "ok" : "failed") << std::endl;
+  ok = ok && r;
+  r = same_load(comm, fmap_fn, paracel::gen_triple_parser(' ', '|'), "fmap", true);
+  if(rk == 0) std::cout << "mixed fmap " << (r ? "ok" : "failed") << std::endl;
+  ok = ok && r;
+
+  // a parser throwing on one rank fails the load on all of them
+  paracel::parser_type bad_parser = [] (paracel::str_type l) {
+    if(l == "bad") {
+      throw std::runtime_error("bad line");
+    }
+    return paracel::str_split(l, ' ');
+  };
+  long threw = 0;
+  try {
+    paracel::loader<std::string> ld(bad_fn, comm, bad_parser, "fsv", false);
+    ld.set_chunk_lines(7);
+    paracel::digraph<paracel::default_id_type> g;
+    ld.load_graph(g);
+  } catch (const std::runtime_error & e) {
+    threw = 1;
+  }
+  comm.allreduce(threw);
+  if(rk == 0) std::cout << "reader exception on " << threw << " ranks" << std::endl;
+  ok = ok && threw == (long)comm.get_size();
+
+  long good = ok;
+  comm.allreduce(good);
+  ok = good == (long)comm.get_size();
+  comm.synchronize();
+  if(rk == 0) {
+    std::cout << (ok ? "ok" : "failed") << std::endl;
+    std::remove(fsv_fn.c_str());
+    std::remove(fmap_fn.c_str());
+    std::remove(bad_fn.c_str());
+  }
+  return ok ? 0 : 1;
+}
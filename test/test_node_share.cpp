@@ -0,0 +1,111 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+// unit test for node_share(any worker number)
+
+#include <cstdio>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "utils/comm.hpp"
+#include "utils/node_share.hpp"
+#include "load/line_reader.hpp"
+#include "load/partition.hpp"
+
+int main(int argc, char *argv[])
+{
+  paracel::main_env comm_main_env(argc, argv);
+  paracel::Comm comm(MPI_COMM_WORLD);
+  auto rk = comm.get_rank();
+  std::string fn = "/tmp/paracel_test_node_share.txt";
+  long n = 10000;
+  if(rk == 0) {
+    std::ofstream os(fn);
+    for(long i = 0; i < n; ++i) {
+      os << i << (i % 7 ? " abc" : "") << "\n";
+    }
+  }
+  comm.synchronize();
+
+  paracel::partition partition_obj({fn}, comm.get_size(), "linesplit");
+  partition_obj.files_partition();
+  auto slst = partition_obj.get_start_list();
+  auto elst = partition_obj.get_end_list();
+  long reads = 0, next = 0;
+  bool ok = true;
+  {
+    paracel::node_share ns(comm);
+    auto read = [&] (size_t i) {
+      ++reads;
+      std::string text;
+      auto append = [&text] (const paracel::str_view & l) {
+        text.append(l.data(), l.size());
+        text.push_back('\n');
+      };
+      partition_obj.files_load_lines_impl(slst[i], elst[i], append);
+      return text;
+    };
+    // every rank sees every line, in file order
+    ns.for_each_block(slst.size(), read, [&] (size_t, const paracel::str_view & text) {
+      paracel::for_each_line(text.data(), text.size(), 0, text.size(),
+                             [&] (const paracel::str_view & l) {
+        bool tail = l.str().find(" abc") != std::string::npos;
+        ok = ok && std::stol(l.str()) == next && tail == (next % 7 != 0);
+        ++next;
+      });
+    });
+  }
+  ok = ok && next == n;
+  // one read per block and node
+  long nodes = 0, nblk = slst.size();
+  {
+    paracel::node_share ns(comm);
+    nodes = ns.get_rank() == 0;
+  }
+  comm.allreduce(reads);
+  comm.allreduce(nodes);
+
+  // a read failing on one rank fails the call on all of them
+  long threw = 0;
+  try {
+    paracel::node_share ns(comm);
+    auto bad_read = [&] (size_t i) {
+      if(i == slst.size() - 1) {
+        throw std::runtime_error("bad block");
+      }
+      return std::string("x\n");
+    };
+    ns.for_each_block(slst.size(), bad_read, [] (size_t, const paracel::str_view &) {});
+  } catch (const std::runtime_error & e) {
+    threw = 1;
+  }
+  comm.allreduce(threw);
+  ok = ok && threw == (long)comm.get_size();
+  if(rk == 0) std::cout << "read exception on " << threw << " ranks" << std::endl;
+
+  long good = ok;
+  comm.allreduce(good);
+  std::cout << "rank " << rk << " saw " << next << " lines" << std::endl;
+  ok = good == (long)comm.get_size() && reads == nblk * nodes;
+  comm.synchronize();
+  if(rk == 0) {
+    std::cout << (ok ? "ok" : "failed") << ", " << reads << " block reads on "
+        << nodes << " nodes" << std::endl;
+    std::remove(fn.c_str());
+  }
+  return ok ? 0 : 1;
+}
@@ -18,6 +18,7 @@
 
 #include <vector>
 #include <string>
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <boost/test/unit_test.hpp>
@@ -74,3 +75,103 @@ BOOST_AUTO_TEST_CASE (files_partition_test) {
     } // np
   }
 }
+
+BOOST_AUTO_TEST_CASE (files_load_lines_test) {
+  // blank lines, a last line without '\n' and an empty file
+  std::vector<std::string> flst = {"test_partition_0.dat",
+                                   "test_partition_1.dat",
+                                   "test_partition_2.dat"};
+  std::vector<std::string> expected;
+  {
+    std::ofstream os(flst[0]);
+    for(int i = 0; i < 500; ++i) {
+      os << "a" << i << (i % 7 ? " x\n" : "\n");
+      expected.push_back("a" + std::to_string(i) + (i % 7 ? " x" : ""));
+      if(i % 50 == 0) {
+        os << '\n';
+        expected.push_back("");
+      }
+    }
+    std::ofstream os1(flst[1]);
+    std::ofstream os2(flst[2]);
+    for(int i = 0; i < 300; ++i) {
+      os2 << "b" << i;
+      expected.push_back("b" + std::to_string(i));
+      if(i != 299) os2 << '\n';
+    }
+  }
+  for(int np = 1; np < 40; ++np) {
+    paracel::partition obj(flst, np, "fmap");
+    obj.files_partition(1);
+    auto ss = obj.get_start_list();
+    auto ee = obj.get_end_list();
+    std::vector<std::string> lines, handled, viewed;
+    auto str_handler = [&handled] (const std::string & l) {
+      handled.push_back(l);
+    };
+    auto view_handler = [&viewed] (const paracel::str_view & l) {
+      viewed.push_back(l.str());
+    };
+    for(size_t i = 0; i < ss.size(); ++i) {
+      auto blk = obj.files_load_lines_impl(ss[i], ee[i]);
+      lines.insert(lines.end(), blk.begin(), blk.end());
+      obj.files_load_lines_impl(ss[i], ee[i], str_handler);
+      obj.files_load_lines_impl(ss[i], ee[i], view_handler);
+    }
+    PARACEL_CHECK_EQUAL(lines, expected);
+    PARACEL_CHECK_EQUAL(handled, expected);
+    PARACEL_CHECK_EQUAL(viewed, expected);
+  }
+}
+
+BOOST_AUTO_TEST_CASE (files_partition_balance_test) {
+  // hub lines: the first tenth of the lines holds most of the bytes
+  std::vector<std::string> flst = {"test_partition_skew_0.dat",
+                                   "test_partition_skew_1.dat"};
+  std::vector<std::string> expected;
+  {
+    std::ofstream os0(flst[0]), os1(flst[1]);
+    for(int i = 0; i < 4000; ++i) {
+      std::string l = std::to_string(i);
+      int deg = i < 400 ? 200 : 2;
+      for(int j = 0; j < deg; ++j) l += (j ? "|" : " ") + std::to_string(j);
+      (i < 3000 ? os0 : os1) << l << '\n';
+      expected.push_back(l);
+    }
+  }
+  int np = 8;
+  auto spread = [&] (const std::string & by, size_t sample_bytes) {
+    paracel::partition obj(flst, np, "fmap");
+    obj.set_balance(by, " |", sample_bytes);
+    obj.files_partition(1);
+    auto ss = obj.get_start_list();
+    auto ee = obj.get_end_list();
+    PARACEL_CHECK_EQUAL(ss.size(), (size_t)np);
+    std::vector<std::string> lines;
+    std::vector<size_t> recs, fields;
+    for(size_t i = 0; i < ss.size(); ++i) {
+      auto blk = obj.files_load_lines_impl(ss[i], ee[i]);
+      size_t nf = 0;
+      for(auto & l : blk) nf += std::count(l.begin(), l.end(), '|') + 1;
+      recs.push_back(blk.size());
+      fields.push_back(nf);
+      lines.insert(lines.end(), blk.begin(), blk.end());
+    }
+    PARACEL_CHECK_EQUAL(lines, expected);
+    auto ratio = [] (const std::vector<size_t> & v) {
+      return (double)*std::max_element(v.begin(), v.end()) /
+          std::max((size_t)1, *std::min_element(v.begin(), v.end()));
+    };
+    return std::make_pair(ratio(recs), ratio(fields));
+  };
+  auto bytes = spread("bytes", 1 << 20);
+  auto records = spread("records", 1 << 20);
+  auto edges = spread("edges", 1 << 20);
+  BOOST_CHECK(bytes.first > 5.);
+  BOOST_CHECK(records.first < 1.1);
+  BOOST_CHECK(edges.second < 1.1);
+  // sparse samples still cover every line once
+  spread("edges", 4096);
+  BOOST_CHECK_THROW(paracel::partition(flst, np, "fmap").set_balance("lines"),
+                    std::invalid_argument);
+}
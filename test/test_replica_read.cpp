@@ -0,0 +1,70 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+// unit test for paracel_read over read replicas on workers that never wrote
+// nor registered the key(embedded servers, run with mpirun -n 2 or more)
+
+#include <string>
+#include <iostream>
+
+#include "ps.hpp"
+#include "utils.hpp"
+
+int main(int argc, char *argv[])
+{
+  paracel::main_env comm_main_env(argc, argv);
+  paracel::Comm comm(MPI_COMM_WORLD);
+  auto rk = comm.get_rank();
+  long np = comm.get_size();
+  bool ok = true;
+  {
+    paracel::paralg alg(paracel::embedded_srv, comm);
+    paracel::str_type key = "test_replica_read_theta";
+    if(rk == 0) {
+      alg.paracel_write(key, 0.5, true);
+    }
+    alg.paracel_sync();
+    if(rk != 0) {
+      // nothing is known before the first read, the owner tells the count
+      ok = ok && alg.paracel_replica_num(key) == 1;
+      for(int i = 0; i < 20; ++i) {
+        ok = ok && alg.paracel_read<double>(key) == 0.5;
+      }
+      ok = ok && alg.paracel_replica_num(key) == np;
+      // every copy holds the value
+      for(int i = 0; i < np; ++i) {
+        double v = 0.;
+        ok = ok && alg.paracel_read(key, v, i) && v == 0.5;
+      }
+    }
+    // keys without copies keep reading from the owner only
+    if(rk == 0) {
+      alg.paracel_write(paracel::str_type("test_replica_read_plain"), 1.5);
+    }
+    alg.paracel_sync();
+    double v = 0.;
+    ok = ok && alg.paracel_read(paracel::str_type("test_replica_read_plain"), v)
+        && v == 1.5;
+    ok = ok && alg.paracel_replica_num("test_replica_read_plain") == 1;
+    alg.paracel_sync();
+  }
+  long good = ok;
+  comm.allreduce(good);
+  ok = good == np;
+  if(rk == 0) {
+    std::cout << (ok ? "ok" : "failed") << std::endl;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+// unit test for scheduler::schedule_load(any worker number)
+
+#include <cstdio>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <functional>
+
+#include "utils/comm.hpp"
+#include "load/partition.hpp"
+#include "load/scheduler.hpp"
+
+int main(int argc, char *argv[])
+{
+  paracel::main_env comm_main_env(argc, argv);
+  paracel::Comm comm(MPI_COMM_WORLD);
+  auto rk = comm.get_rank();
+  std::string fn = "/tmp/paracel_test_schedule_load.txt";
+  // long lines at the front make the first blocks the slow ones
+  long n = 20000, total = 0;
+  if(rk == 0) {
+    std::ofstream os(fn);
+    for(long i = 0; i < n; ++i) {
+      os << i << " " << std::string(i < n / 10 ? 200 : 4, 'x') << "\n";
+    }
+  }
+  comm.synchronize();
+
+  bool ok = true;
+  for(auto pattern : {"fmap", "linesplit"}) {
+    paracel::partition partition_obj({fn}, comm.get_size(), pattern);
+    partition_obj.files_partition();
+    paracel::scheduler scheduler(comm, pattern, false);
+    auto lines = scheduler.schedule_load(partition_obj);
+    // every line exactly once over all ranks
+    long cnt = lines.size(), sum = 0;
+    for(auto & l : lines) {
+      sum += std::stol(l.substr(0, l.find(' ')));
+    }
+    comm.allreduce(cnt);
+    comm.allreduce(sum);
+    std::cout << "rank " << rk << " " << pattern << " loaded " << lines.size() << std::endl;
+    ok = ok && cnt == n && sum == n * (n - 1) / 2;
+    total += cnt;
+  }
+  comm.synchronize();
+  if(rk == 0) {
+    std::cout << (ok ? "ok" : "failed") << ", " << total << " lines" << std::endl;
+    std::remove(fn.c_str());
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE SKETCH_TEST
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include "utils/sketch.hpp"
+#include "srv_stats.hpp"
+#include "utils.hpp"
+#include "test.hpp"
+
+BOOST_AUTO_TEST_CASE (count_min_test) {
+  paracel::count_min cms(1024, 4);
+  for(int i = 0; i < 1000; ++i) {
+    cms.add("k" + std::to_string(i));
+  }
+  for(int i = 0; i < 500; ++i) {
+    cms.add("hot");
+  }
+  PARACEL_CHECK_EQUAL(cms.get_total(), 1500);
+  BOOST_CHECK(cms.estimate("hot") >= 500);
+  BOOST_CHECK(cms.estimate("hot") < 520);
+  BOOST_CHECK(cms.estimate("k1") >= 1);
+  paracel::count_min other(1024, 4);
+  other.add("hot", 100);
+  cms.merge(other);
+  BOOST_CHECK(cms.estimate("hot") >= 600);
+  paracel::count_min bad(512, 4);
+  BOOST_CHECK_THROW(cms.merge(bad), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE (heavy_hitters_test) {
+  paracel::heavy_hitters hh(3);
+  for(int i = 0; i < 10000; ++i) {
+    hh.add("k" + std::to_string(i % 1000));
+    if(i % 10 == 0) hh.add("a");
+    if(i % 20 == 0) hh.add("b");
+    if(i % 40 == 0) hh.add("c");
+  }
+  auto top = hh.top();
+  PARACEL_CHECK_EQUAL(top.size(), 3);
+  PARACEL_CHECK_EQUAL(top[0].first, "a");
+  PARACEL_CHECK_EQUAL(top[1].first, "b");
+  PARACEL_CHECK_EQUAL(top[2].first, "c");
+
+  paracel::heavy_hitters other(3);
+  other.add("d", 5000);
+  hh.merge(other);
+  top = hh.top();
+  PARACEL_CHECK_EQUAL(top[0].first, "d");
+  PARACEL_CHECK_EQUAL(top[1].first, "a");
+}
+
+BOOST_AUTO_TEST_CASE (srv_stats_test) {
+  paracel::srv_stats st, all;
+  st.touch("theta");
+  st.touch("theta");
+  st.touch("w");
+  st.record("pull", 10, 100, 2000);
+  st.record("pull", 10, 300, 4000);
+  st.merge_to(all);
+  auto lines = paracel::str_split(all.report(), '\n');
+  PARACEL_CHECK_EQUAL(lines[0], "op pull 2 20 400 3 4");
+  PARACEL_CHECK_EQUAL(lines[1], "key 2 theta");
+  PARACEL_CHECK_EQUAL(lines[2], "key 1 w");
+  st.clear();
+  paracel::srv_stats empty;
+  st.merge_to(empty);
+  PARACEL_CHECK_EQUAL(empty.report(), "");
+}
@@ -0,0 +1,84 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE SNAPSHOT_TEST
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include "snapshot.hpp"
+#include "test.hpp"
+
+BOOST_AUTO_TEST_CASE (snapshot_test) {
+  paracel::str_type fn = "/tmp/paracel_test_snapshot";
+  paracel::kvs<paracel::str_type, paracel::str_type> tbl;
+  for(int i = 0; i < 1000; ++i) {
+    tbl.set("key_" + std::to_string(i), paracel::str_type(i, 'v'));
+  }
+  tbl.set("", "empty key");
+  tbl.set(paracel::str_type("bin\0key", 7), paracel::str_type("\0\1\2", 3));
+  {
+    BOOST_CHECK(paracel::snapshot_dump(tbl, fn));
+    paracel::kvs<paracel::str_type, paracel::str_type> tbl2;
+    PARACEL_CHECK_EQUAL(paracel::snapshot_load(tbl2, fn), tbl.size());
+    PARACEL_CHECK_EQUAL(tbl2.getall(), tbl.getall());
+  }
+  {
+    // background dump in a forked child
+    std::remove(fn.c_str());
+    pid_t pid = paracel::snapshot_bg(tbl, fn);
+    BOOST_CHECK(pid > 0);
+    tbl.set("key_0", "changed after fork");
+    BOOST_CHECK(paracel::snapshot_wait(pid));
+    paracel::kvs<paracel::str_type, paracel::str_type> tbl2;
+    paracel::snapshot_load(tbl2, fn);
+    paracel::str_type v;
+    tbl2.get("key_0", v);
+    PARACEL_CHECK_EQUAL(v, "");
+  }
+  {
+    // a dump that can not be written is reported by snapshot_wait
+    pid_t pid = paracel::snapshot_bg(tbl, "/nonexistent_dir/snapshot");
+    BOOST_CHECK(pid > 0);
+    BOOST_CHECK(!paracel::snapshot_wait(pid));
+    BOOST_CHECK(!paracel::snapshot_wait(-1));
+  }
+  {
+    // polling reaps the child once, with the same verdict as snapshot_wait
+    std::remove(fn.c_str());
+    pid_t pid = paracel::snapshot_bg(tbl, fn);
+    int state;
+    while((state = paracel::snapshot_poll(pid)) == 0) usleep(1000);
+    PARACEL_CHECK_EQUAL(state, 1);
+    pid = paracel::snapshot_bg(tbl, "/nonexistent_dir/snapshot");
+    while((state = paracel::snapshot_poll(pid)) == 0) usleep(1000);
+    PARACEL_CHECK_EQUAL(state, -1);
+    PARACEL_CHECK_EQUAL(paracel::snapshot_poll(-1), -1);
+  }
+  {
+    // truncated file is rejected
+    std::ofstream os(fn, std::ios::binary | std::ios::trunc);
+    os.write(paracel::snapshot_magic, sizeof(paracel::snapshot_magic));
+    uint64_t cnt = 5;
+    os.write((const char *)&cnt, sizeof(cnt));
+    os.close();
+    paracel::kvs<paracel::str_type, paracel::str_type> tbl2;
+    BOOST_CHECK_THROW(paracel::snapshot_load(tbl2, fn), std::runtime_error);
+  }
+  std::remove(fn.c_str());
+}
@@ -0,0 +1,79 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE THRDPOOL_TEST
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <atomic>
+#include <stdexcept>
+#include "utils/thrdpool.hpp"
+#include "test.hpp"
+
+BOOST_AUTO_TEST_CASE (thrdpool_test) {
+  BOOST_CHECK(paracel::avail_cores() >= 1);
+  {
+    paracel::thrdpool pool(4);
+    PARACEL_CHECK_EQUAL(pool.size(), 4);
+    std::vector<int> v(10007, 0);
+    pool.parallel_for(0, v.size(), [&v] (size_t i) { v[i] += (int)i; });
+    for(size_t i = 0; i < v.size(); ++i) {
+      PARACEL_CHECK_EQUAL(v[i], (int)i);
+    }
+    // empty range
+    pool.parallel_for(5, 5, [&v] (size_t i) { v[i] = -1; });
+    PARACEL_CHECK_EQUAL(v[5], 5);
+  }
+  {
+    paracel::thrdpool pool(3);
+    auto sum = pool.parallel_reduce(0, 100000, (long)0,
+                                    [] (size_t i, long & acc) { acc += (long)i; },
+                                    [] (long a, long b) { return a + b; },
+                                    7);
+    PARACEL_CHECK_EQUAL(sum, 4999950000L);
+    // nested calls from inside a body
+    std::atomic<long> cnt(0);
+    pool.parallel_for(0, 16, [&] (size_t) {
+      long s = pool.parallel_reduce(0, 100, (long)0,
+                                    [] (size_t i, long & acc) { acc += 1; },
+                                    [] (long a, long b) { return a + b; },
+                                    10);
+      cnt += s;
+    }, 1);
+    PARACEL_CHECK_EQUAL(cnt.load(), 1600);
+  }
+  {
+    paracel::thrdpool pool(2);
+    BOOST_CHECK_THROW(
+        pool.parallel_for(0, 100, [] (size_t i) {
+          if(i == 42) throw std::runtime_error("boom");
+        }, 1),
+        std::runtime_error);
+    // pool still usable afterwards
+    auto r = pool.parallel_reduce(0, 10, 0,
+                                  [] (size_t i, int & acc) { acc += 1; },
+                                  [] (int a, int b) { return a + b; });
+    PARACEL_CHECK_EQUAL(r, 10);
+  }
+  {
+    paracel::thrdpool pool(1);
+    auto r = pool.parallel_reduce(0, 10, 0,
+                                  [] (size_t i, int & acc) { acc += (int)i; },
+                                  [] (int a, int b) { return a + b; });
+    PARACEL_CHECK_EQUAL(r, 45);
+  }
+}
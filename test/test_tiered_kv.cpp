@@ -0,0 +1,114 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE TIERED_KV_TEST
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include "tiered_kv.hpp"
+#include "paracel_types.hpp"
+#include "test.hpp"
+
+BOOST_AUTO_TEST_CASE (tiered_kv_test) {
+  {
+    // without spill it behaves like kvs
+    paracel::tiered_kvs tbl;
+    tbl.set("a", "1");
+    tbl.set("b", "2");
+    PARACEL_CHECK_EQUAL(tbl.size(), 2);
+    PARACEL_CHECK_EQUAL(*tbl.get("a"), "1");
+    BOOST_CHECK(!tbl.get("c"));
+    BOOST_CHECK(tbl.del("a"));
+    BOOST_CHECK(!tbl.contains("a"));
+    PARACEL_CHECK_EQUAL(tbl.spilled(), 0);
+  }
+  {
+    paracel::tiered_kvs tbl;
+    tbl.enable_spill("/tmp/", 64);
+    for(int i = 0; i < 100; ++i) {
+      tbl.set("k" + std::to_string(i), std::string(10, 'a' + i % 26));
+    }
+    PARACEL_CHECK_EQUAL(tbl.size(), 100);
+    BOOST_CHECK(tbl.mem_bytes() <= 64);
+    BOOST_CHECK(tbl.spilled() > 0);
+    // reading a spilled key brings it back into memory
+    BOOST_CHECK(tbl.contains("k0"));
+    PARACEL_CHECK_EQUAL(*tbl.get("k0"), std::string(10, 'a'));
+    BOOST_CHECK(tbl.mem_bytes() <= 64);
+    // overwrite and delete spilled keys
+    tbl.set("k1", "new");
+    PARACEL_CHECK_EQUAL(*tbl.get("k1"), "new");
+    BOOST_CHECK(tbl.del("k2"));
+    BOOST_CHECK(!tbl.get("k2"));
+    PARACEL_CHECK_EQUAL(tbl.size(), 99);
+
+    paracel::list_type<paracel::str_type> keys = {"k3", "k50", "k99"};
+    auto vals = tbl.get_multi(keys);
+    PARACEL_CHECK_EQUAL(vals.size(), 3);
+    PARACEL_CHECK_EQUAL(vals[1], std::string(10, 'a' + 50 % 26));
+    keys.push_back("k2");
+    BOOST_CHECK_THROW(tbl.get_multi(keys), std::out_of_range);
+    paracel::dict_type<paracel::str_type, paracel::str_type> dct;
+    tbl.get_multi(keys, dct);
+    PARACEL_CHECK_EQUAL(dct.size(), 3);
+
+    size_t cnt = 0;
+    tbl.traverse([&] (const paracel::str_type & k, const paracel::str_type & v) {
+      if(k != "k1") {
+        PARACEL_CHECK_EQUAL(v, std::string(10, 'a' + std::stoi(k.substr(1)) % 26));
+      }
+      cnt += 1;
+    });
+    PARACEL_CHECK_EQUAL(cnt, 99);
+    PARACEL_CHECK_EQUAL(tbl.getall().size(), 99);
+
+    // spilled values read outside the lock come back unless changed meanwhile
+    {
+      paracel::list_type<paracel::str_type> cold_keys;
+      for(int i = 3; i < 100 && cold_keys.size() < 3; ++i) {
+        auto k = "k" + std::to_string(i);
+        paracel::list_type<paracel::str_type> one = {k};
+        paracel::tiered_kvs::cold_batch probe;
+        if(tbl.plan_cold(one, probe)) cold_keys.push_back(k);
+      }
+      PARACEL_CHECK_EQUAL(cold_keys.size(), 3);
+      paracel::tiered_kvs::cold_batch batch;
+      BOOST_CHECK(tbl.plan_cold(cold_keys, batch));
+      PARACEL_CHECK_EQUAL(batch.items.size(), 3);
+      paracel::tiered_kvs::read_cold_batch(batch);
+      tbl.set(cold_keys[1], "changed");
+      BOOST_CHECK(tbl.del(cold_keys[2]));
+      auto spilled = tbl.spilled();
+      tbl.publish(batch);
+      BOOST_CHECK(tbl.spilled() <= spilled);
+      auto n = std::stoi(cold_keys[0].substr(1));
+      PARACEL_CHECK_EQUAL(*tbl.get(cold_keys[0]), std::string(10, 'a' + n % 26));
+      PARACEL_CHECK_EQUAL(*tbl.get(cold_keys[1]), "changed");
+      BOOST_CHECK(!tbl.get(cold_keys[2]));
+      BOOST_CHECK(tbl.mem_bytes() <= 64);
+      paracel::tiered_kvs::cold_batch none;
+      paracel::list_type<paracel::str_type> missing = {"nokey"};
+      BOOST_CHECK(!tbl.plan_cold(missing, none));
+    }
+
+    tbl.clean();
+    PARACEL_CHECK_EQUAL(tbl.size(), 0);
+    PARACEL_CHECK_EQUAL(tbl.mem_bytes(), 0);
+    tbl.set("x", "y");
+    PARACEL_CHECK_EQUAL(*tbl.get("x"), "y");
+  }
+}
@@ -0,0 +1,125 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE TOKENIZER_TEST
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <random>
+#include <stdexcept>
+#include <boost/test/unit_test.hpp>
+
+#include "load/parser.hpp"
+#include "load/tokenizer.hpp"
+#include "utils.hpp"
+#include "test.hpp"
+
+BOOST_AUTO_TEST_CASE (tokenize_test) {
+  for(auto & s : {"a b c", " a  b c ", "", "   ", "abc", "1001 1:0.1 2:0.2"}) {
+    std::string line(s);
+    paracel::list_type<paracel::str_view> fields;
+    paracel::tokenize(line, ' ', fields);
+    paracel::list_type<std::string> r;
+    for(auto & v : fields) r.push_back(v.str());
+    PARACEL_CHECK_EQUAL(r, paracel::str_split(line, ' '));
+  }
+  std::string line("a:1|b c");
+  paracel::list_type<std::string> r;
+  auto n = paracel::tokenize_any(line, ":| ", [&r] (const paracel::str_view & v) {
+    r.push_back(v.str());
+  });
+  PARACEL_CHECK_EQUAL(n, 4);
+  PARACEL_CHECK_EQUAL(r, paracel::str_split(line, "[:| ]*"));
+}
+
+BOOST_AUTO_TEST_CASE (parse_number_test) {
+  uint64_t u = 0;
+  BOOST_CHECK(paracel::parse_uint64("18446744073709551615", u));
+  PARACEL_CHECK_EQUAL(u, 18446744073709551615ULL);
+  BOOST_CHECK(!paracel::parse_uint64("18446744073709551616", u));
+  BOOST_CHECK(!paracel::parse_uint64("", u));
+  BOOST_CHECK(!paracel::parse_uint64("-1", u));
+  BOOST_CHECK(!paracel::parse_uint64("12a", u));
+  int64_t i = 0;
+  BOOST_CHECK(paracel::parse_int64("-9223372036854775808", i));
+  PARACEL_CHECK_EQUAL(i, INT64_MIN);
+  BOOST_CHECK(!paracel::parse_int64("9223372036854775808", i));
+
+  // same bits as strtod
+  std::mt19937_64 rng(2014);
+  std::uniform_real_distribution<double> ud(-1e3, 1e3);
+  std::uniform_int_distribution<int> ed(-30, 30);
+  paracel::list_type<std::string> cases = {
+    "0", "-0", "0.1", "1.", ".5", "3.14159", "1e10", "1E-5", "+2.5e+3",
+    "123456789012345678", "1234567890123456789012", "0.30000000000000004",
+    "9007199254740993", "1e23", "1e-400", "1e400", "inf", "-nan", "0x1p3"
+  };
+  char buf[64];
+  for(int k = 0; k < 20000; ++k) {
+    const char *fmt = k % 3 == 0 ? "%.6f" : (k % 3 == 1 ? "%.17g" : "%.9e");
+    std::snprintf(buf, sizeof(buf), fmt, ud(rng) * std::pow(10., ed(rng)));
+    cases.push_back(buf);
+  }
+  for(auto & c : cases) {
+    double d;
+    BOOST_REQUIRE(paracel::parse_double(c, d));
+    double e = std::strtod(c.c_str(), NULL);
+    if(e != e) {
+      BOOST_CHECK(d != d);
+    } else {
+      BOOST_CHECK_MESSAGE(std::memcmp(&d, &e, sizeof(d)) == 0, c);
+    }
+  }
+  double d;
+  BOOST_CHECK(!paracel::parse_double("", d));
+  BOOST_CHECK(!paracel::parse_double("1.5x", d));
+  BOOST_CHECK(!paracel::parse_double("e5", d));
+
+  // lenient like std::stoull/std::stod
+  PARACEL_CHECK_EQUAL(paracel::to_uint64("123\r"), 123);
+  PARACEL_CHECK_EQUAL(paracel::to_uint64(" 7 "), 7);
+  PARACEL_CHECK_EQUAL(paracel::to_double("0.25\r"), 0.25);
+  PARACEL_CHECK_EQUAL(paracel::to_double("2.5abc"), 2.5);
+  BOOST_CHECK_THROW(paracel::to_uint64("abc"), std::invalid_argument);
+  BOOST_CHECK_THROW(paracel::to_double(""), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE (triple_parser_test) {
+  using tpl = paracel::compact_triple_type;
+  paracel::list_type<tpl> out;
+  auto f = paracel::gen_triple_parser();
+  BOOST_CHECK(f(std::string("1 2"), false, out));
+  BOOST_CHECK(f(std::string("1 2:0.5"), false, out));
+  BOOST_CHECK(f(std::string("1 2 0.25"), false, out));
+  BOOST_CHECK(!f(std::string("1 2 3 4"), false, out));
+  BOOST_CHECK(!f(std::string(""), false, out));
+  paracel::list_type<tpl> expect = {
+    tpl(1, 2, 1.), tpl(1, 2, 0.5), tpl(1, 2, 0.25)
+  };
+  BOOST_CHECK(out == expect);
+
+  out.clear();
+  auto g = paracel::gen_triple_parser(' ', '|');
+  BOOST_CHECK(g(std::string("7 3:0.1|4|5:2"), true, out));
+  BOOST_CHECK(g(std::string("8 9|10"), true, out));
+  BOOST_CHECK(g(std::string("9"), true, out));
+  expect = {
+    tpl(7, 3, 0.1), tpl(7, 4, 1.), tpl(7, 5, 2.), tpl(8, 9, 1.), tpl(8, 10, 1.)
+  };
+  BOOST_CHECK(out == expect);
+}
@@ -0,0 +1,80 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE TRACE_TEST
+
+#include <thread>
+#include <fstream>
+#include <boost/test/unit_test.hpp>
+
+#include "utils/trace.hpp"
+#include "test.hpp"
+
+static paracel::list_type<paracel::str_type> read_lines(const paracel::str_type & fn) {
+  paracel::list_type<paracel::str_type> lines;
+  std::ifstream f(fn);
+  paracel::str_type line;
+  while(std::getline(f, line)) {
+    lines.push_back(line);
+  }
+  return lines;
+}
+
+BOOST_AUTO_TEST_CASE (trace_test) {
+  // off by default, nothing is recorded
+  {
+    paracel::trace_scope tr("test", "ignored");
+  }
+  PARACEL_CHECK_EQUAL(paracel::tracer::dump("/tmp/trace_0.json", 0), true);
+  PARACEL_CHECK_EQUAL(read_lines("/tmp/trace_0.json").size(), 1);
+
+  paracel::tracer::enable(4);
+  {
+    paracel::trace_scope tr("test", "load");
+    tr.next("build");
+  }
+  std::thread thrd([] {
+    for(int i = 0; i < 10; ++i) {
+      paracel::trace_scope tr("test", paracel::str_type("op_") + std::to_string(i));
+    }
+  });
+  thrd.join();
+  PARACEL_CHECK_EQUAL(paracel::tracer::dump("/tmp/trace_0.json", 0), true);
+  auto lines = read_lines("/tmp/trace_0.json");
+  // 2 events of this thread, latest 4 of the other one
+  PARACEL_CHECK_EQUAL(lines.size(), 1 + 2 + 4);
+  PARACEL_CHECK_EQUAL(lines[0], "[");
+  BOOST_CHECK(lines[1].find("\"name\":\"load\"") != paracel::str_type::npos);
+  BOOST_CHECK(lines[2].find("\"name\":\"build\"") != paracel::str_type::npos);
+  BOOST_CHECK(lines[3].find("\"name\":\"op_6\"") != paracel::str_type::npos);
+  BOOST_CHECK(lines[6].find("\"name\":\"op_9\"") != paracel::str_type::npos);
+  BOOST_CHECK(lines[1].find("\"ph\":\"X\"") != paracel::str_type::npos);
+  BOOST_CHECK(lines[1].find("\"pid\":0") != paracel::str_type::npos);
+
+  PARACEL_CHECK_EQUAL(paracel::tracer::dump("/tmp/trace_1.json", 1), true);
+  paracel::tracer::merge({"/tmp/trace_0.json", "/tmp/trace_1.json"}, "/tmp/trace.json");
+  auto merged = read_lines("/tmp/trace.json");
+  PARACEL_CHECK_EQUAL(merged.size(), 1 + 6 * 2);
+  BOOST_CHECK(merged[7].find("\"pid\":1") != paracel::str_type::npos);
+
+  paracel::tracer::clear();
+  paracel::tracer::disable();
+  {
+    paracel::trace_scope tr("test", "ignored");
+  }
+  paracel::tracer::dump("/tmp/trace_0.json", 0);
+  PARACEL_CHECK_EQUAL(read_lines("/tmp/trace_0.json").size(), 1);
+}
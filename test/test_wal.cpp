@@ -0,0 +1,104 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE WAL_TEST
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include "wal.hpp"
+#include "test.hpp"
+
+BOOST_AUTO_TEST_CASE (wal_test) {
+  paracel::str_type fn = "/tmp/paracel_test_wal";
+  std::remove(fn.c_str());
+  std::remove((fn + ".prev").c_str());
+  {
+    paracel::wal log(fn);
+    // group commit from several threads
+    std::vector<std::thread> thrds;
+    for(int t = 0; t < 4; ++t) {
+      thrds.push_back(std::thread([&log, t] {
+        for(int i = 0; i < 100; ++i) {
+          auto key = "k_" + std::to_string(t) + "_" + std::to_string(i);
+          log.wait(log.append_set(key, std::to_string(i)));
+        }
+      }));
+    }
+    for(auto & thrd : thrds) thrd.join();
+    log.append_del("k_0_0");
+    log.append_set("k_0_1", "overwritten");
+  }
+  {
+    paracel::kvs<paracel::str_type, paracel::str_type> tbl;
+    PARACEL_CHECK_EQUAL(paracel::wal::replay(tbl, fn), 402);
+    PARACEL_CHECK_EQUAL(tbl.size(), 399);
+    BOOST_CHECK(!tbl.contains("k_0_0"));
+    paracel::str_type v;
+    tbl.get("k_0_1", v);
+    PARACEL_CHECK_EQUAL(v, "overwritten");
+    tbl.get("k_3_99", v);
+    PARACEL_CHECK_EQUAL(v, "99");
+  }
+  {
+    // torn tail is ignored and cut off
+    std::ofstream os(fn, std::ios::binary | std::ios::app);
+    os.write("\x01\x05\x00", 3);
+    os.close();
+    paracel::kvs<paracel::str_type, paracel::str_type> tbl;
+    PARACEL_CHECK_EQUAL(paracel::wal::replay(tbl, fn), 402);
+    paracel::wal log(fn);
+    log.append_clear();
+    log.append_set("after", "clear");
+  }
+  {
+    paracel::kvs<paracel::str_type, paracel::str_type> tbl;
+    PARACEL_CHECK_EQUAL(paracel::wal::replay(tbl, fn), 404);
+    PARACEL_CHECK_EQUAL(tbl.size(), 1);
+  }
+  {
+    // rotate keeps the old segment as .prev
+    paracel::wal log(fn, false);
+    log.append_set("a", "1");
+    log.rotate();
+    log.wait(log.append_set("b", "2"));
+    paracel::kvs<paracel::str_type, paracel::str_type> tbl;
+    paracel::wal::replay(tbl, fn + ".prev");
+    BOOST_CHECK(tbl.contains("a"));
+    BOOST_CHECK(!tbl.contains("b"));
+    paracel::wal::replay(tbl, fn);
+    BOOST_CHECK(tbl.contains("b"));
+  }
+  {
+    // rotations queue up behind the flusher, each segment keeps its records
+    paracel::wal log(fn, false);
+    log.append_set("c", "3");
+    log.rotate();
+    log.append_set("d", "4");
+    log.rotate();
+    log.wait(log.append_set("e", "5"));
+    paracel::kvs<paracel::str_type, paracel::str_type> tbl;
+    PARACEL_CHECK_EQUAL(paracel::wal::replay(tbl, fn + ".prev"), 1);
+    BOOST_CHECK(tbl.contains("d"));
+    PARACEL_CHECK_EQUAL(paracel::wal::replay(tbl, fn), 1);
+    BOOST_CHECK(tbl.contains("e"));
+  }
+  std::remove(fn.c_str());
+  std::remove((fn + ".prev").c_str());
+}
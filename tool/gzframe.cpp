@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+/**
+ * compress text input into framed gzip(see load/gzip_input.hpp), which the
+ * loader splits across ranks frame by frame. plain gzip input is accepted
+ * too, it is recompressed into frames
+ */
+
+#include <string>
+#include <iostream>
+#include <stdexcept>
+
+#include <gflags/gflags.h>
+#include <boost/filesystem.hpp>
+
+#include "load/gzip_input.hpp"
+#include "load/line_reader.hpp"
+#include "utils.hpp"
+
+template <class T>
+T parse_or(paracel::json_parser & jp, const std::string & key, T def) {
+  try {
+    return jp.parse<T>(key);
+  } catch (const std::exception &) {
+    return def;
+  }
+}
+
+DEFINE_string(cfg_file, "", "config json file with absolute path.\n");
+
+int main(int argc, char *argv[])
+{
+  google::SetUsageMessage("[options]\n\t--cfg_file\n");
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  paracel::json_parser jp(FLAGS_cfg_file);
+  std::string input, output;
+  size_t frame_bytes;
+  int level;
+  try {
+    input = jp.check_parse<std::string>("input");
+    output = jp.parse<std::string>("output");
+    frame_bytes = parse_or<size_t>(jp, "frame_bytes", 1 << 20);
+    level = parse_or<int>(jp, "level", 6);
+  } catch (const std::invalid_argument & e) {
+    std::cerr << e.what();
+    return 1;
+  }
+  boost::filesystem::create_directories(output);
+  for(auto & fn : paracel::expand(input)) {
+    auto name = fn.substr(fn.rfind('/') + 1);
+    if(name.size() > 3 && name.compare(name.size() - 3, 3, ".gz") == 0) {
+      name.resize(name.size() - 3);
+    }
+    auto out = paracel::todir(output) + name + ".gz";
+    try {
+      paracel::gz::frame_writer w(out, level, frame_bytes);
+      auto put = [&w] (const paracel::str_view & line) { w.write_line(line); };
+      paracel::mapped_file mf(fn);
+      mf.advise_sequential(0, mf.size());
+      if(paracel::gz::detect(mf.data(), mf.size()) == paracel::gz::none) {
+        paracel::for_each_line(mf.data(), mf.size(), 0, mf.size(), put);
+      } else {
+        paracel::gz::for_each_line(mf.data(), mf.size(), put);
+      }
+      w.close();
+    } catch (const std::exception & e) {
+      std::cerr << e.what();
+      return 1;
+    }
+    std::cout << fn << " -> " << out << std::endl;
+  }
+  return 0;
+}
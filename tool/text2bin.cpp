@@ -0,0 +1,163 @@
+/**
+ * Copyright (c) 2014, Douban Inc.
+ *   All rights reserved.
+ *
+ * Distributed under the BSD License. Check out the LICENSE file for full text.
+ *
+ * Paracel - A distributed optimization framework with parameter server.
+ *
+ * Downloading
+ *   git clone https://github.com/douban/paracel.git
+ *
+ * Authors: Hong Wu <xunzhangthu@gmail.com>
+ *
+ */
+
+/**
+ * convert text input into paracel binary input(see load/binary_format.hpp)
+ *   one output file per input file, named after it with a .bin suffix.
+ *   fsv, fmap and fset lines become csr rows, consecutive triples of the
+ *   same source make one row. fvec lines become dense rows.
+ */
+
+#include <memory>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include <gflags/gflags.h>
+#include <boost/filesystem.hpp>
+
+#include "load/binary_format.hpp"
+#include "load/line_reader.hpp"
+#include "load/parser.hpp"
+#include "load/tokenizer.hpp"
+#include "utils.hpp"
+
+template <class T>
+T parse_or(paracel::json_parser & jp, const std::string & key, T def) {
+  try {
+    return jp.parse<T>(key);
+  } catch (const std::exception &) {
+    return def;
+  }
+}
+
+void csr_convert(const std::string & in,
+                 const std::string & out,
+                 bool mix,
+                 char sep1,
+                 char sep2,
+                 uint64_t block_rows) {
+  paracel::binary::writer w(out, paracel::binary::csr, 0, block_rows);
+  auto parser = paracel::gen_triple_parser(sep1, sep2);
+  paracel::list_type<paracel::compact_triple_type> tpls;
+  paracel::list_type<uint64_t> cols;
+  paracel::list_type<double> vals;
+  uint64_t src = 0;
+  auto flush = [&] () {
+    if(cols.size()) w.add_row(src, cols.data(), vals.data(), cols.size());
+    cols.clear();
+    vals.clear();
+  };
+  paracel::mapped_file mf(in);
+  mf.advise_sequential(0, mf.size());
+  paracel::for_each_line(mf.data(), mf.size(), 0, mf.size(), [&] (const paracel::str_view & line) {
+    if(paracel::detail::trim(line).empty()) return;
+    tpls.clear();
+    if(!parser(line, mix, tpls)) {
+      throw std::invalid_argument("text2bin: unsupported line " + line.str() + "\n");
+    }
+    for(auto & tpl : tpls) {
+      if(cols.size() && std::get<0>(tpl) != src) flush();
+      src = std::get<0>(tpl);
+      cols.push_back(std::get<1>(tpl));
+      vals.push_back(std::get<2>(tpl));
+    }
+  });
+  flush();
+  w.close();
+}
+
+void dense_convert(const std::string & in,
+                   const std::string & out,
+                   char sep1,
+                   char sep2,
+                   uint64_t block_rows) {
+  std::unique_ptr<paracel::binary::writer> w;
+  const char seps[3] = {sep1, sep2, '\0'};
+  paracel::list_type<paracel::str_view> fields;
+  paracel::list_type<double> vals;
+  paracel::mapped_file mf(in);
+  mf.advise_sequential(0, mf.size());
+  paracel::for_each_line(mf.data(), mf.size(), 0, mf.size(), [&] (const paracel::str_view & line) {
+    if(paracel::detail::trim(line).empty()) return;
+    fields.clear();
+    paracel::tokenize_any(line, seps, [&fields] (const paracel::str_view & v) {
+      fields.push_back(v);
+    });
+    if(!w) {
+      w.reset(new paracel::binary::writer(out, paracel::binary::dense,
+                                          fields.size() - 1, block_rows));
+    } else if(fields.size() != vals.size() + 1) {
+      throw std::invalid_argument("text2bin: rows of different sizes at " + line.str() + "\n");
+    }
+    vals.resize(fields.size() - 1);
+    for(size_t i = 1; i < fields.size(); ++i) {
+      vals[i - 1] = paracel::to_double(fields[i]);
+    }
+    w->add_row(paracel::to_uint64(fields[0]), vals.data());
+  });
+  if(!w) {
+    w.reset(new paracel::binary::writer(out, paracel::binary::dense, 0, block_rows));
+  }
+  w->close();
+}
+
+DEFINE_string(cfg_file, "", "config json file with absolute path.\n");
+
+int main(int argc, char *argv[])
+{
+  google::SetUsageMessage("[options]\n\t--cfg_file\n");
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  paracel::json_parser jp(FLAGS_cfg_file);
+  std::string input, output, pattern, sep1, sep2;
+  uint64_t block_rows;
+  try {
+    input = jp.check_parse<std::string>("input");
+    output = jp.parse<std::string>("output");
+    pattern = jp.parse<std::string>("pattern");
+    sep1 = parse_or<std::string>(jp, "sep1", " ");
+    sep2 = parse_or<std::string>(jp, "sep2", sep1);
+    block_rows = parse_or<uint64_t>(jp, "block_rows", 65536);
+  } catch (const std::invalid_argument & e) {
+    std::cerr << e.what();
+    return 1;
+  }
+  if(pattern != "fvec" && pattern != "fsv" && pattern != "fmap" && pattern != "fset") {
+    std::cerr << "text2bin: pattern must be one of fvec, fsv, fmap and fset" << std::endl;
+    return 1;
+  }
+  if(sep1.size() != 1 || sep2.size() != 1) {
+    std::cerr << "text2bin: sep1 and sep2 must be single chars" << std::endl;
+    return 1;
+  }
+  boost::filesystem::create_directories(output);
+  for(auto & fn : paracel::expand(input)) {
+    auto out = paracel::todir(output) + fn.substr(fn.rfind('/') + 1) + ".bin";
+    try {
+      if(pattern == "fvec") {
+        dense_convert(fn, out, sep1[0], sep2[0], block_rows);
+      } else {
+        // several items on a fmap line are a row, like fset
+        csr_convert(fn, out, pattern != "fsv", sep1[0], sep2[0], block_rows);
+      }
+    } catch (const std::exception & e) {
+      std::cerr << e.what();
+      return 1;
+    }
+    std::cout << fn << " -> " << out << std::endl;
+  }
+  return 0;
+}